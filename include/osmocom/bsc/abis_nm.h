@@ -22,6 +22,8 @@
 #ifndef _NM_H
 #define _NM_H
 
+#include <time.h>
+
 #include <osmocom/gsm/tlv.h>
 #include <osmocom/gsm/abis_nm.h>
 #include <osmocom/gsm/protocol/gsm_12_21.h>
@@ -53,6 +55,14 @@ struct ipac_bcch_info {
 	uint8_t ca_list_si1[16];
 };
 
+/* Progress of a software load, see abis_nm_software_load_stats() */
+struct abis_nm_sw_load_stats {
+	size_t bytes_sent;
+	size_t bytes_total;
+	unsigned int window_size;
+	struct timespec elapsed;
+};
+
 /* PUBLIC */
 
 struct msgb;
@@ -97,6 +107,7 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 			  uint8_t win_size, int forced,
 			  gsm_cbfn *cbfn, void *cb_data);
 int abis_nm_software_load_status(struct gsm_bts *bts);
+int abis_nm_software_load_stats(struct gsm_bts *bts, struct abis_nm_sw_load_stats *stats);
 int abis_nm_software_activate(struct gsm_bts *bts, const char *fname,
 			      gsm_cbfn *cbfn, void *cb_data);
 
@@ -60,6 +60,12 @@ struct acc_ramp {
 	 */
 	uint16_t barred_accs;
 
+	/*!
+	 * ACCs 0-9 barred by CCCH overload control (see ccch_overload.h), in addition to
+	 * barred_accs. Set with acc_ramp_set_overload_barred(); not touched by ramping.
+	 */
+	uint16_t overload_barred_accs;
+
 	/*!
 	 * This controls the maximum number of ACCs to allow per ramping step (1 - 10).
 	 * The compile-time default value is ACC_RAMP_STEP_SIZE_DEFAULT.
@@ -143,14 +149,19 @@ static inline uint8_t acc_ramp_get_barred_t3(struct acc_ramp *acc_ramp)
 }
 
 /*!
- * Potentially mark certain Access Control Classes (ACCs) as barred in accordance to ACC ramping.
+ * Potentially mark certain Access Control Classes (ACCs) as barred in accordance to ACC ramping, if it is
+ * enabled, and to CCCH overload control, which applies whether ramping is enabled or not.
  * \param[in] rach_control RACH control parameters in which barred ACCs will be configured.
  * \param[in] acc_ramp Pointer to acc_ramp structure.
  */
 static inline void acc_ramp_apply(struct gsm48_rach_control *rach_control, struct acc_ramp *acc_ramp)
 {
-	rach_control->t2 |= acc_ramp_get_barred_t2(acc_ramp);
-	rach_control->t3 |= acc_ramp_get_barred_t3(acc_ramp);
+	if (acc_ramp_is_enabled(acc_ramp)) {
+		rach_control->t2 |= acc_ramp_get_barred_t2(acc_ramp);
+		rach_control->t3 |= acc_ramp_get_barred_t3(acc_ramp);
+	}
+	rach_control->t2 |= (acc_ramp->overload_barred_accs >> 8) & 0x03;
+	rach_control->t3 |= acc_ramp->overload_barred_accs & 0xff;
 }
 
 void acc_ramp_init(struct acc_ramp *acc_ramp, struct gsm_bts *bts);
@@ -159,3 +170,4 @@ int acc_ramp_set_step_interval(struct acc_ramp *acc_ramp, unsigned int step_inte
 void acc_ramp_set_step_interval_dynamic(struct acc_ramp *acc_ramp);
 void acc_ramp_trigger(struct acc_ramp *acc_ramp);
 void acc_ramp_abort(struct acc_ramp *acc_ramp);
+void acc_ramp_set_overload_barred(struct acc_ramp *acc_ramp, uint16_t barred_accs);
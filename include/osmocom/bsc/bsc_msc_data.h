@@ -170,6 +170,20 @@ struct bsc_msc_data {
 	/* Whether we detected the MSC supports Osmux (during BSSMAP_RESET) */
 	bool remote_supports_osmux;
 
+	/* Relative capacity for 'msc-selection load-based', 1 by default */
+	unsigned int selection_weight;
+
+	/* Load on this MSC, kept up to date by gscon_sccp_state_set() */
+	struct {
+		/* subscriber connections with an SCCP connection to this MSC */
+		unsigned int conns;
+		/* of those, the ones still waiting for the MSC's Connection Confirm */
+		unsigned int in_flight;
+		/* exponentially weighted moving average of the time until Connection Confirm, in microseconds */
+		unsigned int latency_us;
+		unsigned long latency_samples;
+	} load;
+
 	/* Proxy between IPA/SCCPlite encapsulated MGCP and UDP */
 	struct {
 		/* local (BSC) IP address to be used */
@@ -192,6 +206,9 @@ struct bsc_msc_data *osmo_msc_data_alloc(struct gsm_network *, int);
 
 struct osmo_cell_global_id *cgi_for_msc(struct bsc_msc_data *msc, struct gsm_bts *bts);
 
+void bsc_msc_latency_sample(struct bsc_msc_data *msc, unsigned int latency_us);
+uint64_t bsc_msc_load_score(const struct bsc_msc_data *msc);
+
 /* Helper function to calculate the port number for a given
  * timeslot/multiplex. This functionality is needed to support
  * the sccp-lite scenario where the MGW is handled externally */
@@ -1,5 +1,6 @@
 #pragma once
 #include <osmocom/core/fsm.h>
+#include <osmocom/bsc/gsm_data.h>
 
 enum gscon_fsm_event {
 	/* local SCCP stack tells us incoming conn from MSC */
@@ -78,5 +79,7 @@ void gscon_forget_lchan(struct gsm_subscriber_connection *conn, struct gsm_lchan
 
 void gscon_forget_mgw_endpoint_ci(struct gsm_subscriber_connection *conn, struct osmo_mgcpc_ep_ci *ci);
 
+void gscon_sccp_state_set(struct gsm_subscriber_connection *conn, enum subscr_sccp_state state);
+
 bool gscon_is_aoip(struct gsm_subscriber_connection *conn);
 bool gscon_is_sccplite(struct gsm_subscriber_connection *conn);
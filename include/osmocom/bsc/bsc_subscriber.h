@@ -7,31 +7,56 @@
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/gsm/protocol/gsm_23_003.h>
 
+#include <osmocom/bsc/hashtable.h>
+
 struct log_target;
 
+/* All struct bsc_subscr used in libbsc, indexed by IMSI and TMSI. */
+struct bsc_subscr_store {
+	struct llist_head bsub_list;
+	DECLARE_HASHTABLE(by_imsi, 12);
+	DECLARE_HASHTABLE(by_tmsi, 12);
+
+	/* freed struct bsc_subscr kept for reuse, see bsc_subscr_alloc() */
+	struct llist_head free_list;
+	unsigned int free_list_len;
+};
+
 struct bsc_subscr {
 	struct llist_head entry;
 	int use_count;
 
+	/* the store this subscriber is listed and indexed in */
+	struct bsc_subscr_store *store;
+	/* entries in store->by_imsi and store->by_tmsi */
+	struct llist_head hentry_imsi;
+	struct llist_head hentry_tmsi;
+
 	char imsi[GSM23003_IMSI_MAX_DIGITS+1];
 	uint32_t tmsi;
 	uint16_t lac;
+
+	/* struct gsm_paging_request on each BTS this subscriber is currently being paged on */
+	struct llist_head active_paging_requests;
 };
 
 const char *bsc_subscr_name(struct bsc_subscr *bsub);
 const char *bsc_subscr_id(struct bsc_subscr *bsub);
 
-struct bsc_subscr *bsc_subscr_find_or_create_by_imsi(struct llist_head *list,
+struct bsc_subscr_store *bsc_subscr_store_alloc(void *ctx);
+
+struct bsc_subscr *bsc_subscr_find_or_create_by_imsi(struct bsc_subscr_store *bsubst,
 						     const char *imsi);
-struct bsc_subscr *bsc_subscr_find_or_create_by_tmsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_or_create_by_tmsi(struct bsc_subscr_store *bsubst,
 						     uint32_t tmsi);
 
-struct bsc_subscr *bsc_subscr_find_by_imsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_by_imsi(struct bsc_subscr_store *bsubst,
 					   const char *imsi);
-struct bsc_subscr *bsc_subscr_find_by_tmsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_by_tmsi(struct bsc_subscr_store *bsubst,
 					   uint32_t tmsi);
 
 void bsc_subscr_set_imsi(struct bsc_subscr *bsub, const char *imsi);
+void bsc_subscr_set_tmsi(struct bsc_subscr *bsub, uint32_t tmsi);
 
 struct bsc_subscr *_bsc_subscr_get(struct bsc_subscr *bsub,
 				   const char *file, int line);
@@ -0,0 +1,97 @@
+/* Admission scheduler for BTS bring-up after mass reconnects */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+/*!
+ * When the BSC restarts, all BTS reconnect at the same moment and would all run the OML bring-up, SI
+ * generation and ACC ramping at once. The admission scheduler lets only a limited number of BTS through
+ * their bring-up at a time, higher priority first. The OML link of a waiting BTS is accepted, but the
+ * OML messages it sends are held back until it is admitted.
+ */
+
+struct gsm_bts;
+struct gsm_network;
+struct msgb;
+
+#define BTS_ADMISSION_MAX_PARALLEL_DEFAULT 0 /* no limit */
+#define BTS_ADMISSION_TIMEOUT_DEFAULT 60 /* seconds */
+
+enum bts_admission_state {
+	/* no OML link */
+	BTS_ADMISSION_IDLE,
+	/* OML link up, waiting for a bring-up slot */
+	BTS_ADMISSION_WAITING,
+	/* holding a bring-up slot, OML and RSL setup in progress */
+	BTS_ADMISSION_BRINGUP,
+	/* all unlocked TRX have RSL, or the bring-up timed out */
+	BTS_ADMISSION_IN_SERVICE,
+};
+
+extern const struct value_string bts_admission_state_names[];
+static inline const char *bts_admission_state_name(enum bts_admission_state state)
+{
+	return get_value_string(bts_admission_state_names, state);
+}
+
+/* Admission state of one BTS, part of struct gsm_bts */
+struct bts_admission {
+	enum bts_admission_state state;
+	/* BTS with a higher priority are admitted first */
+	uint8_t priority;
+	/* entry in bts_admission_sched.waiting */
+	struct llist_head entry;
+	/* OML messages received while waiting */
+	struct llist_head held_msgs;
+	/* releases the bring-up slot if the BTS does not finish in time */
+	struct osmo_timer_list timeout;
+	struct timespec requested;
+	struct timespec admitted;
+	struct timespec in_service;
+};
+
+/* The network wide scheduler, part of struct gsm_network */
+struct bts_admission_sched {
+	/* how many BTS may be in BTS_ADMISSION_BRINGUP at the same time, 0 for no limit */
+	unsigned int max_parallel;
+	/* seconds after which a BTS still in bring-up gives up its slot */
+	unsigned int timeout;
+	/* BTS in BTS_ADMISSION_WAITING, highest priority first, then in order of arrival */
+	struct llist_head waiting;
+	unsigned int num_bringup;
+	/* admits waiting BTS outside of the code path that freed a slot */
+	struct osmo_timer_list kick_timer;
+};
+
+void bts_admission_request(struct gsm_bts *bts);
+bool bts_admission_hold(struct gsm_bts *bts, struct msgb *msg);
+void bts_admission_done(struct gsm_bts *bts);
+void bts_admission_release(struct gsm_bts *bts);
+void bts_admission_kick(struct gsm_network *net);
+
+unsigned int bts_admission_queue_pos(const struct gsm_bts *bts);
+bool bts_admission_time_to_service(const struct gsm_bts *bts, struct timespec *elapsed);
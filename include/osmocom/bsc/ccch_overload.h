@@ -0,0 +1,104 @@
+/* CCCH overload control: bar Access Control Classes and stretch T3122 from live load */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <osmocom/core/utils.h>
+
+/*!
+ * CCCH overload control keeps a cell usable during signalling storms, e.g. mass events or re-registration
+ * after an outage. Once a second it compares the RACH load reported in CCCH LOAD IND, the SDCCH occupancy,
+ * the paging queue and AGCH overflows (DELETE IND) against configured targets. While any of them is at or
+ * above its target, one more of ACC 0-9 is barred every 'bar' interval, through the BTS' acc_ramp, and the
+ * T3122 wait indication sent in IMMEDIATE ASSIGN REJECT is stretched along with the number of barred ACCs.
+ * Once all loads are below their targets by the hysteresis, one ACC is allowed again every 'release'
+ * interval. The barred ACCs rotate, so that no group of subscribers stays locked out.
+ */
+
+struct gsm_bts;
+
+#define CCCH_OVERLOAD_RACH_BUSY_DEFAULT 80	/* percent of RACH slots */
+#define CCCH_OVERLOAD_RACH_ACCESS_DEFAULT 50	/* percent of RACH slots */
+#define CCCH_OVERLOAD_SDCCH_DEFAULT 90		/* percent of SDCCH in use */
+#define CCCH_OVERLOAD_PAGING_QUEUE_DEFAULT 1000	/* pending paging requests */
+#define CCCH_OVERLOAD_HYSTERESIS_DEFAULT 20	/* percent of each target */
+#define CCCH_OVERLOAD_MAX_BARRED_DEFAULT 8	/* of ACC 0-9 */
+#define CCCH_OVERLOAD_BAR_INTERVAL_DEFAULT 2	/* seconds */
+#define CCCH_OVERLOAD_RELEASE_INTERVAL_DEFAULT 20 /* seconds */
+
+/* The BTS sends CCCH LOAD IND only while the load is above its threshold; a RACH load older than this
+ * (seconds) is taken to be below that threshold. */
+#define CCCH_OVERLOAD_RACH_LOAD_MAX_AGE 5
+/* seconds after which the set of barred ACCs moves on by one */
+#define CCCH_OVERLOAD_ROTATE_INTERVAL 30
+/* T3122 wait indication in seconds with all of ACC 0-9 barred */
+#define CCCH_OVERLOAD_T3122_MAX 128
+
+enum ccch_overload_cause {
+	CCCH_OVERLOAD_RACH_BUSY = 0x01,
+	CCCH_OVERLOAD_RACH_ACCESS = 0x02,
+	CCCH_OVERLOAD_SDCCH = 0x04,
+	CCCH_OVERLOAD_PAGING = 0x08,
+	CCCH_OVERLOAD_AGCH = 0x10,
+};
+
+extern const struct value_string ccch_overload_cause_names[];
+
+/* CCCH overload control of one BTS, part of struct gsm_bts */
+struct ccch_overload {
+	bool enabled;
+	/* targets, in percent of RACH slots, of SDCCH, and in pending paging requests */
+	unsigned int rach_busy_target;
+	unsigned int rach_access_target;
+	unsigned int sdcch_target;
+	unsigned int paging_queue_target;
+	/* load counts as relieved when below each target by this percentage of it */
+	unsigned int hysteresis;
+	/* barring never goes beyond this many of ACC 0-9 */
+	unsigned int max_barred;
+	/* seconds between barring one more ACC while overloaded, and allowing one again while relieved */
+	unsigned int bar_interval;
+	unsigned int release_interval;
+
+	/* Last RACH load from CCCH LOAD IND, and seconds since it was received */
+	unsigned int rach_busy;
+	unsigned int rach_access;
+	unsigned int rach_load_age;
+	/* bts counter agch:delete_ind at the previous evaluation */
+	uint64_t agch_deleted_prev;
+
+	/* enum ccch_overload_cause flags of the last evaluation */
+	unsigned int causes;
+	/* number of ACCs barred, and the ACC to start barring from */
+	unsigned int level;
+	unsigned int rotate;
+	/* seconds until the next ACC may be barred; seconds relieved and seconds since the last rotation */
+	unsigned int bar_hold;
+	unsigned int relieved_secs;
+	unsigned int rotate_secs;
+	/* stretched T3122 wait indication in seconds, 0 while not barring */
+	uint8_t t3122;
+};
+
+void ccch_overload_update(struct gsm_bts *bts);
+void ccch_overload_reset(struct gsm_bts *bts);
+const char *ccch_overload_causes_str(unsigned int causes);
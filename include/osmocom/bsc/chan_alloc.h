@@ -27,11 +27,9 @@ struct gsm_subscriber_connection;
 /* Free a logical channel (SDCCH, TCH, ...) */
 void lchan_free(struct gsm_lchan *lchan);
 
-struct pchan_load {
-	struct load_counter pchan[_GSM_PCHAN_MAX];
-};
-
 void bts_chan_load(struct pchan_load *cl, const struct gsm_bts *bts);
+void bts_chan_load_scan(struct pchan_load *cl, const struct gsm_bts *bts);
+bool bts_chan_load_check(struct gsm_bts *bts);
 void network_chan_load(struct pchan_load *pl, struct gsm_network *net);
 void bts_update_t3122_chan_load(struct gsm_bts *bts);
 
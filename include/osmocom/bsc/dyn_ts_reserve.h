@@ -0,0 +1,65 @@
+/* Keep dynamic timeslots switched out of PDCH ahead of forecast TCH demand */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * A TCH request on a dynamic timeslot that is in PDCH mode has to wait for the PDCH deactivation round
+ * trip to the BTS before the lchan can be activated. The dyn TS reserve keeps a number of idle dynamic
+ * timeslots switched out of PDCH, so that TCH requests find them ready. Once a second, the number of TCH
+ * requests that static TCH could not serve feeds a moving average; the rate times the horizon is the
+ * number of dynamic timeslots expected to be needed soon, and is kept ready within the configured minimum
+ * and maximum. Reserved timeslots that are no longer needed go back to PDCH.
+ */
+
+struct gsm_bts;
+struct gsm_bts_trx_ts;
+
+#define DYN_TS_RESERVE_HORIZON_DEFAULT 2	/* seconds */
+/* moving averages give the previous average this many parts minus one, the new sample one part */
+#define DYN_TS_RESERVE_SMOOTHING 4
+
+/* Dynamic timeslot reserve of one BTS, part of struct gsm_bts */
+struct dyn_ts_reserve {
+	/* Reserve at least min, at most max dynamic timeslots; max == 0 disables the reserve */
+	unsigned int min;
+	unsigned int max;
+	/* seconds of forecast TCH demand to keep ready */
+	unsigned int horizon;
+
+	/* TCH requests for dynamic timeslots since the last evaluation */
+	unsigned int tch_requests;
+	/* moving average of TCH requests for dynamic timeslots, per 1000 seconds */
+	unsigned int rate_milli;
+	/* moving average of the PDCH deactivation round trip in ms, 0 until measured */
+	unsigned int pdch_deact_ms;
+
+	/* number of dynamic timeslots to keep out of PDCH, from the last evaluation */
+	unsigned int target;
+	/* number of dynamic timeslots that were out of PDCH and idle at the last evaluation */
+	unsigned int ready;
+};
+
+void dyn_ts_reserve_update(struct gsm_bts *bts);
+bool dyn_ts_reserve_keep(struct gsm_bts_trx_ts *ts);
+void dyn_ts_reserve_hit(struct gsm_bts_trx_ts *ts);
+void dyn_ts_reserve_pdch_deact_done(struct gsm_bts_trx_ts *ts);
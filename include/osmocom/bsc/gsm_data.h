@@ -30,7 +30,11 @@
 #include <osmocom/gsm/protocol/gsm_12_21.h>
 #include <osmocom/abis/e1_input.h>
 #include <osmocom/bsc/meas_rep.h>
+#include <osmocom/bsc/hashtable.h>
 #include <osmocom/bsc/acc_ramp.h>
+#include <osmocom/bsc/ccch_overload.h>
+#include <osmocom/bsc/dyn_ts_reserve.h>
+#include <osmocom/bsc/bts_admission.h>
 #include <osmocom/bsc/neighbor_ident.h>
 #include <osmocom/bsc/osmux.h>
 
@@ -47,6 +51,7 @@ struct osmo_mgcpc_ep;
 #define OBSC_NM_W_ACK_CB(__msgb) (__msgb)->cb[3]
 
 struct bsc_subscr;
+struct bsc_subscr_store;
 struct gprs_ra_id;
 struct handover;
 
@@ -71,14 +76,14 @@ typedef int gsm_cbfn(unsigned int hooknum,
 #define MAX_NEIGH_MEAS		10
 /* Maximum size of the averaging window for neighbor cells */
 #define MAX_WIN_NEIGH_AVG	10
-/* Maximum number of report history we store */
-#define MAX_MEAS_REP		10
 
-/* processed neighbor measurements for one cell */
+/* processed neighbor measurements for one cell, see neigh_meas_process() */
 struct neigh_meas_proc {
 	uint16_t arfcn;
 	uint8_t bsic;
 	uint8_t rxlev[MAX_WIN_NEIGH_AVG];
+	/* running total of rxlev after the report numbered rxlev_cnt, at [rxlev_cnt % (MAX_WIN_NEIGH_AVG + 1)] */
+	uint16_t rxlev_sum[MAX_WIN_NEIGH_AVG + 1];
 	unsigned int rxlev_cnt;
 	uint8_t last_seen_nr;
 };
@@ -98,6 +103,13 @@ enum subscr_sccp_state {
 	SUBSCR_SCCP_ST_CONNECTED
 };
 
+enum bsc_msc_selection {
+	/* take turns */
+	BSC_MSC_SELECTION_ROUND_ROBIN,
+	/* the ready MSC with the lowest bsc_msc_load_score() */
+	BSC_MSC_SELECTION_LOAD_BASED,
+};
+
 enum channel_rate {
 	CH_RATE_SDCCH,
 	CH_RATE_HALF,
@@ -268,9 +280,14 @@ struct gsm_subscriber_connection {
 		/* SCCP connection related */
 		struct bsc_msc_data *msc;
 
-		/* Sigtran connection ID */
+		/* Sigtran connection ID, see sccp_conn_id_set() */
 		int conn_id;
+		/* entry in gsm_network.sccp_conn_ids.by_id */
+		struct llist_head conn_id_entry;
+		/* set by gscon_sccp_state_set() only, which keeps the MSC's load counters */
 		enum subscr_sccp_state state;
+		/* when the N-CONNECT.req was sent, to measure the MSC's response latency */
+		struct timespec conn_req_sent;
 	} sccp;
 
 	/* for audio handling */
@@ -335,6 +352,9 @@ enum gsm_chreq_reason_t {
 #define TRX_NR_TS	8
 #define TS_MAX_LCHAN	8
 
+/* gsm_bts.chan_rqd_cache has 1 << CHAN_RQD_CACHE_BITS entries */
+#define CHAN_RQD_CACHE_BITS 6
+
 #define HARDCODED_ARFCN 123
 #define HARDCODED_BSIC	0x3f	/* NCC = 7 / BCC = 7 */
 
@@ -630,9 +650,8 @@ struct gsm_lchan {
 	/* table of neighbor cell measurements */
 	struct neigh_meas_proc neigh_meas[MAX_NEIGH_MEAS];
 
-	/* cache of last measurement reports on this lchan */
-	struct gsm_meas_rep meas_rep[MAX_MEAS_REP];
-	int meas_rep_idx;
+	/* history of the last measurement reports on this lchan, NULL while the lchan is unused */
+	struct lchan_meas_hist *meas_hist;
 	int meas_rep_count;
 	uint8_t meas_rep_last_seen_nr;
 
@@ -650,6 +669,16 @@ struct gsm_lchan {
 	struct channel_mode_and_rate ch_mode_rate;
 };
 
+/* Channel load counter */
+struct load_counter {
+	unsigned int total;
+	unsigned int used;
+};
+
+struct pchan_load {
+	struct load_counter pchan[_GSM_PCHAN_MAX];
+};
+
 /* One Timeslot in a TRX */
 struct gsm_bts_trx_ts {
 	struct gsm_bts_trx *trx;
@@ -675,12 +704,34 @@ struct gsm_bts_trx_ts {
 	 * Also marks a timeslot where PDCH was deactivated by VTY. This is cleared whenever a timeslot
 	 * enters IN_USE state, i.e. after each TCH use we try to PDCH ACT once again. */
 	bool pdch_act_allowed;
+	/* Kept out of PDCH by the BTS' dyn_ts_reserve, in anticipation of a TCH request. Cleared when the
+	 * timeslot enters IN_USE state. */
+	bool tch_reserved;
+	/* When the last PDCH deactivation was sent, to measure its round trip */
+	struct timespec pdch_deact_start;
 
 	/* Whether TS_EV_OML_READY was received */
 	bool is_oml_ready;
 	/* Whether TS_EV_RSL_READY was received */
 	bool is_rsl_ready;
 
+	/* What this timeslot currently contributes to its BTS' chan_load, counted for the pchan it
+	 * had when last updated; see ts_chan_load_update(). */
+	struct {
+		enum gsm_phys_chan_config pchan;
+		struct load_counter lc;
+	} chan_load;
+	/* Whether and for which pchan this timeslot is marked in its BTS' free_ts bitmaps */
+	struct {
+		bool marked;
+		enum gsm_phys_chan_config pchan;
+	} free_ts;
+	/* What this timeslot currently contributes to its BTS' free_tch; see ts_free_tch_update(). */
+	struct {
+		int tch_f;
+		int tch_h;
+	} free_tch;
+
 	struct gsm_abis_mo mo;
 	struct tlv_parsed nm_attr;
 	uint8_t nm_chan_comb;
@@ -769,11 +820,31 @@ struct gsm_bts_trx {
 		} rbs2000;
 	};
 	struct gsm_bts_trx_ts ts[TRX_NR_TS];
+
+	/* The SI last sent to this TRX per type, so that unchanged SI are not sent again, see
+	 * gsm_bts_update_system_infos(). Cleared by gsm_bts_trx_set_system_infos(). */
+	struct {
+		/* bitmask of the SI types that len[] and buf[] are valid for */
+		uint32_t valid;
+		/* length as sent, 0 if sent empty to switch the SI off */
+		int len[_MAX_SYSINFO_TYPE];
+		sysinfo_buf_t buf[_MAX_SYSINFO_TYPE];
+		/* all SI2quater messages sent */
+		uint8_t si2q_count;
+		sysinfo_buf_t si2q[SI2Q_MAX_NUM];
+	} si_sent;
 };
 
 #define GSM_BTS_SI2Q(bts, i)   (struct gsm48_system_information_type_2quater *)((bts)->si_buf[SYSINFO_TYPE_2quater][i])
 #define GSM_BTS_HAS_SI(bts, i) ((bts)->si_valid & (1 << i))
 #define GSM_BTS_SI(bts, i)     (void *)((bts)->si_buf[i][0])
+
+/* Which SI types to regenerate on which kind of change, for gsm_bts_update_system_infos() */
+#define SI_MASK(i)		(1 << (i))
+/* The RACH Control Parameters, i.e. ACC barring and ramping */
+#define SI_DIRTY_ACC		(SI_MASK(SYSINFO_TYPE_1) | SI_MASK(SYSINFO_TYPE_2) | SI_MASK(SYSINFO_TYPE_2bis) \
+				 | SI_MASK(SYSINFO_TYPE_2ter) | SI_MASK(SYSINFO_TYPE_3) | SI_MASK(SYSINFO_TYPE_4))
+#define SI_DIRTY_ALL		0xffffffff
 #define GSM_LCHAN_SI(lchan, i) (void *)((lchan)->si.buf[i][0])
 
 enum gsm_bts_type {
@@ -804,6 +875,17 @@ enum bts_attribute {
 
 struct vty;
 
+/* Upper limit of the 'oml window', i.e. of OML requests awaiting a response per BTS */
+#define ABIS_NM_WINDOW_MAX 32
+
+/* An ACK-requiring OML request sent to the BTS, matched against the response by object */
+struct abis_nm_pend_req {
+	uint8_t msg_type;
+	uint8_t obj_class;
+	struct abis_om_obj_inst obj_inst;
+	struct timespec tx_time;
+};
+
 struct gsm_bts_model {
 	struct llist_head list;
 
@@ -825,6 +907,10 @@ struct gsm_bts_model {
 	/* Should SI2bis and SI2ter be disabled by default on this BTS model? */
 	bool force_combined_si;
 
+	/* How many ACK-requiring OML requests this BTS model handles in flight at the same time, up to
+	 * ABIS_NM_WINDOW_MAX. 0 means strict stop-and-wait, whatever 'oml window' is configured. */
+	unsigned int oml_window_max;
+
 	struct tlv_definition nm_att_tlvdef;
 
 	/* features of a given BTS model set via gsm_bts_model_register() locally */
@@ -842,11 +928,18 @@ struct gsm_bts_model {
 struct gsm_bts_paging_state {
 	/* pending requests */
 	struct llist_head pending_requests;
+	unsigned int pending_requests_len;
+	/* the same pending requests, hashed by their bsc_subscr pointer */
+	DECLARE_HASHTABLE(pending_requests_by_bsub, 8);
 	struct gsm_bts *bts;
 
 	struct osmo_timer_list work_timer;
 	struct osmo_timer_list credit_timer;
 
+	/* pending requests in order of T3113 expiry, served by a single timer */
+	struct llist_head T3113_queue;
+	struct osmo_timer_list T3113_timer;
+
 	/* free chans needed */
 	int free_chans_need;
 
@@ -938,12 +1031,6 @@ struct bts_location {
 	double height;
 };
 
-/* Channel load counter */
-struct load_counter {
-	unsigned int total;
-	unsigned int used;
-};
-
 /* Useful to track N-N relations between BTS, for example neighbors. */
 struct gsm_bts_ref {
 	struct llist_head entry;
@@ -1019,9 +1106,15 @@ struct gsm_bts {
 	uint16_t cell_identity;
 	/* location area code of this BTS */
 	uint16_t location_area_code;
+	/* entries in gsm_network.bts_by_lac, bts_by_lac_ci and bts_by_ci, see gsm_bts_set_lac() */
+	struct llist_head lac_entry;
+	struct llist_head lac_ci_entry;
+	struct llist_head ci_entry;
 	/* Base Station Identification Code (BSIC), lower 3 bits is BCC,
 	 * which is used as TSC for the CCCH */
 	uint8_t bsic;
+	/* entry in gsm_network.bts_by_arfcn_bsic, see gsm_bts_set_bsic() */
+	struct llist_head arfcn_bsic_entry;
 	/* type of BTS */
 	enum gsm_bts_type type;
 	enum gsm_bts_type_variant variant;
@@ -1073,6 +1166,10 @@ struct gsm_bts {
 
 	/* bitmask of all SI that are present/valid in si_buf */
 	uint32_t si_valid;
+	/* bitmask of the SI in si_buf that need to be regenerated, see SI_DIRTY_* */
+	uint32_t si_dirty;
+	/* length of each SI in si_buf, as generated */
+	int si_len[_MAX_SYSINFO_TYPE];
 	/* 3GPP TS 44.018 Table 10.5.2.33b.1 INDEX and COUNT for SI2quater */
 	uint8_t si2q_index; /* distinguish individual SI2quater messages */
 	uint8_t si2q_count; /* si2q_index for the last (highest indexed) individual SI2quater message */
@@ -1187,7 +1284,29 @@ struct gsm_bts {
 
 	/* Abis NM queue */
 	struct llist_head abis_queue;
-	int abis_nm_pend;
+	/* ACK-requiring OML requests sent and awaiting a response, oldest first */
+	struct abis_nm_pend_req abis_nm_pend[ABIS_NM_WINDOW_MAX];
+	unsigned int abis_nm_pend_count;
+	/* Configured number of OML requests that may await a response at the same time, limited by
+	 * gsm_bts_model.oml_window_max. */
+	unsigned int oml_window;
+	/* Software load state, allocated by the first abis_nm_software_load() */
+	struct abis_nm_sw *sw_load;
+	/* Place in the fleet-wide bring-up order, see bts_admission.c */
+	struct bts_admission admission;
+	/* OML bring-up timing, from the first request after the OML link came up until the request queue
+	 * last drained; reset by abis_nm_clear_queue(). */
+	struct {
+		bool started;
+		struct timespec first_tx;
+		struct timespec last_drained;
+		unsigned int requests;
+		unsigned int responses;
+		unsigned int unmatched;
+		unsigned int max_pend;
+		uint64_t rtt_sum_us;
+		uint32_t rtt_max_us;
+	} oml_bringup;
 
 	struct gsm_network *network;
 
@@ -1231,6 +1350,9 @@ struct gsm_bts {
 
 	/* access control class ramping */
 	struct acc_ramp acc_ramp;
+	/* Bars ACCs and stretches T3122 while the CCCH is overloaded */
+	struct ccch_overload ccch_overload;
+	struct dyn_ts_reserve dyn_ts_reserve;
 
 	/* exclude the BTS from the global RF Lock handling */
 	int excl_from_rf_lock;
@@ -1263,6 +1385,43 @@ struct gsm_bts {
 	uint8_t T3122;	/* ASSIGNMENT REJECT wait indication */
 	bool T3113_dynamic; /* Calculate T3113 timeout dynamically based on BTS channel config and load */
 
+	/* Current channel load, the sum of all timeslots' chan_load. Kept up to date by
+	 * ts_chan_load_update() on lchan and timeslot state changes, read by bts_chan_load(). */
+	struct pchan_load chan_load;
+
+	/* Timeslots that are usable and have at least one UNUSED lchan, one bitmap per ts->pchan_on_init,
+	 * bit number trx->nr * TRX_NR_TS + ts->nr. Kept up to date by ts_free_lchans_update(), so that
+	 * lchan_select.c only needs to look at timeslots that can actually provide an lchan. */
+	struct {
+		uint64_t *map[_GSM_PCHAN_MAX];
+		unsigned int words;
+		/* TRX by number, to get from a bit number back to the timeslot */
+		struct gsm_bts_trx **trx;
+	} free_ts;
+
+	/* Free TCH/F and TCH/H as counted by bts_count_free_ts(), the sum of all timeslots' free_tch. Kept
+	 * up to date by ts_free_tch_update(), so that the handover congestion check and candidate
+	 * evaluation need not scan all timeslots of a BTS. */
+	struct {
+		int tch_f;
+		int tch_h;
+	} free_tch;
+
+	/* The lchan last activated for an MS channel request, by hash of its Request Reference. A BTS may
+	 * report the same access burst more than once; while that lchan is still being assigned, the repeated
+	 * CHAN RQD is answered from it instead of allocating another one. Only a hint: whether the lchan still
+	 * serves that request is checked against lchan->rqd_ref. */
+	struct gsm_lchan *chan_rqd_cache[1 << CHAN_RQD_CACHE_BITS];
+
+	/* Request References to be rejected in the next IMMEDIATE ASSIGN REJECT, with their wait indications.
+	 * Sent by rsl_tx_imm_ass_rej() once four are collected, or when the timer T993122 expires. */
+	struct {
+		struct gsm48_req_ref ref[4];
+		uint8_t wait_ind[4];
+		unsigned int count;
+		struct osmo_timer_list timer;
+	} imm_ass_rej;
+
 	/* Periodic channel load measurements are used to maintain T3122. */
 	struct load_counter chan_load_samples[7];
 	int chan_load_samples_idx;
@@ -1297,6 +1456,7 @@ bool gsm_bts_matches_cell_id(const struct gsm_bts *bts, const struct gsm0808_cel
 struct gsm_bts *gsm_bts_by_cell_id(const struct gsm_network *net,
 				   const struct gsm0808_cell_id *cell_id,
 				   int match_idx);
+struct gsm_bts_ref *gsm_bts_ref_find(const struct llist_head *list, const struct gsm_bts *bts);
 int gsm_bts_local_neighbor_add(struct gsm_bts *bts, struct gsm_bts *neighbor);
 int gsm_bts_local_neighbor_del(struct gsm_bts *bts, const struct gsm_bts *neighbor);
 
@@ -1426,6 +1586,17 @@ enum bts_counter_id {
 	BTS_CTR_TS_BORKEN_EV_PDCH_ACT_ACK_NACK,
 	BTS_CTR_TS_BORKEN_EV_PDCH_DEACT_ACK_NACK,
 	BTS_CTR_TS_BORKEN_EV_TEARDOWN,
+	BTS_CTR_PAGING_SENT,
+	BTS_CTR_SI_GENERATED,
+	BTS_CTR_SI_SENT,
+	BTS_CTR_SI_SKIPPED,
+	BTS_CTR_CHREQ_DUPLICATE,
+	BTS_CTR_IMM_ASS_REJ_SENT,
+	BTS_CTR_IMM_ASS_REJ_COALESCED,
+	BTS_CTR_AGCH_DELETE_IND,
+	BTS_CTR_DYN_TS_RESERVE_HIT,
+	BTS_CTR_DYN_TS_RESERVE_SAVED_MS,
+	BTS_CTR_DYN_TS_RESERVE_PDCH_LOST,
 };
 
 static const struct rate_ctr_desc bts_ctr_description[] = {
@@ -1475,6 +1646,17 @@ static const struct rate_ctr_desc bts_ctr_description[] = {
 	[BTS_CTR_TS_BORKEN_EV_PDCH_ACT_ACK_NACK] =   {"ts_borken:event:pdch_act_ack_nack", "PDCH_ACT_ACK/NACK received in the TS BORKEN state"},
 	[BTS_CTR_TS_BORKEN_EV_PDCH_DEACT_ACK_NACK] = {"ts_borken:event:pdch_deact_ack_nack", "PDCH_DEACT_ACK/NACK received in the TS BORKEN state"},
 	[BTS_CTR_TS_BORKEN_EV_TEARDOWN] =            {"ts_borken:event:teardown", "TS in a BORKEN state is shutting down (BTS disconnected?)"},
+	[BTS_CTR_PAGING_SENT] =			{"paging:sent", "PAGING CMD messages sent to the BTS."},
+	[BTS_CTR_SI_GENERATED] =		{"si:generated", "System Information messages regenerated"},
+	[BTS_CTR_SI_SENT] =			{"si:sent", "System Information messages sent to a TRX"},
+	[BTS_CTR_SI_SKIPPED] =			{"si:skipped", "System Information messages not sent again because unchanged"},
+	[BTS_CTR_CHREQ_DUPLICATE] = 		{"chreq:duplicate", "Channel requests for an access burst already reported (same RA and frame number), answered without allocating another channel."},
+	[BTS_CTR_IMM_ASS_REJ_SENT] = 		{"imm_ass_rej:sent", "IMMEDIATE ASSIGN REJECT messages sent to the BTS."},
+	[BTS_CTR_IMM_ASS_REJ_COALESCED] = 	{"imm_ass_rej:coalesced", "Request References rejected together with others in one IMMEDIATE ASSIGN REJECT, each saving an AGCH block."},
+	[BTS_CTR_AGCH_DELETE_IND] = 		{"agch:delete_ind", "IMMEDIATE ASSIGN messages dropped by the BTS for lack of AGCH capacity (DELETE IND)."},
+	[BTS_CTR_DYN_TS_RESERVE_HIT] =		{"dyn_ts_reserve:hit", "TCH activations on a dynamic timeslot that was already switched out of PDCH."},
+	[BTS_CTR_DYN_TS_RESERVE_SAVED_MS] =	{"dyn_ts_reserve:saved_ms", "TCH setup time saved by not waiting for PDCH deactivation, in ms."},
+	[BTS_CTR_DYN_TS_RESERVE_PDCH_LOST] =	{"dyn_ts_reserve:pdch_lost", "Seconds that idle dynamic timeslots were kept out of PDCH, summed over all timeslots."},
 };
 
 static const struct rate_ctr_group_desc bts_ctrg_desc = {
@@ -1510,6 +1692,10 @@ enum {
 	BTS_STAT_RSL_CONNECTED,
 	BTS_STAT_LCHAN_BORKEN,
 	BTS_STAT_TS_BORKEN,
+	BTS_STAT_PAGING_REQ_QUEUE_LENGTH,
+	BTS_STAT_PAGING_FIRST_TX_DELAY,
+	BTS_STAT_CCCH_OVERLOAD_BARRED,
+	BTS_STAT_DYN_TS_RESERVED,
 };
 
 enum {
@@ -1614,6 +1800,18 @@ struct gsm_tz {
 	int dst; /* daylight savings */
 };
 
+/* Timing of hodec2_congestion_check(), see CTRL congestion-check-stats */
+struct hodec2_congestion_check_stats {
+	unsigned long runs;
+	/* of the most recent run */
+	unsigned int congested_bts;
+	unsigned int candidates;
+	unsigned long last_us;
+	/* over all runs */
+	unsigned long max_us;
+	unsigned long long total_us;
+};
+
 struct gsm_network {
 	/* TODO MSCSPLIT the gsm_network struct is basically a kitchen sink for
 	 * global settings and variables, "madly" mixing BSC and MSC stuff. Split
@@ -1631,6 +1829,7 @@ struct gsm_network {
 	struct {
 		unsigned int congestion_check_interval_s;
 		struct osmo_timer_list congestion_check_timer;
+		struct hodec2_congestion_check_stats congestion_check_stats;
 	} hodec2;
 
 	/* structures for keeping rate counters and gauge stats */
@@ -1640,6 +1839,14 @@ struct gsm_network {
 	unsigned int num_bts;
 	struct llist_head bts_list;
 	struct llist_head bts_rejected;
+	/* limits how many BTS run their bring-up at the same time */
+	struct bts_admission_sched bts_admission;
+	/* the BTS of bts_list indexed by cell identity, each bucket in BTS number order */
+	DECLARE_HASHTABLE(bts_by_lac, 8);
+	DECLARE_HASHTABLE(bts_by_lac_ci, 8);
+	DECLARE_HASHTABLE(bts_by_ci, 8);
+	/* the same BTS indexed by BCCH ARFCN and BSIC, as seen in Measurement Reports */
+	DECLARE_HASHTABLE(bts_by_arfcn_bsic, 8);
 
 	/* see gsm_network_T_defs */
 	struct osmo_tdef *T_defs;
@@ -1651,6 +1858,8 @@ struct gsm_network {
 
 	/* msc configuration */
 	struct llist_head mscs;
+	/* how to pick the MSC for a new MS originated connection */
+	enum bsc_msc_selection msc_selection;
 
 	/* rf ctl related bits */
 	int mid_call_timeout;
@@ -1669,6 +1878,12 @@ struct gsm_network {
 	/* all active subscriber connections. */
 	struct llist_head subscr_conns;
 
+	/* the same subscriber connections, indexed by SCCP connection id, see sccp_conn_id.c */
+	struct {
+		DECLARE_HASHTABLE(by_id, 12);
+		uint32_t last_picked;
+	} sccp_conn_ids;
+
 	/* if override is nonzero, this timezone data is used for all MM
 	 * contexts. */
 	/* TODO: in OsmoNITB, tz-override used to be BTS-specific. To enable
@@ -1676,13 +1891,13 @@ struct gsm_network {
 	 * OsmoMSC, this should be tied to the location area code (LAC). */
 	struct gsm_tz tz;
 
-	/* List of all struct bsc_subscr used in libbsc. This llist_head is
-	 * allocated so that the llist_head pointer itself can serve as a
+	/* All struct bsc_subscr used in libbsc, indexed by IMSI and TMSI. The
+	 * store is allocated so that its pointer itself can serve as a
 	 * talloc context (useful to not have to pass the entire gsm_network
 	 * struct to the bsc_subscr_* API, and for bsc_susbscr unit tests to
 	 * not require gsm_data.h). In an MSC-without-BSC environment, this
 	 * pointer is NULL to indicate absence of a bsc_subscribers list. */
-	struct llist_head *bsc_subscribers;
+	struct bsc_subscr_store *bsc_subscribers;
 
 	/* Timer for periodic channel load measurements to maintain each BTS's T3122. */
 	struct osmo_timer_list t3122_chan_load_timer;
@@ -1721,8 +1936,35 @@ int gsm_set_bts_type(struct gsm_bts *bts, enum gsm_bts_type type);
 
 enum gsm_bts_type parse_btstype(const char *arg);
 const char *btstype2str(enum gsm_bts_type type);
-struct gsm_bts *gsm_bts_by_lac(struct gsm_network *net, unsigned int lac,
-				struct gsm_bts *start_bts);
+struct gsm_bts *gsm_bts_by_lac(const struct gsm_network *net, unsigned int lac,
+				const struct gsm_bts *start_bts);
+struct gsm_bts *gsm_bts_by_lac_ci(const struct gsm_network *net, uint16_t lac, uint16_t ci,
+				  const struct gsm_bts *start_bts);
+struct gsm_bts *gsm_bts_by_ci(const struct gsm_network *net, uint16_t ci,
+			      const struct gsm_bts *start_bts);
+void gsm_bts_cell_index_init(struct gsm_network *net);
+void gsm_bts_set_lac(struct gsm_bts *bts, uint16_t lac);
+void gsm_bts_set_ci(struct gsm_bts *bts, uint16_t ci);
+struct gsm_bts *gsm_bts_by_arfcn_bsic(const struct gsm_network *net, uint16_t arfcn, uint8_t bsic,
+				      const struct gsm_bts *start_bts);
+void gsm_bts_set_bsic(struct gsm_bts *bts, uint8_t bsic);
+void gsm_bts_trx_set_arfcn(struct gsm_bts_trx *trx, uint16_t arfcn);
+
+/* Iterate all BTS configured with the given LAC. Unlike gsm_bts_by_lac(), GSM_LAC_RESERVED_ALL_BTS
+ * matches no BTS here. */
+#define gsm_bts_for_each_by_lac(net, bts, lac) \
+	for (bts = ((lac) == GSM_LAC_RESERVED_ALL_BTS) ? NULL : gsm_bts_by_lac(net, lac, NULL); \
+	     bts; bts = gsm_bts_by_lac(net, lac, bts))
+
+#define gsm_bts_for_each_by_lac_ci(net, bts, lac, ci) \
+	for (bts = gsm_bts_by_lac_ci(net, lac, ci, NULL); bts; bts = gsm_bts_by_lac_ci(net, lac, ci, bts))
+
+#define gsm_bts_for_each_by_ci(net, bts, ci) \
+	for (bts = gsm_bts_by_ci(net, ci, NULL); bts; bts = gsm_bts_by_ci(net, ci, bts))
+
+#define gsm_bts_for_each_by_arfcn_bsic(net, bts, arfcn, bsic) \
+	for (bts = gsm_bts_by_arfcn_bsic(net, arfcn, bsic, NULL); bts; \
+	     bts = gsm_bts_by_arfcn_bsic(net, arfcn, bsic, bts))
 
 extern void *tall_bsc_ctx;
 
@@ -1823,6 +2065,7 @@ void gsm_trx_lock_rf(struct gsm_bts_trx *trx, bool locked, const char *reason);
 struct gsm_bts_trx *gsm_bts_trx_by_nr(struct gsm_bts *bts, int nr);
 int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx);
 int gsm_bts_set_system_infos(struct gsm_bts *bts);
+int gsm_bts_update_system_infos(struct gsm_bts *bts, uint32_t si_dirty);
 
 /* generic E1 line operations for all ISDN-based BTS. */
 extern struct e1inp_line_ops bts_isdn_e1inp_line_ops;
@@ -1849,6 +2092,17 @@ void gsm_bts_set_radio_link_timeout(struct gsm_bts *bts, int value);
 bool trx_is_usable(const struct gsm_bts_trx *trx);
 bool ts_is_usable(const struct gsm_bts_trx_ts *ts);
 
+void ts_chan_load_count(struct load_counter *lc, struct gsm_bts_trx_ts *ts);
+void ts_chan_load_update(struct gsm_bts_trx_ts *ts);
+void trx_chan_load_update(struct gsm_bts_trx *trx);
+void bts_chan_load_update(struct gsm_bts *bts);
+void ts_free_lchans_update(struct gsm_bts_trx_ts *ts);
+void ts_free_tch_update(struct gsm_bts_trx_ts *ts);
+void ts_avail_update(struct gsm_bts_trx_ts *ts);
+void bts_avail_update(struct gsm_bts *bts);
+struct gsm_bts_trx_ts *bts_free_ts_next(const struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
+					int *bit, bool reverse);
+
 int gsm_lchan_type_by_pchan(enum gsm_phys_chan_config pchan);
 enum gsm_phys_chan_config gsm_pchan_by_lchan_type(enum gsm_chan_t type);
 
@@ -1856,6 +2110,8 @@ void gsm_bts_all_ts_dispatch(struct gsm_bts *bts, uint32_t ts_ev, void *data);
 void gsm_trx_all_ts_dispatch(struct gsm_bts_trx *trx, uint32_t ts_ev, void *data);
 
 int bts_count_free_ts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan);
+int bts_count_free_ts_scan(struct gsm_bts *bts, enum gsm_phys_chan_config pchan);
+bool bts_free_tch_check(struct gsm_bts *bts);
 
 bool trx_has_valid_pchan_config(const struct gsm_bts_trx *trx);
 
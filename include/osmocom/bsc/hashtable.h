@@ -0,0 +1,106 @@
+/* Minimal fixed-size hash tables, modelled after the Linux kernel's linux/hashtable.h */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/utils.h>
+
+/* A hash table is a power-of-two sized array of llist_head buckets. Entries embed a struct llist_head that
+ * is added to the bucket their key hashes to. Unlike the kernel version, buckets are plain doubly linked
+ * llists, so an entry can be removed with hash_del() without knowing its table. */
+
+#define DECLARE_HASHTABLE(name, bits) \
+	struct llist_head name[1 << (bits)]
+
+#define HASH_SIZE(name) (ARRAY_SIZE(name))
+#define HASH_BITS(name) ((unsigned int)__builtin_ctz(HASH_SIZE(name)))
+
+#define GOLDEN_RATIO_32 0x61C88647
+#define GOLDEN_RATIO_64 0x61C8864680B583EBull
+
+static inline uint32_t hash_32(uint32_t val, unsigned int bits)
+{
+	return (val * GOLDEN_RATIO_32) >> (32 - bits);
+}
+
+static inline uint32_t hash_64(uint64_t val, unsigned int bits)
+{
+	return (uint32_t)((val * GOLDEN_RATIO_64) >> (64 - bits));
+}
+
+/* Hash a NUL terminated string (FNV-1a), e.g. an IMSI */
+static inline uint32_t hash_str(const char *str, unsigned int bits)
+{
+	uint32_t h = 2166136261u;
+	while (*str) {
+		h ^= (uint8_t)*str++;
+		h *= 16777619u;
+	}
+	return hash_32(h, bits);
+}
+
+/* Pick the hash function by the size of the integer key. To key by pointer, pass (uintptr_t)ptr. */
+#define hash_min(val, bits) \
+	(sizeof(val) <= 4 ? hash_32(val, bits) : hash_64(val, bits))
+
+#define hash_init(hashtable) \
+	do { \
+		unsigned int __i; \
+		for (__i = 0; __i < HASH_SIZE(hashtable); __i++) \
+			INIT_LLIST_HEAD(&(hashtable)[__i]); \
+	} while (0)
+
+/*! Bucket of \a hashtable that integer \a key hashes to. Tables keyed by strings use
+ * &hashtable[hash_str(str, HASH_BITS(hashtable))] instead. */
+#define hash_bucket(hashtable, key) \
+	(&(hashtable)[hash_min(key, HASH_BITS(hashtable))])
+
+/*! Add an entry with integer \a key to \a hashtable */
+#define hash_add(hashtable, node, key) \
+	llist_add(node, hash_bucket(hashtable, key))
+
+/*! Remove an entry from the hash table it is in; safe to call again on a removed entry */
+static inline void hash_del(struct llist_head *node)
+{
+	llist_del(node);
+	INIT_LLIST_HEAD(node);
+}
+
+/*! Whether the entry is currently in a hash table, i.e. was initialized with INIT_LLIST_HEAD() and
+ * has not been hash_del()ed since the last hash_add(). */
+static inline bool hash_hashed(const struct llist_head *node)
+{
+	return !llist_empty(node);
+}
+
+/*! Iterate over all entries that integer \a key may match; callers still need to compare the key */
+#define hash_for_each_possible(hashtable, obj, member, key) \
+	llist_for_each_entry(obj, hash_bucket(hashtable, key), member)
+
+#define hash_for_each_possible_safe(hashtable, obj, tmp, member, key) \
+	llist_for_each_entry_safe(obj, tmp, hash_bucket(hashtable, key), member)
+
+/*! Iterate over all entries of \a hashtable, \a bkt is an unsigned int cursor */
+#define hash_for_each(hashtable, bkt, obj, member) \
+	for ((bkt) = 0; (bkt) < HASH_SIZE(hashtable); (bkt)++) \
+		llist_for_each_entry(obj, &(hashtable)[bkt], member)
@@ -0,0 +1,99 @@
+/* Latency profiler for the handlers run from the osmo-bsc main loop */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+/*!
+ * While enabled, the latency profiler times each call of the main message handlers and keeps a histogram
+ * per handler and message type. The main loop itself is probed by a timer that measures how late it fires,
+ * i.e. how long the loop was busy with other work. While disabled, each handler call costs one check of
+ * latency_prof_enabled.
+ */
+
+enum latency_prof_handler {
+	LATENCY_PROF_LOOP,
+	LATENCY_PROF_RSL,
+	LATENCY_PROF_OML,
+	LATENCY_PROF_BSSMAP_UDT,
+	LATENCY_PROF_BSSMAP_DT,
+	LATENCY_PROF_DTAP,
+	LATENCY_PROF_PCU,
+	LATENCY_PROF_HODEC2_CONGESTION,
+	_NUM_LATENCY_PROF_HANDLERS
+};
+
+extern const struct value_string latency_prof_handler_names[];
+static inline const char *latency_prof_handler_name(enum latency_prof_handler handler)
+{
+	return get_value_string(latency_prof_handler_names, handler);
+}
+
+/* Bucket 0 counts durations below 1 us, bucket i > 0 those from 2^(i-1) up to below 2^i us; the last bucket
+ * also counts everything longer. */
+#define LATENCY_PROF_BUCKETS 21
+/* ms between main loop probes */
+#define LATENCY_PROF_PROBE_INTERVAL 100
+
+struct latency_hist {
+	uint64_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+	uint32_t bucket[LATENCY_PROF_BUCKETS];
+};
+
+extern bool latency_prof_enabled;
+
+void latency_prof_init(void *ctx);
+void latency_prof_enable(bool enable);
+void latency_prof_reset(void);
+
+void _latency_prof_record(enum latency_prof_handler handler, uint8_t msg_type, const struct timespec *start);
+
+/*! Take the start time of a handler call; only reads the clock while the profiler is enabled */
+static inline void latency_prof_start(struct timespec *start)
+{
+	if (latency_prof_enabled)
+		osmo_clock_gettime(CLOCK_MONOTONIC, start);
+	else
+		*start = (struct timespec){};
+}
+
+/*! Account the time since \a start to \a handler and \a msg_type */
+static inline void latency_prof_stop(enum latency_prof_handler handler, uint8_t msg_type,
+				     const struct timespec *start)
+{
+	if (latency_prof_enabled)
+		_latency_prof_record(handler, msg_type, start);
+}
+
+const struct latency_hist *latency_prof_get(enum latency_prof_handler handler, uint8_t msg_type);
+const struct latency_hist *latency_prof_total(enum latency_prof_handler handler);
+bool latency_prof_has_msg_types(enum latency_prof_handler handler);
+const char *latency_prof_msg_type_name(enum latency_prof_handler handler, uint8_t msg_type);
+
+uint32_t latency_hist_avg_us(const struct latency_hist *h);
+uint32_t latency_hist_percentile_us(const struct latency_hist *h, unsigned int percent);
+uint32_t latency_hist_bucket_limit_us(unsigned int bucket);
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
 
 #include <osmocom/bsc/meas_rep.h>
 
@@ -32,12 +36,147 @@ struct meas_feed_meas {
 
 enum meas_feed_msgtype {
 	MEAS_FEED_MEAS		= 0,
+	MEAS_FEED_MEAS_BATCH	= 1,
 };
 
+/* Version 1 is a single struct meas_feed_meas per datagram, in host byte order and with host struct
+ * layout. Its hdr.version is in host byte order, too. */
 #define MEAS_FEED_VERSION	1
 
+/* Version 2 datagrams are a struct meas_feed_v2_batch followed by num_meas records. Each record is a
+ * struct meas_feed_v2_meas followed by num_cell struct meas_feed_v2_cell, or by none if num_cell is 7.
+ * Everything is packed, multi-byte fields are in network byte order, including hdr.version. */
+#define MEAS_FEED_VERSION_2	2
+
+/* Default for how long a v2 report may wait for its batch to fill up, in milliseconds */
+#define MEAS_FEED_BATCH_INTERVAL_DEFAULT	100
+
+/* Largest v2 datagram, chosen to stay below a typical path MTU */
+#define MEAS_FEED_V2_MAX_LEN	1400
+
+struct meas_feed_v2_batch {
+	/* msg_type = MEAS_FEED_MEAS_BATCH, version = htons(MEAS_FEED_VERSION_2) */
+	struct meas_feed_hdr hdr;
+	char scenario[31+1];
+	uint8_t num_meas;
+	uint8_t data[0];
+} __attribute__((packed));
+
+struct meas_feed_v2_rx_lev_qual {
+	int8_t rx_lev;
+	int8_t rx_qual;
+} __attribute__((packed));
+
+struct meas_feed_v2_meas {
+	/* IMSI digits, empty if not known */
+	char imsi[15+1];
+	/* TMSI, GSM_RESERVED_TMSI if not known */
+	uint32_t tmsi;
+	/* enum gsm_chan_t, enum gsm_phys_chan_config, and where the lchan is */
+	uint8_t lchan_type;
+	uint8_t pchan_type;
+	uint8_t bts_nr;
+	uint8_t trx_nr;
+	uint8_t ts_nr;
+	uint8_t ss_nr;
+	/* fields of struct gsm_meas_rep */
+	uint8_t nr;
+	/* MEAS_REP_F_* */
+	uint8_t flags;
+	struct meas_feed_v2_rx_lev_qual ul_full;
+	struct meas_feed_v2_rx_lev_qual ul_sub;
+	struct meas_feed_v2_rx_lev_qual dl_full;
+	struct meas_feed_v2_rx_lev_qual dl_sub;
+	uint8_t bs_power;
+	int16_t ms_timing_offset;
+	int8_t ms_l1_pwr;
+	uint8_t ms_l1_ta;
+	/* number of neighbor cells that follow; 7 means no neighbor information, and no cells follow */
+	uint8_t num_cell;
+	uint8_t data[0];
+} __attribute__((packed));
+
+struct meas_feed_v2_cell {
+	uint16_t arfcn;
+	uint8_t rxlev;
+	uint8_t bsic;
+	uint8_t neigh_idx;
+} __attribute__((packed));
+
+/*! Decode one v2 record from a batch into the v1 representation, so that feed consumers can handle both
+ * versions the same way. mfm->name is derived from IMSI and TMSI the way bsc_subscr_name() does.
+ * \param[out] mfm  decoded record; mfm->hdr and mfm->scenario are left untouched.
+ * \param[in] data  start of the record.
+ * \param[in] len  remaining length of the datagram from data on.
+ * \returns length of the record, or a negative value if the datagram is truncated. */
+static inline int meas_feed_v2_meas_decode(struct meas_feed_meas *mfm, const uint8_t *data, size_t len)
+{
+	const struct meas_feed_v2_meas *m = (const struct meas_feed_v2_meas *) data;
+	const struct meas_feed_v2_cell *c;
+	struct gsm_meas_rep *mr = &mfm->mr;
+	unsigned int num_cell;
+	uint32_t tmsi;
+	int i;
+
+	if (len < sizeof(*m))
+		return -1;
+	num_cell = m->num_cell <= 6 ? m->num_cell : 0;
+	if (len < sizeof(*m) + num_cell * sizeof(*c))
+		return -1;
+	c = (const struct meas_feed_v2_cell *) m->data;
+
+	memcpy(mfm->imsi, m->imsi, sizeof(mfm->imsi));
+	mfm->imsi[sizeof(mfm->imsi) - 1] = '\0';
+	tmsi = ntohl(m->tmsi);
+	if (mfm->imsi[0])
+		snprintf(mfm->name, sizeof(mfm->name), "IMSI:%s", mfm->imsi);
+	else if (tmsi != 0xffffffff)
+		snprintf(mfm->name, sizeof(mfm->name), "TMSI:0x%08x", tmsi);
+	else
+		snprintf(mfm->name, sizeof(mfm->name), "unknown");
+
+	mfm->lchan_type = m->lchan_type;
+	mfm->pchan_type = m->pchan_type;
+	mfm->bts_nr = m->bts_nr;
+	mfm->trx_nr = m->trx_nr;
+	mfm->ts_nr = m->ts_nr;
+	mfm->ss_nr = m->ss_nr;
+
+	memset(mr, 0, sizeof(*mr));
+	mr->nr = m->nr;
+	mr->flags = m->flags;
+	mr->ul.full.rx_lev = m->ul_full.rx_lev;
+	mr->ul.full.rx_qual = m->ul_full.rx_qual;
+	mr->ul.sub.rx_lev = m->ul_sub.rx_lev;
+	mr->ul.sub.rx_qual = m->ul_sub.rx_qual;
+	mr->dl.full.rx_lev = m->dl_full.rx_lev;
+	mr->dl.full.rx_qual = m->dl_full.rx_qual;
+	mr->dl.sub.rx_lev = m->dl_sub.rx_lev;
+	mr->dl.sub.rx_qual = m->dl_sub.rx_qual;
+	mr->bs_power = m->bs_power;
+	mr->ms_timing_offset = (int16_t) ntohs(m->ms_timing_offset);
+	mr->ms_l1.pwr = m->ms_l1_pwr;
+	mr->ms_l1.ta = m->ms_l1_ta;
+	mr->num_cell = m->num_cell;
+	for (i = 0; i < num_cell; i++) {
+		mr->cell[i].arfcn = ntohs(c[i].arfcn);
+		mr->cell[i].rxlev = c[i].rxlev;
+		mr->cell[i].bsic = c[i].bsic;
+		mr->cell[i].neigh_idx = c[i].neigh_idx;
+	}
+
+	return sizeof(*m) + num_cell * sizeof(*c);
+}
+
 int meas_feed_cfg_set(const char *dst_host, uint16_t dst_port);
 void meas_feed_scenario_set(const char *name);
 
 void meas_feed_cfg_get(char **host, uint16_t *port);
 const char *meas_feed_scenario_get(void);
+
+void meas_feed_version_set(uint16_t version);
+uint16_t meas_feed_version_get(void);
+void meas_feed_batch_interval_set(unsigned int ms);
+unsigned int meas_feed_batch_interval_get(void);
+int meas_feed_sendmmsg_set(bool enable);
+bool meas_feed_sendmmsg_get(void);
@@ -5,6 +5,9 @@
 
 #include <osmocom/gsm/meas_rep.h>
 
+struct gsm_lchan;
+struct neigh_meas_proc;
+
 #define MRC_F_PROCESSED	0x0001
 
 /* extracted from a L3 measurement report IE */
@@ -51,6 +54,37 @@ struct gsm_meas_rep {
 	struct gsm_meas_rep_cell cell[6];
 };
 
+/* Number of measurement reports kept per lchan */
+#define MAX_MEAS_REP		10
+
+/* Fields kept in the measurement history: the enum meas_rep_field values, plus the MS timing advance */
+#define MEAS_HIST_MS_TA		(MEAS_REP_UL_RXQUAL_SUB + 1)
+#define MEAS_HIST_NUM_FIELDS	(MEAS_HIST_MS_TA + 1)
+/* a field that was not present in a report, e.g. downlink values when MEAS_REP_F_DL_VALID is not set */
+#define MEAS_HIST_INVALID	0xff
+
+/* History of the last MAX_MEAS_REP measurement reports of an lchan. Only the values that handover decision
+ * looks at are kept, one small ring per field. Along with them, running totals of the valid values and of their
+ * number are recorded after each report; the average over any window is the difference of two totals. The
+ * totals wrap around, which is harmless since no window spans more than MAX_MEAS_REP values.
+ * Allocated on the first measurement report of an lchan, freed when the lchan becomes unused. */
+struct lchan_meas_hist {
+	/* number of reports added since the lchan was activated */
+	unsigned int count;
+	/* value of each field in the report numbered 'count', at [field][(count - 1) % MAX_MEAS_REP] */
+	uint8_t val[MEAS_HIST_NUM_FIELDS][MAX_MEAS_REP];
+	/* totals after the report numbered 'count', at [field][count % (MAX_MEAS_REP + 1)] */
+	uint16_t sum[MEAS_HIST_NUM_FIELDS][MAX_MEAS_REP + 1];
+	uint8_t num_valid[MEAS_HIST_NUM_FIELDS][MAX_MEAS_REP + 1];
+	/* the most recent report in full, as passed on with S_LCHAN_MEAS_REP */
+	struct gsm_meas_rep last;
+};
+
+struct gsm_meas_rep *lchan_meas_rep_next(struct gsm_lchan *lchan);
+void lchan_meas_rep_add(struct gsm_lchan *lchan);
+const struct gsm_meas_rep *lchan_meas_rep_last(const struct gsm_lchan *lchan);
+void lchan_meas_hist_free(struct gsm_lchan *lchan);
+
 /* obtain an average over the last 'num' fields in the meas reps */
 int get_meas_rep_avg(const struct gsm_lchan *lchan,
 		     enum meas_rep_field field, unsigned int num);
@@ -60,6 +94,9 @@ int meas_rep_n_out_of_m_be(const struct gsm_lchan *lchan,
 			enum meas_rep_field field,
 			unsigned int n, unsigned int m, int be);
 
+void neigh_meas_process(struct gsm_meas_rep *mr);
+int neigh_meas_avg(const struct neigh_meas_proc *nmp, int window);
+
 unsigned int calc_initial_idx(unsigned int array_size,
 			      unsigned int meas_rep_idx,
 			      unsigned int num_values);
@@ -37,6 +37,7 @@ const struct gsm0808_cell_id_list2 *neighbor_ident_get(const struct neighbor_ide
 						       const struct neighbor_ident_key *key);
 bool neighbor_ident_del(struct neighbor_ident_list *nil, const struct neighbor_ident_key *key);
 void neighbor_ident_clear(struct neighbor_ident_list *nil);
+bool neighbor_ident_has_from_bts(const struct neighbor_ident_list *nil, uint8_t from_bts);
 
 void neighbor_ident_iter(const struct neighbor_ident_list *nil,
 			 bool (* iter_cb )(const struct neighbor_ident_key *key,
@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/timer.h>
@@ -37,6 +38,10 @@ struct bsc_msc_data;
 struct gsm_paging_request {
 	/* list_head for list of all paging requests */
 	struct llist_head entry;
+	/* entry in the BTS's pending_requests_by_bsub hash table */
+	struct llist_head hentry;
+	/* entry in bsub->active_paging_requests */
+	struct llist_head bsub_entry;
 	/* the subscriber which we're paging. Later gsm_paging_request
 	 * should probably become a part of the bsc_subsrc struct? */
 	struct bsc_subscr *bsub;
@@ -44,9 +49,15 @@ struct gsm_paging_request {
 	struct gsm_bts *bts;
 	/* what kind of channel type do we ask the MS to establish */
 	int chan_type;
-
-	/* Timer 3113: how long do we try to page? */
-	struct osmo_timer_list T3113;
+	/* paging group of the subscriber on this BTS, see gsm0502_calc_paging_group() */
+	unsigned int pgroup;
+	/* CLOCK_MONOTONIC time when this request was queued */
+	struct timespec enqueue_time;
+
+	/* Timer 3113: how long do we try to page? Instead of one osmo_timer per request, requests are
+	 * queued in gsm_bts_paging_state.T3113_queue in order of expiry. */
+	struct llist_head T3113_entry;
+	struct timespec T3113_expiry;
 
 	/* How often did we ask the BTS to page? */
 	int attempts;
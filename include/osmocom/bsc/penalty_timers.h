@@ -2,7 +2,8 @@
  * initially used by handover algorithm 2 to keep per-BTS timers for each subscriber connection. */
 #pragma once
 
-/* Opaque struct to manage penalty timers */
+/* Opaque struct to manage penalty timers. Timers are hashed by object, so adding and looking up a timer does
+ * not depend on how many other objects have penalty time; timeouts count in seconds of CLOCK_MONOTONIC. */
 struct penalty_timers;
 
 /* Initialize a list of penalty timers.
@@ -25,7 +26,7 @@ void penalty_timers_add(struct penalty_timers *pt, const void *for_object, int t
 /* Return the amount of penalty time remaining for an object.
  * param pt: penalty timers list as from penalty_timers_init().
  * param for_object: arbitrary pointer reference to query penalty timers for.
- * returns seconds remaining until all penalty time has expired. */
+ * returns seconds remaining until all penalty time has expired. An expired timer is removed. */
 unsigned int penalty_timers_remaining(struct penalty_timers *pt, const void *for_object);
 
 /* Clear penalty timers for one or all objects.
@@ -0,0 +1,28 @@
+/* Index of subscriber connections by their SCCP connection id, and allocation of free ids. */
+#pragma once
+
+#include <stdint.h>
+
+struct gsm_network;
+struct gsm_subscriber_connection;
+
+/* SCCP connection ids are 24 bit values */
+#define SCCP_CONN_ID_MASK 0xFFFFFF
+
+/* Initialize the conn_id index of a network, called once from bsc_network_init(). */
+void sccp_conn_id_init(struct gsm_network *net);
+
+/* Return the subscriber connection using SCCP connection id conn_id, or NULL if none. */
+struct gsm_subscriber_connection *sccp_conn_id_find(struct gsm_network *net, int conn_id);
+
+/* Pick an SCCP connection id that no subscriber connection is using yet.
+ * Ids are handed out cyclically, so a released id is only reused after the entire 24 bit id space has
+ * been cycled through once.
+ * returns a free conn_id, or -1 if all ids are in use. */
+int sccp_conn_id_pick_free(struct gsm_network *net);
+
+/* Set the SCCP connection id of conn and add conn to the index; any previous id is released first. */
+void sccp_conn_id_set(struct gsm_network *net, struct gsm_subscriber_connection *conn, int conn_id);
+
+/* Remove conn from the index and set its conn_id to -1. Safe to call on a conn without conn_id. */
+void sccp_conn_id_clear(struct gsm_subscriber_connection *conn);
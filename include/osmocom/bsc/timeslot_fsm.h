@@ -40,6 +40,8 @@ enum ts_fsm_event {
         TS_EV_PDCH_ACT_NACK,
         TS_EV_PDCH_DEACT_ACK,
         TS_EV_PDCH_DEACT_NACK,
+	TS_EV_TCH_RESERVE,
+	TS_EV_TCH_RESERVE_END,
 };
 
 void ts_fsm_init();
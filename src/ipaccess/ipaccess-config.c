@@ -68,14 +68,28 @@ static char *unit_id;
 static uint16_t nv_flags;
 static uint16_t nv_mask;
 static char *software = NULL;
-static int sw_load_state = 0;
+static uint8_t sw_window = 19;
 static int oml_state = 0;
 static int dump_files = 0;
 static char *firmware_analysis = NULL;
-static int found_trx = 0;
 static int loop_tests = 0;
 static bool quiet = false;
 
+/* One BTS this tool talks to. Several BTS can be given when downloading software. */
+struct ia_site {
+	const char *ip;
+	struct gsm_bts *bts;
+	bool found_trx;
+	bool sw_loaded;
+	bool done;
+	int exit_code;
+	int percent_old;
+};
+
+static struct ia_site *sites;
+static unsigned int num_sites;
+static unsigned int num_sites_done;
+
 static void *tall_ctx_config = NULL;
 static struct abis_nm_sw_desc *sw_load1 = NULL;
 static struct abis_nm_sw_desc *sw_load2 = NULL;
@@ -166,6 +180,43 @@ static int ia_config_connect(struct gsm_bts *bts, struct sockaddr_in *sin)
 	return ipaccess_connect(line, sin);
 }
 
+static struct ia_site *site_by_bts(const struct gsm_bts *bts)
+{
+	OSMO_ASSERT(bts->nr < num_sites);
+	return &sites[bts->nr];
+}
+
+static void print_sw_load_stats(struct ia_site *site)
+{
+	struct abis_nm_sw_load_stats st;
+	double secs;
+
+	if (abis_nm_software_load_stats(site->bts, &st) < 0)
+		return;
+	secs = st.elapsed.tv_sec + st.elapsed.tv_nsec / 1e9;
+	fprintf(stderr, "BTS %s: %zu of %zu bytes in %.1f s, %.1f kB/s, window %u\n",
+		site->ip, st.bytes_sent, st.bytes_total, secs,
+		secs > 0 ? st.bytes_sent / secs / 1024 : 0, st.window_size);
+}
+
+/* Exit once every site is done, with the exit code of the last failed site */
+static void site_done(struct gsm_bts *bts, int exit_code)
+{
+	struct ia_site *site = site_by_bts(bts);
+	static int rc = 0;
+
+	if (site->done)
+		return;
+	site->done = true;
+	if (exit_code)
+		rc = exit_code;
+	if (software)
+		print_sw_load_stats(site);
+
+	if (++num_sites_done == num_sites)
+		exit(rc);
+}
+
 /*
  * Callback function for NACK on the OML NM
  *
@@ -185,13 +236,13 @@ static void check_restart_or_exit(struct gsm_bts_trx *trx)
 	if (restart) {
 		abis_nm_ipaccess_restart(trx);
 	} else {
-		exit(0);
+		site_done(trx->bts, 0);
 	}
 }
 
 static int ipacc_msg_ack(uint8_t mt, struct gsm_bts_trx *trx)
 {
-	if (sw_load_state == 1) {
+	if (site_by_bts(trx->bts)->sw_loaded) {
 		fprintf(stderr, "The new software is activated.\n");
 		check_restart_or_exit(trx);
 	} else if (oml_state == 1) {
@@ -315,13 +366,12 @@ static int nm_sig_cb(unsigned int subsys, unsigned int signal,
 		return ipacc_msg_ack(ipacc_data->msg_type, ipacc_data->trx);
 	case S_NM_IPACC_RESTART_ACK:
 		if (!quiet)
-			printf("The BTS has acked the restart. Exiting.\n");
-		exit(0);
+			printf("BTS %s has acked the restart.\n", site_by_bts(signal_data)->ip);
+		site_done(signal_data, 0);
 		break;
 	case S_NM_IPACC_RESTART_NACK:
-		if (!quiet)
-			printf("The BTS has nacked the restart. Exiting.\n");
-		exit(0);
+		fprintf(stderr, "ERROR: BTS %s has nacked the restart.\n", site_by_bts(signal_data)->ip);
+		site_done(signal_data, 7);
 		break;
 	case S_NM_STATECHG_OPER:
 	case S_NM_STATECHG_ADM:
@@ -342,18 +392,19 @@ static int nm_sig_cb(unsigned int subsys, unsigned int signal,
 }
 
 /* callback function passed to the ABIS OML code */
-static int percent;
-static int percent_old;
 static int swload_cbfn(unsigned int hook, unsigned int event, struct msgb *_msg,
 		       void *data, void *param)
 {
 	struct msgb *msg;
 	struct gsm_bts_trx *trx;
+	struct ia_site *site;
+	int percent;
 
 	if (hook != GSM_HOOK_NM_SWLOAD)
 		return 0;
 
 	trx = (struct gsm_bts_trx *) data;
+	site = site_by_bts(trx->bts);
 
 	switch (event) {
 	case NM_MT_LOAD_INIT_ACK:
@@ -361,13 +412,14 @@ static int swload_cbfn(unsigned int hook, unsigned int event, struct msgb *_msg,
 			fprintf(stdout, "Software Load Initiate ACK\n");
 		break;
 	case NM_MT_LOAD_INIT_NACK:
-		fprintf(stderr, "ERROR: Software Load Initiate NACK\n");
-		exit(5);
+		fprintf(stderr, "ERROR: BTS %s: Software Load Initiate NACK\n", site->ip);
+		site_done(trx->bts, 5);
 		break;
 	case NM_MT_LOAD_END_ACK:
-		fprintf(stderr, "LOAD END ACK...");
+		fprintf(stderr, "BTS %s: LOAD END ACK...", site->ip);
+		print_sw_load_stats(site);
 		/* now make it the default */
-		sw_load_state = 1;
+		site->sw_loaded = true;
 
 		msg = msgb_alloc(1024, "sw: nvattr");
 		msg->l2h = msgb_put(msg, 3);
@@ -391,24 +443,24 @@ static int swload_cbfn(unsigned int hook, unsigned int event, struct msgb *_msg,
 		msgb_free(msg);
 		break;
 	case NM_MT_LOAD_END_NACK:
-		fprintf(stderr, "ERROR: Software Load End NACK\n");
-		exit(3);
+		fprintf(stderr, "ERROR: BTS %s: Software Load End NACK\n", site->ip);
+		site_done(trx->bts, 3);
 		break;
 	case NM_MT_ACTIVATE_SW_NACK:
-		fprintf(stderr, "ERROR: Activate Software NACK\n");
-		exit(4);
+		fprintf(stderr, "ERROR: BTS %s: Activate Software NACK\n", site->ip);
+		site_done(trx->bts, 4);
 		break;
 	case NM_MT_ACTIVATE_SW_ACK:
 		break;
 	case NM_MT_LOAD_SEG_ACK:
 		percent = abis_nm_software_load_status(trx->bts);
-		if (!quiet && percent > percent_old)
-			printf("Software Download Progress: %d%%\n", percent);
-		percent_old = percent;
+		if (!quiet && percent > site->percent_old)
+			printf("BTS %s: Software Download Progress: %d%%\n", site->ip, percent);
+		site->percent_old = percent;
 		break;
 	case NM_MT_LOAD_ABORT:
-		fprintf(stderr, "ERROR: Load aborted by the BTS.\n");
-		exit(6);
+		fprintf(stderr, "ERROR: BTS %s: Load aborted by the BTS.\n", site->ip);
+		site_done(trx->bts, 6);
 		break;
 	}
 	return 0;
@@ -635,10 +687,13 @@ static int nm_state_event(int evt, uint8_t obj_class, void *obj,
 			  struct abis_om_obj_inst *obj_inst)
 {
 	if (obj_class == NM_OC_BASEB_TRANSC) {
-		if (!found_trx && obj_inst->trx_nr != 0xff) {
+		if (obj_inst->trx_nr != 0xff) {
 			struct gsm_bts_trx *trx = container_of(obj, struct gsm_bts_trx, bb_transc);
-			bootstrap_om(trx);
-			found_trx = 1;
+			struct ia_site *site = site_by_bts(trx->bts);
+			if (!site->found_trx) {
+				bootstrap_om(trx);
+				site->found_trx = true;
+			}
 		}
 	} else if (evt == S_NM_STATECHG_OPER &&
 	    obj_class == NM_OC_RADIO_CARRIER &&
@@ -652,7 +707,7 @@ static int nm_state_event(int evt, uint8_t obj_class, void *obj,
 			int rc;
 			if (!quiet)
 				printf("Attempting software upload with '%s'\n", software);
-			rc = abis_nm_software_load(trx->bts, trx->nr, software, 19, 0, swload_cbfn, trx);
+			rc = abis_nm_software_load(trx->bts, trx->nr, software, sw_window, 0, swload_cbfn, trx);
 			if (rc < 0) {
 				fprintf(stderr, "Failed to start software load\n");
 				exit(-3);
@@ -866,6 +921,7 @@ wrong_fmt:
 static void print_usage(void)
 {
 	printf("Usage: ipaccess-config IP_OF_BTS\n");
+	printf("       ipaccess-config -d FIRMWARE IP_OF_BTS [IP_OF_BTS...]\n");
 }
 
 static void print_help(void)
@@ -888,7 +944,8 @@ static void print_help(void)
 	printf("  -l --listen TESTNR\t\tPerform specified test number\n");
 	printf("  -L --Listen TEST_NAME\t\tPerform specified test\n");
 	printf("  -s --stream-id ID\t\tSet the IPA Stream Identifier for OML\n");
-	printf("  -d --software FIRMWARE\tDownload firmware into BTS\n");
+	printf("  -d --software FIRMWARE\tDownload firmware into BTS, into several at once if more IPs are given\n");
+	printf("  -W --window SEGMENTS\t\tSoftware download window, the BTS may grant less (default 19)\n");
 	printf("\n");
 	printf("Miscellaneous commands:\n");
 	printf("  -h --help\t\t\tthis text\n");
@@ -940,6 +997,7 @@ int main(int argc, char **argv)
 	struct gsm_bts *bts;
 	struct sockaddr_in sin;
 	char *bts_ip;
+	unsigned int i;
 	int rc, option_index = 0, stream_id = 0xff;
 
 	tall_ctx_config = talloc_named_const(NULL, 0, "ipaccess-config");
@@ -969,6 +1027,7 @@ int main(int argc, char **argv)
 			{ "Listen", 1, 0, 'L' },
 			{ "stream-id", 1, 0, 's' },
 			{ "software", 1, 0, 'd' },
+			{ "window", 1, 0, 'W' },
 			{ "firmware", 1, 0, 'f' },
 			{ "write-firmware", 0, 0, 'w' },
 			{ "disable-color", 0, 0, 'c'},
@@ -977,7 +1036,7 @@ int main(int argc, char **argv)
 			{ 0, 0, 0, 0 },
 		};
 
-		c = getopt_long(argc, argv, "Gu:o:i:g:rn:S:U:l:L:hs:d:f:wcpqH", long_options,
+		c = getopt_long(argc, argv, "Gu:o:i:g:rn:S:U:l:L:hs:d:W:f:wcpqH", long_options,
 				&option_index);
 
 		if (c == -1)
@@ -1047,6 +1106,14 @@ int main(int argc, char **argv)
 			if (find_sw_load_params(optarg) != 0)
 				exit(0);
 			break;
+		case 'W':
+			ul = strtoul(optarg, NULL, 10);
+			if (ul < 1 || ul > 255) {
+				fprintf(stderr, "The window must be 1..255 segments\n");
+				exit(2);
+			}
+			sw_window = ul;
+			break;
 		case 'f':
 			firmware_analysis = optarg;
 			break;
@@ -1082,11 +1149,17 @@ int main(int argc, char **argv)
 		if (argc == optind) /* Nothing more to do, exit successfully */
 			exit(EXIT_SUCCESS);
 	}
-	if (argc - optind != 1) {
-		fprintf(stderr, "you have to specify the IP address of the BTS. Use --help for more information\n");
+	if (argc - optind < 1 || (argc - optind > 1 && !software)) {
+		fprintf(stderr, "you have to specify the IP address of the BTS, or several with --software."
+			" Use --help for more information\n");
+		exit(2);
+	}
+	num_sites = argc - optind;
+	if (num_sites > 256) {
+		fprintf(stderr, "at most 256 BTS can be handled at once\n");
 		exit(2);
 	}
-	bts_ip = argv[optind++];
+	sites = talloc_zero_array(tall_ctx_config, struct ia_site, num_sites);
 
 	libosmo_abis_init(tall_ctx_config);
 
@@ -1094,33 +1167,43 @@ int main(int argc, char **argv)
 	if (!bsc_gsmnet)
 		exit(1);
 
-	bts = gsm_bts_alloc_register(bsc_gsmnet, GSM_BTS_TYPE_NANOBTS,
-				     HARDCODED_BSIC);
-	/* ip.access supports up to 4 chained TRX */
-	gsm_bts_trx_alloc(bts);
-	gsm_bts_trx_alloc(bts);
-	gsm_bts_trx_alloc(bts);
-	bts->oml_tei = stream_id;
-
 	osmo_signal_register_handler(SS_NM, nm_sig_cb, NULL);
 	osmo_signal_register_handler(SS_IPAC_NWL, nwl_sig_cb, NULL);
 
 	ipac_nwl_init();
 
-	if (!quiet)
-		printf("Trying to connect to ip.access BTS %s...\n", bts_ip);
-
-	memset(&sin, 0, sizeof(sin));
-	sin.sin_family = AF_INET;
-	inet_aton(bts_ip, &sin.sin_addr);
-	rc = ia_config_connect(bts, &sin);
-	if (rc < 0) {
-		perror("Error connecting to the BTS");
-		exit(1);
+	for (i = 0; i < num_sites; i++) {
+		bts_ip = argv[optind++];
+
+		bts = gsm_bts_alloc_register(bsc_gsmnet, GSM_BTS_TYPE_NANOBTS,
+					     HARDCODED_BSIC);
+		/* ip.access supports up to 4 chained TRX */
+		gsm_bts_trx_alloc(bts);
+		gsm_bts_trx_alloc(bts);
+		gsm_bts_trx_alloc(bts);
+		bts->oml_tei = stream_id;
+
+		/* site_by_bts() relies on the BTS numbers being assigned in order */
+		OSMO_ASSERT(bts->nr == i);
+		sites[i].ip = bts_ip;
+		sites[i].bts = bts;
+
+		if (!quiet)
+			printf("Trying to connect to ip.access BTS %s...\n", bts_ip);
+
+		memset(&sin, 0, sizeof(sin));
+		sin.sin_family = AF_INET;
+		inet_aton(bts_ip, &sin.sin_addr);
+		rc = ia_config_connect(bts, &sin);
+		if (rc < 0) {
+			fprintf(stderr, "Error connecting to the BTS %s: %s\n", bts_ip, strerror(errno));
+			exit(1);
+		}
+
+		bts->oml_link->ts->sign.delay = 10;
+		bts->c0->rsl_link->ts->sign.delay = 10;
 	}
 
-	bts->oml_link->ts->sign.delay = 10;
-	bts->c0->rsl_link->ts->sign.delay = 10;
 	while (1) {
 		rc = osmo_select_main(0);
 		if (rc < 0)
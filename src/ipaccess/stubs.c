@@ -42,5 +42,10 @@ void paging_flush_bts(struct gsm_bts *bts, struct bsc_msc_data *msc)
 	/* No paging flushing */
 }
 
+void rsl_imm_ass_rej_discard(struct gsm_bts *bts)
+{
+	/* No IMMEDIATE ASSIGN REJECT batching */
+}
+
 void ts_fsm_alloc(struct gsm_bts_trx_ts *ts)
 {}
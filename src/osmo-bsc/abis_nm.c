@@ -32,6 +32,7 @@
 #include <inttypes.h>
 
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -43,11 +44,13 @@
 #include <osmocom/gsm/abis_nm.h>
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/timer_compat.h>
 #include <osmocom/bsc/abis_nm.h>
 #include <osmocom/bsc/misdn.h>
 #include <osmocom/bsc/signal.h>
 #include <osmocom/abis/e1_input.h>
 #include <osmocom/bsc/chan_alloc.h>
+#include <osmocom/bsc/latency_prof.h>
 #include <osmocom/gsm/bts_features.h>
 
 #define OM_ALLOC_SIZE		1024
@@ -168,20 +171,138 @@ int _abis_nm_sendmsg(struct msgb *msg)
 	return abis_sendmsg(msg);
 }
 
+/* Number of ACK-requiring OML requests that may await a response at the same time on this BTS */
+static unsigned int abis_nm_window(const struct gsm_bts *bts)
+{
+	unsigned int max = bts->model ? bts->model->oml_window_max : 0;
+	return OSMO_MAX(1, OSMO_MIN(bts->oml_window, max));
+}
+
+/* Locate the FOM header in an OML message composed for sending, for plain FOM as well as ip.access
+ * manufacturer specific messages. */
+static const struct abis_om_fom_hdr *abis_nm_tx_foh(const struct msgb *msg)
+{
+	const struct abis_om_hdr *oh = (const struct abis_om_hdr *) msg->data;
+	unsigned int offset;
+
+	if (msgb_length(msg) < sizeof(*oh) + 1)
+		return NULL;
+
+	switch (oh->mdisc) {
+	case ABIS_OM_MDISC_FOM:
+		offset = 0;
+		break;
+	case ABIS_OM_MDISC_MANUF:
+		offset = 1 + oh->data[0];
+		break;
+	default:
+		return NULL;
+	}
+
+	if (msgb_length(msg) < sizeof(*oh) + offset + sizeof(struct abis_om_fom_hdr))
+		return NULL;
+	return (const struct abis_om_fom_hdr *) (oh->data + offset);
+}
+
+/* Record an ACK-requiring request as awaiting its response */
+static void abis_nm_pend_add(struct gsm_bts *bts, const struct msgb *msg)
+{
+	const struct abis_om_fom_hdr *foh = abis_nm_tx_foh(msg);
+	struct abis_nm_pend_req *req;
+
+	OSMO_ASSERT(bts->abis_nm_pend_count < ARRAY_SIZE(bts->abis_nm_pend));
+	req = &bts->abis_nm_pend[bts->abis_nm_pend_count++];
+	*req = (struct abis_nm_pend_req){};
+	if (foh) {
+		req->msg_type = foh->msg_type;
+		req->obj_class = foh->obj_class;
+		req->obj_inst = foh->obj_inst;
+	}
+	osmo_clock_gettime(CLOCK_MONOTONIC, &req->tx_time);
+
+	if (!bts->oml_bringup.started) {
+		bts->oml_bringup.started = true;
+		bts->oml_bringup.first_tx = req->tx_time;
+	}
+	bts->oml_bringup.requests++;
+	if (bts->abis_nm_pend_count > bts->oml_bringup.max_pend)
+		bts->oml_bringup.max_pend = bts->abis_nm_pend_count;
+}
+
+static bool abis_nm_pend_matches(const struct abis_nm_pend_req *req, const struct abis_om_fom_hdr *foh)
+{
+	return req->obj_class == foh->obj_class
+		&& !memcmp(&req->obj_inst, &foh->obj_inst, sizeof(req->obj_inst));
+}
+
+/* A response arrived from the BTS: release the request it answers. An ACK or NACK has the message type of
+ * its request plus one or two; failing that, take the oldest request for the same object, and if no
+ * request is outstanding for that object (or \a foh is NULL), the oldest request at all, which is what a
+ * window of 1 does. */
+static void abis_nm_pend_release(struct gsm_bts *bts, const struct abis_om_fom_hdr *foh)
+{
+	struct abis_nm_pend_req *req;
+	struct timespec now, rtt;
+	uint32_t rtt_us;
+	unsigned int i;
+	int found = -1;
+
+	if (!bts->abis_nm_pend_count)
+		return;
+
+	for (i = 0; foh && i < bts->abis_nm_pend_count; i++) {
+		req = &bts->abis_nm_pend[i];
+		if (!abis_nm_pend_matches(req, foh))
+			continue;
+		if (found < 0)
+			found = i;
+		if (foh->msg_type == req->msg_type + 1 || foh->msg_type == req->msg_type + 2) {
+			found = i;
+			break;
+		}
+	}
+	if (found < 0) {
+		LOGP(DNM, LOGL_DEBUG, "(bts=%d) OML response does not match any pending request,"
+		     " releasing the oldest\n", bts->nr);
+		bts->oml_bringup.unmatched++;
+		found = 0;
+	}
+
+	req = &bts->abis_nm_pend[found];
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, &req->tx_time, &rtt);
+	rtt_us = rtt.tv_sec * 1000000 + rtt.tv_nsec / 1000;
+	bts->oml_bringup.responses++;
+	bts->oml_bringup.rtt_sum_us += rtt_us;
+	if (rtt_us > bts->oml_bringup.rtt_max_us)
+		bts->oml_bringup.rtt_max_us = rtt_us;
+
+	/* keep the remaining requests in the order they were sent */
+	bts->abis_nm_pend_count--;
+	memmove(req, req + 1, (bts->abis_nm_pend_count - found) * sizeof(*req));
+
+	if (!bts->abis_nm_pend_count && llist_empty(&bts->abis_queue))
+		bts->oml_bringup.last_drained = now;
+}
+
+static int abis_nm_tx_queued(struct gsm_bts *bts, struct msgb *msg)
+{
+	if (OBSC_NM_W_ACK_CB(msg))
+		abis_nm_pend_add(bts, msg);
+	return _abis_nm_sendmsg(msg);
+}
+
 /* Send a OML NM Message from BSC to BTS */
 static int abis_nm_queue_msg(struct gsm_bts *bts, struct msgb *msg)
 {
 	msg->dst = bts->oml_link;
 
-	/* queue OML messages */
-	if (llist_empty(&bts->abis_queue) && !bts->abis_nm_pend) {
-		bts->abis_nm_pend = OBSC_NM_W_ACK_CB(msg);
-		return _abis_nm_sendmsg(msg);
-	} else {
-		msgb_enqueue(&bts->abis_queue, msg);
-		return 0;
-	}
+	/* queue OML messages, unless there is room in the window */
+	if (llist_empty(&bts->abis_queue) && bts->abis_nm_pend_count < abis_nm_window(bts))
+		return abis_nm_tx_queued(bts, msg);
 
+	msgb_enqueue(&bts->abis_queue, msg);
+	return 0;
 }
 
 int abis_nm_sendmsg(struct gsm_bts *bts, struct msgb *msg)
@@ -291,6 +412,8 @@ static int abis_nm_rx_statechg_rep(struct msgb *mb)
 		nm_state->availability = new_state.availability;
 		if (nm_state->administrative == 0)
 			nm_state->administrative = new_state.administrative;
+		/* TRX and timeslot availability affect the channel load and free lchans */
+		bts_avail_update(bts);
 	}
 #if 0
 	if (op_state == 1) {
@@ -864,21 +987,16 @@ char *get_model_oml_status(const struct gsm_bts *bts)
 	return "unknown";
 }
 
+/* Send queued messages until the window of outstanding requests is full again */
 void abis_nm_queue_send_next(struct gsm_bts *bts)
 {
-	int wait = 0;
+	unsigned int window = abis_nm_window(bts);
 	struct msgb *msg;
-	/* the queue is empty */
-	while (!llist_empty(&bts->abis_queue)) {
-		msg = msgb_dequeue(&bts->abis_queue);
-		wait = OBSC_NM_W_ACK_CB(msg);
-		_abis_nm_sendmsg(msg);
 
-		if (wait)
-			break;
+	while (!llist_empty(&bts->abis_queue) && bts->abis_nm_pend_count < window) {
+		msg = msgb_dequeue(&bts->abis_queue);
+		abis_nm_tx_queued(bts, msg);
 	}
-
-	bts->abis_nm_pend = wait;
 }
 
 /* Receive a OML NM Message from BTS */
@@ -896,6 +1014,8 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 	if (is_report(mt))
 		return abis_nm_rcvmsg_report(mb, bts);
 
+	abis_nm_pend_release(bts, foh);
+
 	if (is_in_arr(mt, abis_nm_sw_load_msgs, ARRAY_SIZE(abis_nm_sw_load_msgs)))
 		return abis_nm_rcvmsg_sw(mb);
 
@@ -960,11 +1080,11 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 		break;
 	case NM_MT_IPACC_RESTART_ACK:
 		DEBUGPFOH(DNM, foh, "IPA Restart ACK\n");
-		osmo_signal_dispatch(SS_NM, S_NM_IPACC_RESTART_ACK, NULL);
+		osmo_signal_dispatch(SS_NM, S_NM_IPACC_RESTART_ACK, bts);
 		break;
 	case NM_MT_IPACC_RESTART_NACK:
 		LOGPFOH(DNM, LOGL_NOTICE, foh, "IPA Restart NACK\n");
-		osmo_signal_dispatch(SS_NM, S_NM_IPACC_RESTART_NACK, NULL);
+		osmo_signal_dispatch(SS_NM, S_NM_IPACC_RESTART_NACK, bts);
 		break;
 	case NM_MT_SET_BTS_ATTR_ACK:
 		DEBUGPFOH(DNM, foh, "Set BTS Attribute ACK\n");
@@ -983,6 +1103,20 @@ static int abis_nm_rcvmsg_fom(struct msgb *mb)
 
 static int abis_nm_rx_ipacc(struct msgb *mb);
 
+/* Locate the FOM header of a received manufacturer specific message, behind the manufacturer id */
+static const struct abis_om_fom_hdr *abis_nm_rx_manuf_foh(struct msgb *mb)
+{
+	struct abis_om_hdr *oh = msgb_l2(mb);
+	unsigned int offset;
+
+	if (msgb_l2len(mb) < sizeof(*oh) + 1)
+		return NULL;
+	offset = sizeof(*oh) + 1 + oh->data[0];
+	if (msgb_l2len(mb) < offset + sizeof(struct abis_om_fom_hdr))
+		return NULL;
+	return (const struct abis_om_fom_hdr *) ((uint8_t *) oh + offset);
+}
+
 static int abis_nm_rcvmsg_manuf(struct msgb *mb)
 {
 	int rc;
@@ -992,6 +1126,7 @@ static int abis_nm_rcvmsg_manuf(struct msgb *mb)
 	switch (bts_type) {
 	case GSM_BTS_TYPE_NANOBTS:
 	case GSM_BTS_TYPE_OSMOBTS:
+		abis_nm_pend_release(sign_link->trx->bts, abis_nm_rx_manuf_foh(mb));
 		rc = abis_nm_rx_ipacc(mb);
 		abis_nm_queue_send_next(sign_link->trx->bts);
 		break;
@@ -1010,6 +1145,8 @@ static int abis_nm_rcvmsg_manuf(struct msgb *mb)
 int abis_nm_rcvmsg(struct msgb *msg)
 {
 	struct abis_om_hdr *oh = msgb_l2(msg);
+	struct timespec start;
+	uint8_t msg_type = 0;
 	int rc = 0;
 
 	/* Various consistency checks */
@@ -1040,6 +1177,10 @@ int abis_nm_rcvmsg(struct msgb *msg)
 #endif
 	msg->l3h = (unsigned char *)oh + sizeof(*oh);
 
+	if (oh->mdisc == ABIS_OM_MDISC_FOM && msgb_l3len(msg) >= sizeof(struct abis_om_fom_hdr))
+		msg_type = ((struct abis_om_fom_hdr *)msg->l3h)->msg_type;
+	latency_prof_start(&start);
+
 	switch (oh->mdisc) {
 	case ABIS_OM_MDISC_FOM:
 		rc = abis_nm_rcvmsg_fom(msg);
@@ -1058,6 +1199,7 @@ int abis_nm_rcvmsg(struct msgb *msg)
 		rc = -EINVAL;
 		break;
 	}
+	latency_prof_stop(LATENCY_PROF_OML, msg_type, &start);
 err:
 	msgb_free(msg);
 	return rc;
@@ -1102,6 +1244,12 @@ enum sw_state {
 	SW_STATE_ERROR,
 };
 
+/* One Load Data Segment of the image */
+struct abis_nm_sw_seg {
+	uint32_t offset;
+	uint16_t len;
+};
+
 struct abis_nm_sw {
 	struct gsm_bts *bts;
 	int trx_nr;
@@ -1122,13 +1270,39 @@ struct abis_nm_sw {
 	uint8_t window_size;
 	uint8_t seg_in_window;
 
-	int fd;
-	FILE *stream;
+	/* the software image, memory-mapped for the duration of the load */
+	const uint8_t *image;
+	size_t image_len;
+	/* the image split into segments once, when opening it */
+	struct abis_nm_sw_seg *segs;
+	unsigned int num_segs;
+	/* next segment to build a message for, and next segment to send */
+	unsigned int next_build;
+	unsigned int next_tx;
+	/* Load Data Segment messages of the next window, built while the BTS is busy with the current one */
+	struct llist_head prepared;
+
 	enum sw_state state;
 	int last_seg;
+
+	/* throughput */
+	struct timespec start;
+	struct timespec end;
+	size_t bytes_sent;
 };
 
-static struct abis_nm_sw g_sw;
+/* Each BTS has its own software load state, so that a single process can load several BTS at once */
+static struct abis_nm_sw *sw_get(struct gsm_bts *bts)
+{
+	if (!bts->sw_load) {
+		bts->sw_load = talloc_zero(bts, struct abis_nm_sw);
+		OSMO_ASSERT(bts->sw_load);
+		bts->sw_load->bts = bts;
+		bts->sw_load->state = SW_STATE_NONE;
+		INIT_LLIST_HEAD(&bts->sw_load->prepared);
+	}
+	return bts->sw_load;
+}
 
 static void sw_add_file_id_and_ver(struct abis_nm_sw *sw, struct msgb *msg)
 {
@@ -1164,36 +1338,67 @@ static int sw_load_init(struct abis_nm_sw *sw)
 	return abis_nm_sendmsg(sw->bts, msg);
 }
 
-static int is_last_line(FILE *stream)
+/* BS11 images are sent line by line, at most 253 characters per segment including CR+LF */
+#define BS11_SEGMENT_SIZE	253
+
+/* Split the image into Load Data Segments, so that sending needs no more file access or line scanning */
+static int sw_index_segments(struct abis_nm_sw *sw)
 {
-	char next_seg_buf[256];
-	long pos;
+	const uint8_t *pos, *end = sw->image + sw->image_len;
+	const uint8_t *nl;
+	unsigned int max_segs;
+	size_t len;
 
-	/* check if we're sending the last line */
-	pos = ftell(stream);
+	switch (sw->bts->type) {
+	case GSM_BTS_TYPE_BS11:
+		/* no line is shorter than one byte */
+		max_segs = sw->image_len;
+		break;
+	case GSM_BTS_TYPE_NANOBTS:
+		/* a final short (possibly empty) segment marks the end of the image */
+		max_segs = sw->image_len / IPACC_SEGMENT_SIZE + 1;
+		break;
+	default:
+		LOGP(DNM, LOGL_ERROR, "sw_load_segment needs implementation for the BTS.\n");
+		return -EINVAL;
+	}
 
-	/* Did ftell fail? Then we are at the end for sure */
-	if (pos < 0)
-		return 1;
+	sw->segs = talloc_array(sw, struct abis_nm_sw_seg, max_segs);
+	if (!sw->segs)
+		return -ENOMEM;
+	sw->num_segs = 0;
 
-	if (!fgets(next_seg_buf, sizeof(next_seg_buf)-2, stream)) {
-		int rc = fseek(stream, pos, SEEK_SET);
-		if (rc < 0)
-			return rc;
-		return 1;
+	for (pos = sw->image; pos < end || sw->bts->type == GSM_BTS_TYPE_NANOBTS; pos += len) {
+		if (sw->bts->type == GSM_BTS_TYPE_BS11) {
+			len = OSMO_MIN(end - pos, BS11_SEGMENT_SIZE);
+			nl = memchr(pos, '\n', len);
+			if (nl)
+				len = nl - pos + 1;
+		} else {
+			len = OSMO_MIN(end - pos, IPACC_SEGMENT_SIZE);
+		}
+		sw->segs[sw->num_segs++] = (struct abis_nm_sw_seg){
+			.offset = pos - sw->image,
+			.len = len,
+		};
+		if (sw->bts->type == GSM_BTS_TYPE_NANOBTS && len != IPACC_SEGMENT_SIZE)
+			break;
 	}
 
-	fseek(stream, pos, SEEK_SET);
+	if (!sw->num_segs) {
+		LOGP(DNM, LOGL_ERROR, "Software image is empty\n");
+		return -EINVAL;
+	}
 	return 0;
 }
 
-/* 6.2.2 / 8.3.2 Load Data Segment */
-static int sw_load_segment(struct abis_nm_sw *sw)
+/* 6.2.2 / 8.3.2 Load Data Segment: build the message for segment nr \a seg_nr, \a seg_in_window counting from 0 */
+static struct msgb *sw_build_segment(struct abis_nm_sw *sw, unsigned int seg_nr, unsigned int seg_in_window)
 {
+	const struct abis_nm_sw_seg *seg = &sw->segs[seg_nr];
+	bool last = (seg_nr == sw->num_segs - 1);
 	struct abis_om_hdr *oh;
 	struct msgb *msg = nm_msgb_alloc();
-	char seg_buf[256];
-	char *line_buf = seg_buf+2;
 	unsigned char *tlv;
 	int len;
 
@@ -1201,55 +1406,57 @@ static int sw_load_segment(struct abis_nm_sw *sw)
 
 	switch (sw->bts->type) {
 	case GSM_BTS_TYPE_BS11:
-		if (fgets(line_buf, sizeof(seg_buf)-2, sw->stream) == NULL) {
-			perror("fgets reading segment");
-			return -EINVAL;
-		}
-		seg_buf[0] = 0x00;
-
-		/* check if we're sending the last line */
-		sw->last_seg = is_last_line(sw->stream);
-		if (sw->last_seg)
-			seg_buf[1] = 0;
-		else
-			seg_buf[1] = 1 + sw->seg_in_window++;
-
-		len = strlen(line_buf) + 2;
+		len = seg->len + 2;
 		tlv = msgb_put(msg, TLV_GROSS_LEN(len));
-		tlv_put(tlv, NM_ATT_BS11_FILE_DATA, len, (uint8_t *)seg_buf);
+		tlv[0] = NM_ATT_BS11_FILE_DATA;
+		tlv[1] = len;
+		tlv[2] = 0x00;
+		/* the last line is marked by a zero sequence number */
+		tlv[3] = last ? 0 : 1 + seg_in_window;
+		memcpy(tlv + 4, sw->image + seg->offset, seg->len);
 		/* BS11 wants CR + LF in excess of the TLV length !?! */
 		tlv[1] -= 2;
-
-		/* we only now know the exact length for the OM hdr */
-		len = strlen(line_buf)+2;
 		break;
-	case GSM_BTS_TYPE_NANOBTS: {
-		osmo_static_assert(sizeof(seg_buf) >= IPACC_SEGMENT_SIZE, buffer_big_enough);
-		len = read(sw->fd, &seg_buf, IPACC_SEGMENT_SIZE);
-		if (len < 0) {
-			perror("read failed");
-			return -EINVAL;
-		}
-
-		if (len != IPACC_SEGMENT_SIZE)
-			sw->last_seg = 1;
-
-		++sw->seg_in_window;
-		msgb_tl16v_put(msg, NM_ATT_IPACC_FILE_DATA, len, (const uint8_t *) seg_buf);
-		len += 3;
+	case GSM_BTS_TYPE_NANOBTS:
+		msgb_tl16v_put(msg, NM_ATT_IPACC_FILE_DATA, seg->len, sw->image + seg->offset);
+		len = seg->len + 3;
 		break;
-	}
 	default:
-		LOGP(DNM, LOGL_ERROR, "sw_load_segment needs implementation for the BTS.\n");
-		/* FIXME: Other BTS types */
-		return -1;
+		msgb_free(msg);
+		return NULL;
 	}
 
 	fill_om_fom_hdr(oh, len, NM_MT_LOAD_SEG, sw->obj_class,
 			sw->obj_instance[0], sw->obj_instance[1],
 			sw->obj_instance[2]);
+	return msg;
+}
 
-	return abis_nm_sendmsg_direct(sw->bts, msg);
+/* Build the messages of the next window, which ends after window_size segments or at the last segment */
+static int sw_prepare_window(struct abis_nm_sw *sw)
+{
+	unsigned int seg_in_window = 0;
+	struct msgb *msg;
+
+	if (!llist_empty(&sw->prepared))
+		return 0;
+
+	while (seg_in_window < sw->window_size && sw->next_build < sw->num_segs) {
+		msg = sw_build_segment(sw, sw->next_build, seg_in_window);
+		if (!msg)
+			return -EINVAL;
+		msgb_enqueue(&sw->prepared, msg);
+		sw->next_build++;
+		seg_in_window++;
+	}
+	return 0;
+}
+
+static void sw_drop_prepared(struct abis_nm_sw *sw)
+{
+	while (!llist_empty(&sw->prepared))
+		msgb_free(msgb_dequeue(&sw->prepared));
+	sw->next_build = sw->next_tx;
 }
 
 /* 6.2.4 / 8.3.4 Load Data End */
@@ -1298,14 +1505,12 @@ struct sdp_firmware {
 static int parse_sdp_header(struct abis_nm_sw *sw)
 {
 	struct sdp_firmware firmware_header;
-	int rc;
-	struct stat stat;
 
-	rc = read(sw->fd, &firmware_header, sizeof(firmware_header));
-	if (rc != sizeof(firmware_header)) {
+	if (sw->image_len < sizeof(firmware_header)) {
 		LOGP(DNM, LOGL_ERROR, "Could not read SDP file header.\n");
 		return -1;
 	}
+	memcpy(&firmware_header, sw->image, sizeof(firmware_header));
 
 	if (strncmp(firmware_header.magic, " SDP", 4) != 0) {
 		LOGP(DNM, LOGL_ERROR, "The magic number1 is wrong.\n");
@@ -1320,19 +1525,11 @@ static int parse_sdp_header(struct abis_nm_sw *sw)
 		return -1;
 	}
 
-
-	if (fstat(sw->fd, &stat) == -1) {
-		LOGP(DNM, LOGL_ERROR, "Could not stat the file.\n");
-		return -1;
-	}
-
-	if (ntohl(firmware_header.file_length) != stat.st_size) {
+	if (ntohl(firmware_header.file_length) != sw->image_len) {
 		LOGP(DNM, LOGL_ERROR, "The filesizes do not match.\n");
 		return -1;
 	}
 
-	/* go back to the start as we checked the whole filesize.. */
-	lseek(sw->fd, 0l, SEEK_SET);
 	LOGP(DNM, LOGL_NOTICE, "The ipaccess SDP header is not fully understood."
 			       " There might be checksums in the file that are not"
 			       " verified and incomplete firmware might be flashed."
@@ -1341,43 +1538,71 @@ static int parse_sdp_header(struct abis_nm_sw *sw)
 	return 0;
 }
 
+static void sw_close_file(struct abis_nm_sw *sw)
+{
+	sw_drop_prepared(sw);
+	TALLOC_FREE(sw->segs);
+	sw->num_segs = 0;
+	if (sw->image) {
+		munmap((void *) sw->image, sw->image_len);
+		sw->image = NULL;
+	}
+}
+
 static int sw_open_file(struct abis_nm_sw *sw, const char *fname)
 {
+	char first_line[256];
 	char file_id[12+1];
 	char file_version[80+1];
-	int rc;
+	struct stat st;
+	void *image;
+	size_t len;
+	int fd, rc;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0)
+		return fd;
+
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		LOGP(DNM, LOGL_ERROR, "Could not stat the file or it is empty.\n");
+		close(fd);
+		return -EINVAL;
+	}
 
-	sw->fd = open(fname, O_RDONLY);
-	if (sw->fd < 0)
-		return sw->fd;
+	/* the mapping remains valid after closing the file descriptor */
+	image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (image == MAP_FAILED)
+		return -errno;
+	madvise(image, st.st_size, MADV_SEQUENTIAL);
+	sw->image = image;
+	sw->image_len = st.st_size;
+	sw->next_build = 0;
+	sw->next_tx = 0;
 
 	switch (sw->bts->type) {
 	case GSM_BTS_TYPE_BS11:
-		sw->stream = fdopen(sw->fd, "r");
-		if (!sw->stream) {
-			perror("fdopen");
-			return -1;
-		}
-		/* read first line and parse file ID and VERSION */
-		rc = fscanf(sw->stream, "@(#)%12s:%80s\r\n",
+		/* parse file ID and VERSION from the first line */
+		len = OSMO_MIN(sw->image_len, sizeof(first_line) - 1);
+		memcpy(first_line, sw->image, len);
+		first_line[len] = '\0';
+		rc = sscanf(first_line, "@(#)%12s:%80s\r\n",
 			    file_id, file_version);
 		if (rc != 2) {
-			perror("parsing header line of software file");
-			return -1;
+			LOGP(DNM, LOGL_ERROR, "parsing header line of software file failed\n");
+			goto err;
 		}
 		strcpy((char *)sw->file_id, file_id);
 		sw->file_id_len = strlen(file_id);
 		strcpy((char *)sw->file_version, file_version);
 		sw->file_version_len = strlen(file_version);
-		/* rewind to start of file */
-		rewind(sw->stream);
 		break;
 	case GSM_BTS_TYPE_NANOBTS:
 		/* TODO: extract that from the filename or content */
 		rc = parse_sdp_header(sw);
 		if (rc < 0) {
 			fprintf(stderr, "Could not parse the ipaccess SDP header\n");
-			return -1;
+			goto err;
 		}
 
 		strcpy((char *)sw->file_id, "id");
@@ -1387,38 +1612,78 @@ static int sw_open_file(struct abis_nm_sw *sw, const char *fname)
 		break;
 	default:
 		/* We don't know how to treat them yet */
-		close(sw->fd);
-		return -EINVAL;
+		rc = -EINVAL;
+		goto err;
 	}
 
+	rc = sw_index_segments(sw);
+	if (rc < 0)
+		goto err;
 	return 0;
-}
 
-static void sw_close_file(struct abis_nm_sw *sw)
-{
-	switch (sw->bts->type) {
-	case GSM_BTS_TYPE_BS11:
-		fclose(sw->stream);
-		break;
-	default:
-		close(sw->fd);
-		break;
-	}
+err:
+	sw_close_file(sw);
+	return rc < 0 ? rc : -EINVAL;
 }
 
-/* Fill the window */
+/* Send the prepared window, then build the next one while the BTS is busy receiving this one */
 static int sw_fill_window(struct abis_nm_sw *sw)
 {
+	struct msgb *msg;
 	int rc;
 
-	while (sw->seg_in_window < sw->window_size) {
-		rc = sw_load_segment(sw);
+	rc = sw_prepare_window(sw);
+	if (rc < 0)
+		return rc;
+
+	while ((msg = msgb_dequeue(&sw->prepared))) {
+		sw->bytes_sent += sw->segs[sw->next_tx].len;
+		sw->next_tx++;
+		sw->seg_in_window++;
+		if (sw->next_tx == sw->num_segs)
+			sw->last_seg = 1;
+		rc = abis_nm_sendmsg_direct(sw->bts, msg);
 		if (rc < 0)
 			return rc;
-		if (sw->last_seg)
-			break;
 	}
-	return 0;
+
+	return sw_prepare_window(sw);
+}
+
+/* The BTS may grant a smaller window than requested in its Load Data Initiate ACK */
+static void sw_rx_init_ack_window(struct abis_nm_sw *sw, struct msgb *mb)
+{
+	struct abis_om_hdr *oh = msgb_l2(mb);
+	struct abis_om_fom_hdr *foh = msgb_l3(mb);
+	struct tlv_parsed tp;
+	uint8_t granted;
+
+	if (abis_nm_tlv_parse(&tp, sw->bts, foh->data, oh->length - sizeof(*foh)) < 0)
+		return;
+	if (!TLVP_PRES_LEN(&tp, NM_ATT_WINDOW_SIZE, 1))
+		return;
+
+	granted = *TLVP_VAL(&tp, NM_ATT_WINDOW_SIZE);
+	if (!granted || granted >= sw->window_size)
+		return;
+
+	LOGPFOH(DNM, LOGL_NOTICE, foh, "BTS %u grants a window of %u instead of %u segments\n",
+		sw->bts->nr, granted, sw->window_size);
+	sw->window_size = granted;
+	sw_drop_prepared(sw);
+}
+
+static void sw_log_throughput(struct abis_nm_sw *sw)
+{
+	struct timespec elapsed;
+	unsigned long ms;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &sw->end);
+	timespecsub(&sw->end, &sw->start, &elapsed);
+	ms = elapsed.tv_sec * 1000 + elapsed.tv_nsec / 1000000;
+	LOGP(DNM, LOGL_NOTICE, "Software Load (BTS %u): %zu bytes in %lu ms, %lu bytes/s, window %u\n",
+	     sw->bts->nr, sw->bytes_sent, ms, ms ? (unsigned long)(sw->bytes_sent * 1000 / ms) : 0,
+	     sw->window_size);
 }
 
 /* callback function from abis_nm_rcvmsg() handler */
@@ -1427,7 +1692,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 	struct abis_om_fom_hdr *foh = msgb_l3(mb);
 	struct e1inp_sign_link *sign_link = mb->dst;
 	int rc = -1;
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_get(sign_link->trx->bts);
 	enum sw_state old_state = sw->state;
 
 	//DEBUGP(DNM, "state %u, NM MT 0x%02x\n", sw->state, foh->msg_type);
@@ -1436,6 +1701,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 	case SW_STATE_WAIT_INITACK:
 		switch (foh->msg_type) {
 		case NM_MT_LOAD_INIT_ACK:
+			sw_rx_init_ack_window(sw, mb);
 			/* fill window with segments */
 			if (sw->cbfn)
 				sw->cbfn(GSM_HOOK_NM_SWLOAD,
@@ -1457,6 +1723,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 			} else {
 				LOGPFOH(DNM, LOGL_NOTICE, foh, "Software Load Init NACK\n");
 				/* FIXME: cause */
+				sw_close_file(sw);
 				if (sw->cbfn)
 					sw->cbfn(GSM_HOOK_NM_SWLOAD,
 						 NM_MT_LOAD_INIT_NACK, mb,
@@ -1498,6 +1765,7 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 		switch (foh->msg_type) {
 		case NM_MT_LOAD_END_ACK:
 			sw_close_file(sw);
+			sw_log_throughput(sw);
 			DEBUGPFOH(DNM, foh, "Software Load End (BTS %u)\n", sw->bts->nr);
 			sw->state = SW_STATE_NONE;
 			if (sw->cbfn)
@@ -1508,6 +1776,8 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 			abis_nm_queue_send_next(sign_link->trx->bts);
 			break;
 		case NM_MT_LOAD_END_NACK:
+			sw_close_file(sw);
+			sw_log_throughput(sw);
 			if (sw->forced) {
 				DEBUGPFOH(DNM, foh, "FORCED: Ignoring Software Load End NACK\n");
 				sw->state = SW_STATE_NONE;
@@ -1571,12 +1841,12 @@ static int abis_nm_rcvmsg_sw(struct msgb *mb)
 	return rc;
 }
 
-/* Load the specified software into the BTS */
+/* Load the specified software into the BTS. Several BTS can be loaded at the same time. */
 int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 			  uint8_t win_size, int forced,
 			  gsm_cbfn *cbfn, void *cb_data)
 {
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_get(bts);
 	int rc;
 
 	DEBUGP(DNM, "Software Load (BTS %u, File \"%s\")\n", bts->nr, fname);
@@ -1584,7 +1854,6 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 	if (sw->state != SW_STATE_NONE)
 		return -EBUSY;
 
-	sw->bts = bts;
 	sw->trx_nr = trx_nr;
 
 	switch (bts->type) {
@@ -1596,7 +1865,7 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 		break;
 	case GSM_BTS_TYPE_NANOBTS:
 		sw->obj_class = NM_OC_BASEB_TRANSC;
-		sw->obj_instance[0] = sw->bts->nr;
+		sw->obj_instance[0] = sw->bts->bts_nr;
 		sw->obj_instance[1] = sw->trx_nr;
 		sw->obj_instance[2] = 0xff;
 		break;
@@ -1607,6 +1876,10 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 		break;
 	}
 	sw->window_size = win_size;
+	sw->seg_in_window = 0;
+	sw->last_seg = 0;
+	sw->bytes_sent = 0;
+	sw->end = (struct timespec){};
 	sw->state = SW_STATE_WAIT_INITACK;
 	sw->cbfn = cbfn;
 	sw->cb_data = cb_data;
@@ -1618,33 +1891,50 @@ int abis_nm_software_load(struct gsm_bts *bts, int trx_nr, const char *fname,
 		return rc;
 	}
 
-	return sw_load_init(sw);
+	osmo_clock_gettime(CLOCK_MONOTONIC, &sw->start);
+	rc = sw_load_init(sw);
+	/* build the first window while waiting for the Load Data Initiate ACK */
+	sw_prepare_window(sw);
+	return rc;
 }
 
 int abis_nm_software_load_status(struct gsm_bts *bts)
 {
-	struct abis_nm_sw *sw = &g_sw;
-	struct stat st;
-	int rc, percent;
+	struct abis_nm_sw *sw = sw_get(bts);
 
-	rc = fstat(sw->fd, &st);
-	if (rc < 0) {
-		perror("ERROR during stat");
-		return rc;
-	}
+	if (!sw->image_len)
+		return 0;
+	return (sw->bytes_sent * 100) / sw->image_len;
+}
 
-	if (sw->stream)
-		percent = (ftell(sw->stream) * 100) / st.st_size;
-	else
-		percent = (lseek(sw->fd, 0, SEEK_CUR) * 100) / st.st_size;
-	return percent;
+/*! Progress and throughput of the current or last software load of \a bts */
+int abis_nm_software_load_stats(struct gsm_bts *bts, struct abis_nm_sw_load_stats *stats)
+{
+	struct abis_nm_sw *sw = bts->sw_load;
+	struct timespec now;
+
+	if (!sw || !sw->start.tv_sec)
+		return -ENOENT;
+
+	*stats = (struct abis_nm_sw_load_stats){
+		.bytes_sent = sw->bytes_sent,
+		.bytes_total = sw->image_len,
+		.window_size = sw->window_size,
+	};
+	if (sw->end.tv_sec || sw->end.tv_nsec) {
+		timespecsub(&sw->end, &sw->start, &stats->elapsed);
+	} else {
+		osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+		timespecsub(&now, &sw->start, &stats->elapsed);
+	}
+	return 0;
 }
 
 /* Activate the specified software into the BTS */
 int abis_nm_software_activate(struct gsm_bts *bts, const char *fname,
 			      gsm_cbfn *cbfn, void *cb_data)
 {
-	struct abis_nm_sw *sw = &g_sw;
+	struct abis_nm_sw *sw = sw_get(bts);
 	int rc;
 
 	DEBUGP(DNM, "Activating Software (BTS %u, File \"%s\")\n", bts->nr, fname);
@@ -1652,7 +1942,6 @@ int abis_nm_software_activate(struct gsm_bts *bts, const char *fname,
 	if (sw->state != SW_STATE_NONE)
 		return -EBUSY;
 
-	sw->bts = bts;
 	sw->obj_class = NM_OC_SITE_MANAGER;
 	sw->obj_instance[0] = 0xff;
 	sw->obj_instance[1] = 0xff;
@@ -3124,5 +3413,6 @@ void abis_nm_clear_queue(struct gsm_bts *bts)
 		msgb_free(msg);
 	}
 
-	bts->abis_nm_pend = 0;
+	bts->abis_nm_pend_count = 0;
+	memset(&bts->oml_bringup, 0, sizeof(bts->oml_bringup));
 }
@@ -995,6 +995,7 @@ static void update_mo_state(struct gsm_bts *bts, struct abis_om2k_mo *mo,
 	osmo_signal_dispatch(SS_NM, S_NM_STATECHG_ADM, &nsd);
 
 	nm_state->availability = new_state.availability;
+	bts_avail_update(bts);
 }
 
 static void update_op_state(struct gsm_bts *bts, const struct abis_om2k_mo *mo,
@@ -1020,6 +1021,7 @@ static void update_op_state(struct gsm_bts *bts, const struct abis_om2k_mo *mo,
 	}
 
 	nm_state->operational = new_state.operational;
+	bts_avail_update(bts);
 }
 
 static int abis_om2k_sendmsg(struct gsm_bts *bts, struct msgb *msg)
@@ -54,6 +54,7 @@
 #include <osmocom/bsc/lchan_rtp_fsm.h>
 #include <osmocom/bsc/handover_fsm.h>
 #include <osmocom/bsc/smscb.h>
+#include <osmocom/bsc/latency_prof.h>
 
 #define RSL_ALLOC_SIZE		1024
 #define RSL_ALLOC_HEADROOM	128
@@ -980,24 +981,11 @@ static void print_meas_rep(struct gsm_lchan *lchan, struct gsm_meas_rep *mr)
 		log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
 }
 
-static struct gsm_meas_rep *lchan_next_meas_rep(struct gsm_lchan *lchan)
-{
-	struct gsm_meas_rep *meas_rep;
-
-	meas_rep = &lchan->meas_rep[lchan->meas_rep_idx];
-	memset(meas_rep, 0, sizeof(*meas_rep));
-	meas_rep->lchan = lchan;
-	lchan->meas_rep_idx = (lchan->meas_rep_idx + 1)
-					% ARRAY_SIZE(lchan->meas_rep);
-
-	return meas_rep;
-}
-
 static int rsl_rx_meas_res(struct msgb *msg)
 {
 	struct abis_rsl_dchan_hdr *dh = msgb_l2(msg);
 	struct tlv_parsed tp;
-	struct gsm_meas_rep *mr = lchan_next_meas_rep(msg->lchan);
+	struct gsm_meas_rep *mr;
 	uint8_t len;
 	const uint8_t *val;
 	int rc;
@@ -1007,8 +995,7 @@ static int rsl_rx_meas_res(struct msgb *msg)
 		return 0;
 	}
 
-	memset(mr, 0, sizeof(*mr));
-	mr->lchan = msg->lchan;
+	mr = lchan_meas_rep_next(msg->lchan);
 
 	rsl_tlv_parse(&tp, dh->data, msgb_l2len(msg)-sizeof(*dh));
 
@@ -1066,6 +1053,7 @@ static int rsl_rx_meas_res(struct msgb *msg)
 			return rc;
 	}
 
+	lchan_meas_rep_add(mr->lchan);
 	mr->lchan->meas_rep_count++;
 	mr->lchan->meas_rep_last_seen_nr = mr->nr;
 	LOGP(DRSL, LOGL_DEBUG, "%s: meas_rep_count++=%d meas_rep_last_seen_nr=%u\n",
@@ -1263,13 +1251,21 @@ static int abis_rsl_rx_trx(struct msgb *msg)
 	return rc;
 }
 
-/* Format an IMM ASS REJ according to 04.08 Chapter 9.1.20 */
-static int rsl_send_imm_ass_rej(struct gsm_bts *bts,
-				struct gsm48_req_ref *rqd_ref,
-				uint8_t wait_ind)
+/* Format an IMM ASS REJ according to 04.08 Chapter 9.1.20 from the Request References collected in
+ * bts->imm_ass_rej, and send it */
+static int rsl_send_imm_ass_rej(struct gsm_bts *bts)
 {
 	uint8_t buf[GSM_MACBLOCK_LEN];
 	struct gsm48_imm_ass_rej *iar = (struct gsm48_imm_ass_rej *)buf;
+	struct gsm48_req_ref *req_ref[] = { &iar->req_ref1, &iar->req_ref2, &iar->req_ref3, &iar->req_ref4 };
+	uint8_t *wait_ind[] = { &iar->wait_ind1, &iar->wait_ind2, &iar->wait_ind3, &iar->wait_ind4 };
+	unsigned int count = bts->imm_ass_rej.count;
+	unsigned int i;
+
+	osmo_timer_del(&bts->imm_ass_rej.timer);
+	if (!count)
+		return 0;
+	bts->imm_ass_rej.count = 0;
 
 	/* create IMMEDIATE ASSIGN REJECT 04.08 message */
 	memset(iar, 0, sizeof(*iar));
@@ -1278,36 +1274,75 @@ static int rsl_send_imm_ass_rej(struct gsm_bts *bts,
 	iar->page_mode = GSM48_PM_SAME;
 
 	/*
-	 * Set all request references and wait indications to the same value.
-	 * 3GPP TS 44.018 v4.5.0 release 4 (section 9.1.20.2) requires that
-	 * we duplicate reference and wait indication to fill the message.
-	 * The BTS will aggregate up to 4 of our ASS REJ messages if possible.
+	 * 3GPP TS 44.018 v4.5.0 release 4 (section 9.1.20.2) requires all four
+	 * request references and wait indications; if fewer were collected,
+	 * the last one is duplicated to fill the message. Some BTS aggregate
+	 * such messages further, if possible.
 	 */
-	memcpy(&iar->req_ref1, rqd_ref, sizeof(iar->req_ref1));
-	iar->wait_ind1 = wait_ind;
-	memcpy(&iar->req_ref2, rqd_ref, sizeof(iar->req_ref2));
-	iar->wait_ind2 = wait_ind;
-	memcpy(&iar->req_ref3, rqd_ref, sizeof(iar->req_ref3));
-	iar->wait_ind3 = wait_ind;
-	memcpy(&iar->req_ref4, rqd_ref, sizeof(iar->req_ref4));
-	iar->wait_ind4 = wait_ind;
+	for (i = 0; i < ARRAY_SIZE(req_ref); i++) {
+		unsigned int j = OSMO_MIN(i, count - 1);
+		*req_ref[i] = bts->imm_ass_rej.ref[j];
+		*wait_ind[i] = bts->imm_ass_rej.wait_ind[j];
+	}
 
 	/* we need to subtract 1 byte from sizeof(*iar) since ia includes the l2_plen field */
 	iar->l2_plen = GSM48_LEN2PLEN((sizeof(*iar)-1));
 
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_IMM_ASS_REJ_SENT]);
+	rate_ctr_add(&bts->bts_ctrs->ctr[BTS_CTR_IMM_ASS_REJ_COALESCED], count - 1);
 	return rsl_imm_assign_cmd(bts, sizeof(*iar), (uint8_t *) iar);
 }
 
+static void imm_ass_rej_timer_cb(void *data)
+{
+	rsl_send_imm_ass_rej(data);
+}
+
+/* Reject rqd_ref. To spend fewer AGCH blocks when the CCCH is busy, up to four Request References are
+ * rejected in one message: rqd_ref waits for others for up to T993122 milliseconds. */
 int rsl_tx_imm_ass_rej(struct gsm_bts *bts, struct gsm48_req_ref *rqd_ref)
 {
+	unsigned long window_ms;
+	unsigned int i;
 	uint8_t wait_ind;
 	wait_ind = bts->T3122;
 	if (!wait_ind)
 		wait_ind = osmo_tdef_get(bts->network->T_defs, 3122, OSMO_TDEF_S, -1);
 	if (!wait_ind)
 		wait_ind = GSM_T3122_DEFAULT;
-	/* The BTS will gather multiple CHAN RQD and reject up to 4 MS at the same time. */
-	return rsl_send_imm_ass_rej(bts, rqd_ref, wait_ind);
+	/* stretched while CCCH overload control bars ACCs */
+	if (bts->ccch_overload.t3122 > wait_ind)
+		wait_ind = bts->ccch_overload.t3122;
+
+	/* The same Request Reference needs no second slot, only the current wait indication */
+	for (i = 0; i < bts->imm_ass_rej.count; i++) {
+		if (!memcmp(&bts->imm_ass_rej.ref[i], rqd_ref, sizeof(*rqd_ref))) {
+			bts->imm_ass_rej.wait_ind[i] = wait_ind;
+			return 0;
+		}
+	}
+
+	i = bts->imm_ass_rej.count++;
+	bts->imm_ass_rej.ref[i] = *rqd_ref;
+	bts->imm_ass_rej.wait_ind[i] = wait_ind;
+
+	window_ms = osmo_tdef_get(bts->network->T_defs, 993122, OSMO_TDEF_MS, 0);
+	if (bts->imm_ass_rej.count == ARRAY_SIZE(bts->imm_ass_rej.ref) || !window_ms)
+		return rsl_send_imm_ass_rej(bts);
+
+	if (!osmo_timer_pending(&bts->imm_ass_rej.timer)) {
+		osmo_timer_setup(&bts->imm_ass_rej.timer, imm_ass_rej_timer_cb, bts);
+		osmo_timer_schedule(&bts->imm_ass_rej.timer, window_ms / 1000, (window_ms % 1000) * 1000);
+	}
+	return 0;
+}
+
+/* Drop the Request References collected for the next IMMEDIATE ASSIGN REJECT, e.g. when the RSL or OML
+ * link goes down: by the time it is back, the MS have long given up on them. */
+void rsl_imm_ass_rej_discard(struct gsm_bts *bts)
+{
+	osmo_timer_del(&bts->imm_ass_rej.timer);
+	bts->imm_ass_rej.count = 0;
 }
 
 /* Handle packet channel rach requests */
@@ -1343,6 +1378,48 @@ static int rsl_rx_pchan_rqd(struct msgb *msg, struct gsm_bts *bts)
 			       GSM_L1_BURST_TYPE_ACCESS_0);
 }
 
+static uint32_t chan_rqd_cache_hash(const struct gsm48_req_ref *rqd_ref)
+{
+	uint32_t t3 = (rqd_ref->t3_high << 3) | rqd_ref->t3_low;
+	return hash_32(rqd_ref->ra | (rqd_ref->t1 << 8) | (t3 << 13) | (rqd_ref->t2 << 19), CHAN_RQD_CACHE_BITS);
+}
+
+/* A BTS may report the same access burst, i.e. the same RA in the same frame, more than once. While the lchan
+ * activated for the first report is still being assigned, do not waste another lchan on the repetition: the
+ * Immediate Assignment is either still to come after the CHAN ACT ACK, or is sent once more.
+ * Retransmissions by the MS carry a new random reference and frame number and are not caught here; the MS
+ * accepts an Immediate Assignment for any of its last three requests.
+ * \returns true if rqd_ref was handled as a repetition. */
+static bool chan_rqd_is_repeated(struct gsm_bts *bts, const struct gsm48_req_ref *rqd_ref)
+{
+	struct gsm_lchan *lchan = bts->chan_rqd_cache[chan_rqd_cache_hash(rqd_ref)];
+
+	/* The lchan may have been released and used for something else since. Its rqd_ref is kept until the
+	 * lchan is reset, and T3101 limits how long it remains in the states below, well within the
+	 * ~3.3 minutes after which the frame number in the Request Reference repeats. */
+	if (!lchan || !lchan->fi || !lchan->rqd_ref
+	    || memcmp(lchan->rqd_ref, rqd_ref, sizeof(*rqd_ref)))
+		return false;
+
+	switch (lchan->fi->state) {
+	case LCHAN_ST_WAIT_TS_READY:
+	case LCHAN_ST_WAIT_ACTIV_ACK:
+		LOG_LCHAN(lchan, LOGL_INFO, "Repeated CHAN RQD ra=0x%02x, Immediate Assignment is pending\n",
+			  rqd_ref->ra);
+		break;
+	case LCHAN_ST_WAIT_RLL_RTP_ESTABLISH:
+		LOG_LCHAN(lchan, LOGL_INFO, "Repeated CHAN RQD ra=0x%02x, sending Immediate Assignment again\n",
+			  rqd_ref->ra);
+		rsl_tx_imm_assignment(lchan);
+		break;
+	default:
+		return false;
+	}
+
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_DUPLICATE]);
+	return true;
+}
+
 /* MS has requested a channel on the RACH */
 static int rsl_rx_chan_rqd(struct msgb *msg)
 {
@@ -1382,6 +1459,9 @@ static int rsl_rx_chan_rqd(struct msgb *msg)
 
 	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_CHREQ_TOTAL]);
 
+	if (chan_rqd_is_repeated(bts, rqd_ref))
+		return 0;
+
 	/* check availability / allocate channel
 	 *
 	 * - First try to allocate SDCCH.
@@ -1423,6 +1503,7 @@ static int rsl_rx_chan_rqd(struct msgb *msg)
 	};
 
 	lchan_activate(lchan, &info);
+	bts->chan_rqd_cache[chan_rqd_cache_hash(rqd_ref)] = lchan;
 	return 0;
 }
 
@@ -1490,6 +1571,9 @@ static int rsl_rx_ccch_load(struct msgb *msg)
 			access_percent = (int32_t) sd.rach_access_count * 100 / (int32_t) sd.rach_slot_count;
 			osmo_stat_item_set(sd.bts->bts_statg->items[BTS_STAT_RACH_BUSY], busy_percent);
 			osmo_stat_item_set(sd.bts->bts_statg->items[BTS_STAT_RACH_ACCESS], access_percent);
+			sd.bts->ccch_overload.rach_busy = busy_percent;
+			sd.bts->ccch_overload.rach_access = access_percent;
+			sd.bts->ccch_overload.rach_load_age = 0;
 			/* dispatch signal */
 			osmo_signal_dispatch(SS_CCCH, S_CCCH_RACH_LOAD, &sd);
 		}
@@ -1574,8 +1658,9 @@ static int abis_rsl_rx_cchan(struct msgb *msg)
 		break;
 	case RSL_MT_DELETE_IND:
 		/* CCCH overloaded, IMM_ASSIGN was dropped */
-		LOGP(DRSL, LOGL_NOTICE, "Unimplemented Abis RSL CChan message "
-			"type %s\n", rsl_msg_name(rslh->c.msg_type));
+		LOG_BTS(sign_link->trx->bts, DRSL, LOGL_NOTICE, "AGCH overloaded, IMMEDIATE ASSIGN was dropped (%s)\n",
+			rsl_msg_name(rslh->c.msg_type));
+		rate_ctr_inc(&sign_link->trx->bts->bts_ctrs->ctr[BTS_CTR_AGCH_DELETE_IND]);
 		break;
 	case RSL_MT_CBCH_LOAD_IND:
 		/* current load on the CBCH */
@@ -2168,6 +2253,8 @@ int abis_rsl_rcvmsg(struct msgb *msg)
 {
 	struct e1inp_sign_link *sign_link;
 	struct abis_rsl_common_hdr *rslh;
+	struct timespec start;
+	uint8_t msg_type;
 	int rc = 0;
 
 	if (!msg) {
@@ -2183,6 +2270,8 @@ int abis_rsl_rcvmsg(struct msgb *msg)
 
 	sign_link = msg->dst;
 	rslh = msgb_l2(msg);
+	msg_type = rslh->msg_type;
+	latency_prof_start(&start);
 
 	switch (rslh->msg_discr & 0xfe) {
 	case ABIS_RSL_MDISC_RLL:
@@ -2211,6 +2300,7 @@ int abis_rsl_rcvmsg(struct msgb *msg)
 		rc = -EINVAL;
 	}
 	msgb_free(msg);
+	latency_prof_stop(LATENCY_PROF_RSL, msg_type, &start);
 	return rc;
 }
 
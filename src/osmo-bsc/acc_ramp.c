@@ -108,7 +108,7 @@ static void do_acc_ramping_step(void *data)
 	/* Shortcut in case we only do one ramping step. */
 	if (acc_ramp->step_size == ACC_RAMP_STEP_SIZE_MAX) {
 		allow_all_accs(acc_ramp);
-		gsm_bts_set_system_infos(acc_ramp->bts);
+		gsm_bts_update_system_infos(acc_ramp->bts, SI_DIRTY_ACC);
 		return;
 	}
 
@@ -134,7 +134,7 @@ static void do_acc_ramping_step(void *data)
 		}
 	}
 
-	gsm_bts_set_system_infos(acc_ramp->bts);
+	gsm_bts_update_system_infos(acc_ramp->bts, SI_DIRTY_ACC);
 
 	/* If we have not allowed all ACCs yet, schedule another ramping step. */
 	if (acc_ramp_get_barred_t2(acc_ramp) != 0x00 ||
@@ -359,3 +359,22 @@ void acc_ramp_abort(struct acc_ramp *acc_ramp)
 
 	allow_all_accs(acc_ramp);
 }
+
+/*!
+ * Bar ACCs on top of ACC ramping, for CCCH overload control, and update the System Information
+ * if that changes anything. Only bits 0-9 (ACC0-ACC9) of barred_accs are used; 0 allows all of
+ * them again, unless barred by ramping or configuration.
+ * \param[in] acc_ramp Pointer to acc_ramp structure.
+ * \param[in] barred_accs Bitmask of ACCs to bar, bit n for ACCn.
+ */
+void acc_ramp_set_overload_barred(struct acc_ramp *acc_ramp, uint16_t barred_accs)
+{
+	barred_accs &= 0x3ff;
+	if (barred_accs == acc_ramp->overload_barred_accs)
+		return;
+
+	LOG_BTS(acc_ramp->bts, DRSL, LOGL_NOTICE, "ACC RAMP: overload control bars ACC mask 0x%03x (was 0x%03x)\n",
+		barred_accs, acc_ramp->overload_barred_accs);
+	acc_ramp->overload_barred_accs = barred_accs;
+	gsm_bts_update_system_infos(acc_ramp->bts, SI_DIRTY_ACC);
+}
@@ -19,6 +19,8 @@
  *
  */
 #include <errno.h>
+#include <inttypes.h>
+#include <string.h>
 #include <time.h>
 
 #include <osmocom/ctrl/control_cmd.h>
@@ -30,6 +32,7 @@
 #include <osmocom/bsc/chan_alloc.h>
 #include <osmocom/bsc/osmo_bsc_rf.h>
 #include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/latency_prof.h>
 
 CTRL_CMD_DEFINE(net_mcc, "mcc");
 static int get_net_mcc(struct ctrl_cmd *cmd, void *_data)
@@ -177,8 +180,26 @@ oom:
 CTRL_CMD_DEFINE_WO(net_mcc_mnc_apply, "mcc-mnc-apply");
 
 /* BTS related commands below */
-CTRL_CMD_DEFINE_RANGE(bts_lac, "location-area-code", struct gsm_bts, location_area_code, 0, 65535);
-CTRL_CMD_DEFINE_RANGE(bts_ci, "cell-identity", struct gsm_bts, cell_identity, 0, 65535);
+/* LAC and CI are set via gsm_bts_set_lac() and gsm_bts_set_ci() to keep the network's cell index in sync */
+CTRL_HELPER_GET_INT(bts_lac, struct gsm_bts, location_area_code);
+static int set_bts_lac(struct ctrl_cmd *cmd, void *_data)
+{
+	struct gsm_bts *bts = cmd->node;
+	gsm_bts_set_lac(bts, atoi(cmd->value));
+	return get_bts_lac(cmd, _data);
+}
+CTRL_HELPER_VERIFY_RANGE(bts_lac, 0, 65535);
+CTRL_CMD_DEFINE(bts_lac, "location-area-code");
+
+CTRL_HELPER_GET_INT(bts_ci, struct gsm_bts, cell_identity);
+static int set_bts_ci(struct ctrl_cmd *cmd, void *_data)
+{
+	struct gsm_bts *bts = cmd->node;
+	gsm_bts_set_ci(bts, atoi(cmd->value));
+	return get_bts_ci(cmd, _data);
+}
+CTRL_HELPER_VERIFY_RANGE(bts_ci, 0, 65535);
+CTRL_CMD_DEFINE(bts_ci, "cell-identity");
 
 static int set_bts_apply_config(struct ctrl_cmd *cmd, void *data)
 {
@@ -281,6 +302,28 @@ static int get_bts_oml_up(struct ctrl_cmd *cmd, void *data)
 
 CTRL_CMD_DEFINE_RO(bts_oml_up, "oml-uptime");
 
+static int get_bts_admission(struct ctrl_cmd *cmd, void *data)
+{
+	const struct gsm_bts *bts = cmd->node;
+	struct timespec elapsed;
+	unsigned long elapsed_ms = 0;
+
+	if (bts_admission_time_to_service(bts, &elapsed))
+		elapsed_ms = elapsed.tv_sec * 1000 + elapsed.tv_nsec / 1000000;
+
+	cmd->reply = talloc_asprintf(cmd, "%s,%u,%lu",
+				     bts_admission_state_name(bts->admission.state),
+				     bts_admission_queue_pos(bts), elapsed_ms);
+	if (!cmd->reply) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+
+	return CTRL_CMD_REPLY;
+}
+
+CTRL_CMD_DEFINE_RO(bts_admission, "admission-state");
+
 static int verify_bts_gprs_mode(struct ctrl_cmd *cmd, const char *value, void *_data)
 {
 	int valid;
@@ -432,6 +475,71 @@ static int get_net_bts_num(struct ctrl_cmd *cmd, void *data)
 }
 CTRL_CMD_DEFINE_RO(net_bts_num, "number-of-bts");
 
+/* Reply "<runs>,<congested-bts>,<candidates>,<last-us>,<avg-us>,<max-us>", the first three of the most recent
+ * handover algorithm 2 congestion check */
+static int get_net_congestion_check_stats(struct ctrl_cmd *cmd, void *data)
+{
+	struct gsm_network *net = cmd->node;
+	const struct hodec2_congestion_check_stats *stats = &net->hodec2.congestion_check_stats;
+
+	cmd->reply = talloc_asprintf(cmd, "%lu,%u,%u,%lu,%llu,%lu", stats->runs, stats->congested_bts,
+				     stats->candidates, stats->last_us,
+				     stats->runs ? stats->total_us / stats->runs : 0, stats->max_us);
+	if (!cmd->reply) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+
+	return CTRL_CMD_REPLY;
+}
+CTRL_CMD_DEFINE_RO(net_congestion_check_stats, "congestion-check-stats");
+
+static int get_net_latency_profiler(struct ctrl_cmd *cmd, void *data)
+{
+	cmd->reply = latency_prof_enabled ? "1" : "0";
+	return CTRL_CMD_REPLY;
+}
+
+static int set_net_latency_profiler(struct ctrl_cmd *cmd, void *data)
+{
+	latency_prof_enable(atoi(cmd->value));
+	return get_net_latency_profiler(cmd, data);
+}
+
+static int verify_net_latency_profiler(struct ctrl_cmd *cmd, const char *value, void *data)
+{
+	if (strcmp(value, "0") && strcmp(value, "1"))
+		return 1;
+	return 0;
+}
+CTRL_CMD_DEFINE(net_latency_profiler, "latency-profiler");
+
+/* Reply "<handler>,<count>,<avg-us>,<p50-us>,<p99-us>,<max-us>" for each handler, separated by spaces */
+static int get_net_latency_stats(struct ctrl_cmd *cmd, void *data)
+{
+	const char *space = "";
+	int i;
+
+	cmd->reply = talloc_strdup(cmd, "");
+
+	for (i = 0; i < _NUM_LATENCY_PROF_HANDLERS; i++) {
+		const struct latency_hist *h = latency_prof_total(i);
+
+		cmd->reply = talloc_asprintf_append(cmd->reply, "%s%s,%"PRIu64",%u,%u,%u,%u", space,
+						    latency_prof_handler_name(i), h->count, latency_hist_avg_us(h),
+						    latency_hist_percentile_us(h, 50),
+						    latency_hist_percentile_us(h, 99), h->max_us);
+		if (!cmd->reply) {
+			cmd->reply = "OOM";
+			return CTRL_CMD_ERROR;
+		}
+		space = " ";
+	}
+
+	return CTRL_CMD_REPLY;
+}
+CTRL_CMD_DEFINE_RO(net_latency_stats, "latency-stats");
+
 /* TRX related commands below here */
 CTRL_HELPER_GET_INT(trx_max_power, struct gsm_bts_trx, max_power_red);
 static int verify_trx_max_power(struct ctrl_cmd *cmd, const char *value, void *_data)
@@ -482,6 +590,9 @@ int bsc_base_ctrl_cmds_install(void)
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_mcc_mnc_apply);
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_rf_lock);
 	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_bts_num);
+	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_congestion_check_stats);
+	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_latency_profiler);
+	rc |= ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_net_latency_stats);
 
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_lac);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_ci);
@@ -490,6 +601,7 @@ int bsc_base_ctrl_cmds_install(void)
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_chan_load);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_oml_conn);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_oml_up);
+	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_admission);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_gprs_mode);
 	rc |= ctrl_cmd_install(CTRL_NODE_BTS, &cmd_bts_rf_state);
 
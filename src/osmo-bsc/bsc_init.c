@@ -122,20 +122,185 @@ static int rsl_si(struct gsm_bts_trx *trx, enum osmo_sysinfo_type i, int si_len)
 	return rc;
 }
 
-/* set all system information types for a TRX */
-int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
+/* All SI types in the order they need to be generated: SI3 indicates whether SI2ter and SI2quater are
+ * present, so it comes after those. */
+static const uint8_t si_gen_order[] = {
+	SYSINFO_TYPE_1,
+	SYSINFO_TYPE_2,
+	SYSINFO_TYPE_2bis,
+	SYSINFO_TYPE_2ter,
+	SYSINFO_TYPE_2quater,
+	SYSINFO_TYPE_3,
+	SYSINFO_TYPE_4,
+	SYSINFO_TYPE_13,
+	SYSINFO_TYPE_5,
+	SYSINFO_TYPE_5bis,
+	SYSINFO_TYPE_5ter,
+	SYSINFO_TYPE_6,
+};
+
+/* SI broadcast on the BCCH of C0, except SI13 */
+#define SI_BCCH_MASK	(SI_MASK(SYSINFO_TYPE_1) | SI_MASK(SYSINFO_TYPE_2) | SI_MASK(SYSINFO_TYPE_2bis) \
+			 | SI_MASK(SYSINFO_TYPE_2ter) | SI_MASK(SYSINFO_TYPE_2quater) | SI_MASK(SYSINFO_TYPE_3) \
+			 | SI_MASK(SYSINFO_TYPE_4))
+
+static bool si_needed(struct gsm_bts *bts, enum osmo_sysinfo_type i)
 {
-	int i, rc;
-	struct gsm_bts *bts = trx->bts;
-	uint8_t gen_si[_MAX_SYSINFO_TYPE], n_si = 0, n;
-	int si_len[_MAX_SYSINFO_TYPE];
+	/* 13 is only present on a GPRS BTS */
+	if (i == SYSINFO_TYPE_13)
+		return bts->gprs.mode != BTS_GPRS_NONE;
+	return true;
+}
+
+/* Regenerate one SI into bts->si_buf, return whether its presence or content changed */
+static int bts_generate_si(struct gsm_bts *bts, enum osmo_sysinfo_type i)
+{
+	sysinfo_buf_t old[SI2Q_MAX_NUM];
+	bool was_valid = GSM_BTS_HAS_SI(bts, i);
+	int old_len = bts->si_len[i];
+	uint8_t old_si2q_count = bts->si2q_count;
+	int rc;
+
+	/* Only generate SI if this SI is not in "static" (user-defined) mode */
+	if (bts->si_mode_static & SI_MASK(i)) {
+		if (i == SYSINFO_TYPE_5 || i == SYSINFO_TYPE_5bis
+		 || i == SYSINFO_TYPE_5ter)
+			bts->si_len[i] = 18;
+		else if (i == SYSINFO_TYPE_6)
+			bts->si_len[i] = 11;
+		else
+			bts->si_len[i] = 23;
+		bts->si_valid |= SI_MASK(i);
+		/* The VTY edits static SI in place, so there is nothing to compare against here. Sending
+		 * still compares against what each TRX has. */
+		return 0;
+	}
+
+	if (!si_needed(bts, i)) {
+		bts->si_valid &= ~SI_MASK(i);
+		bts->si_len[i] = 0;
+		return was_valid;
+	}
+
+	memcpy(old, bts->si_buf[i], i == SYSINFO_TYPE_2quater ? sizeof(old) : sizeof(old[0]));
+
+	/* Set SI as being valid. gsm_generate_si() might unset
+	 * it, if SI is not required. */
+	bts->si_valid |= SI_MASK(i);
+	rc = gsm_generate_si(bts, i);
+	if (rc < 0)
+		return rc;
+	bts->si_len[i] = rc;
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_SI_GENERATED]);
+
+	if (was_valid != GSM_BTS_HAS_SI(bts, i) || old_len != rc)
+		return 1;
+	if (i == SYSINFO_TYPE_2quater)
+		return old_si2q_count != bts->si2q_count
+			|| memcmp(old, bts->si_buf[i], (bts->si2q_count + 1) * sizeof(old[0]));
+	return memcmp(old, bts->si_buf[i], sizeof(old[0])) != 0;
+}
+
+/* Regenerate the SI types in si_dirty and in bts->si_dirty, as well as the SI types depending on
+ * those that changed. Return a bitmask of the SI types whose content changed, or a negative error. */
+static int bts_generate_system_infos(struct gsm_bts *bts, uint32_t si_dirty)
+{
+	uint32_t changed = 0;
+	int n, i, rc;
+
+	si_dirty |= bts->si_dirty;
 
 	bts->si_common.cell_sel_par.ms_txpwr_max_ccch =
 			ms_pwr_ctl_lvl(bts->band, bts->ms_max_power);
 	bts->si_common.cell_sel_par.neci = bts->network->neci;
 
-	/* Zero/forget the state of the dynamically computed SIs, leeping the static ones */
-	bts->si_valid = bts->si_mode_static;
+	for (n = 0; n < ARRAY_SIZE(si_gen_order); n++) {
+		bool had_si2ter = GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter);
+		bool had_si2quater = GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater);
+
+		i = si_gen_order[n];
+		if (!(si_dirty & SI_MASK(i)))
+			continue;
+
+		rc = bts_generate_si(bts, i);
+		if (rc < 0)
+			goto err_out;
+		if (rc)
+			changed |= SI_MASK(i);
+
+		/* SI3 announces SI2ter and SI2quater */
+		if (had_si2ter != GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter)
+		    || had_si2quater != GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater))
+			si_dirty |= SI_MASK(SYSINFO_TYPE_3);
+	}
+	bts->si_dirty = 0;
+
+	/* SI13 carries the BCCH change mark, telling GPRS MS to read the BCCH SI again */
+	if ((changed & SI_BCCH_MASK) && si_needed(bts, SYSINFO_TYPE_13)) {
+		bts->bcch_change_mark += 1;
+		bts->bcch_change_mark %= 0x7;
+		i = SYSINFO_TYPE_13;
+		rc = bts_generate_si(bts, i);
+		if (rc < 0)
+			goto err_out;
+		changed |= SI_MASK(i);
+	}
+
+	return changed;
+err_out:
+	/* try again next time */
+	bts->si_dirty = si_dirty;
+	LOGP(DRR, LOGL_ERROR, "Cannot generate SI%s for BTS %u: error <%s>, "
+	     "most likely a problem with neighbor cell list generation\n",
+	     get_value_string(osmo_sitype_strs, i), bts->nr, strerror(-rc));
+	return rc;
+}
+
+/* Send one SI to a TRX, unless the TRX already has exactly these bytes */
+static int rsl_si_if_changed(struct gsm_bts_trx *trx, enum osmo_sysinfo_type i, int si_len)
+{
+	struct gsm_bts *bts = trx->bts;
+	bool unchanged;
+	int rc;
+
+	if (!(trx->si_sent.valid & SI_MASK(i)) || trx->si_sent.len[i] != si_len)
+		unchanged = false;
+	else if (!si_len)
+		unchanged = true;
+	else if (i == SYSINFO_TYPE_2quater)
+		unchanged = trx->si_sent.si2q_count == bts->si2q_count
+			&& !memcmp(trx->si_sent.si2q, bts->si_buf[i], (bts->si2q_count + 1) * sizeof(sysinfo_buf_t));
+	else
+		unchanged = !memcmp(trx->si_sent.buf[i], GSM_BTS_SI(bts, i), sizeof(sysinfo_buf_t));
+
+	if (unchanged) {
+		rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_SI_SKIPPED]);
+		return 0;
+	}
+
+	rc = rsl_si(trx, i, si_len);
+	if (rc < 0) {
+		trx->si_sent.valid &= ~SI_MASK(i);
+		return rc;
+	}
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_SI_SENT]);
+
+	trx->si_sent.valid |= SI_MASK(i);
+	trx->si_sent.len[i] = si_len;
+	if (i == SYSINFO_TYPE_2quater) {
+		trx->si_sent.si2q_count = bts->si2q_count;
+		memcpy(trx->si_sent.si2q, bts->si_buf[i], (bts->si2q_count + 1) * sizeof(sysinfo_buf_t));
+	} else
+		memcpy(trx->si_sent.buf[i], GSM_BTS_SI(bts, i), sizeof(sysinfo_buf_t));
+	return 0;
+}
+
+/* Send the SI types that a TRX needs, skipping those that it already has */
+static int trx_send_system_infos(struct gsm_bts_trx *trx)
+{
+	struct gsm_bts *bts = trx->bts;
+	uint8_t gen_si[_MAX_SYSINFO_TYPE], n_si = 0, n;
+	int i, rc;
 
 	/* First, we determine which of the SI messages we actually need */
 
@@ -160,31 +325,7 @@ int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
 	gen_si[n_si++] = SYSINFO_TYPE_5ter;
 	gen_si[n_si++] = SYSINFO_TYPE_6;
 
-	/* Second, we generate the selected SI via RSL */
-
-	for (n = 0; n < n_si; n++) {
-		i = gen_si[n];
-		/* Only generate SI if this SI is not in "static" (user-defined) mode */
-		if (!(bts->si_mode_static & (1 << i))) {
-			/* Set SI as being valid. gsm_generate_si() might unset
-			 * it, if SI is not required. */
-			bts->si_valid |= (1 << i);
-			rc = gsm_generate_si(bts, i);
-			if (rc < 0)
-				goto err_out;
-			si_len[i] = rc;
-		} else {
-			if (i == SYSINFO_TYPE_5 || i == SYSINFO_TYPE_5bis
-			 || i == SYSINFO_TYPE_5ter)
-				si_len[i] = 18;
-			else if (i == SYSINFO_TYPE_6)
-				si_len[i] = 11;
-			else
-				si_len[i] = 23;
-		}
-	}
-
-	/* Third, we send the selected SI via RSL */
+	/* Then, we send the selected SI via RSL */
 
 	for (n = 0; n < n_si; n++) {
 		i = gen_si[n];
@@ -194,47 +335,71 @@ int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
 		 * might have previously been active */
 		if (!GSM_BTS_HAS_SI(bts, i)) {
 			if (bts->si_unused_send_empty)
-				rc = rsl_si(trx, i, 0);
+				rc = rsl_si_if_changed(trx, i, 0);
 			else
 				rc = 0; /* some nanoBTS fw don't like receiving empty unsupported SI */
 		} else
-			rc = rsl_si(trx, i, si_len[i]);
+			rc = rsl_si_if_changed(trx, i, bts->si_len[i]);
 		if (rc < 0)
 			return rc;
 	}
 
+	return 0;
+}
+
+/* Generate and send all system information types for a TRX, e.g. after its RSL link came up. The TRX
+ * is assumed to have none of them, so all of them are sent. */
+int gsm_bts_trx_set_system_infos(struct gsm_bts_trx *trx)
+{
+	struct gsm_bts *bts = trx->bts;
+	int rc;
+
+	rc = bts_generate_system_infos(bts, SI_DIRTY_ALL);
+	if (rc < 0)
+		return rc;
+
+	trx->si_sent.valid = 0;
+	rc = trx_send_system_infos(trx);
+	if (rc < 0)
+		return rc;
+
 	/* Make sure the PCU is aware (in case anything GPRS related has
 	 * changed in SI */
 	pcu_info_update(bts);
 
 	return 0;
-err_out:
-	LOGP(DRR, LOGL_ERROR, "Cannot generate SI%s for BTS %u: error <%s>, "
-	     "most likely a problem with neighbor cell list generation\n",
-	     get_value_string(osmo_sitype_strs, i), bts->nr, strerror(-rc));
-	return rc;
 }
 
-/* set all system information types for a BTS */
-int gsm_bts_set_system_infos(struct gsm_bts *bts)
+/* Regenerate the SI types in si_dirty (a mask of SI_DIRTY_* or SI_MASK()) and those depending on them,
+ * and send each TRX of the BTS only the SI whose content differs from what it was sent last. */
+int gsm_bts_update_system_infos(struct gsm_bts *bts, uint32_t si_dirty)
 {
 	struct gsm_bts_trx *trx;
+	int rc;
 
-	/* Generate a new ID */
-	bts->bcch_change_mark += 1;
-	bts->bcch_change_mark %= 0x7;
+	rc = bts_generate_system_infos(bts, si_dirty);
+	if (rc < 0)
+		return rc;
 
 	llist_for_each_entry(trx, &bts->trx_list, list) {
-		int rc;
-
-		rc = gsm_bts_trx_set_system_infos(trx);
+		rc = trx_send_system_infos(trx);
 		if (rc != 0)
 			return rc;
 	}
 
+	/* Make sure the PCU is aware (in case anything GPRS related has
+	 * changed in SI */
+	pcu_info_update(bts);
+
 	return 0;
 }
 
+/* set all system information types for a BTS */
+int gsm_bts_set_system_infos(struct gsm_bts *bts)
+{
+	return gsm_bts_update_system_infos(bts, SI_DIRTY_ALL);
+}
+
 /* XXX hard-coded for now */
 #define T3122_CHAN_LOAD_SAMPLE_INTERVAL 1 /* in seconds */
 
@@ -243,8 +408,11 @@ static void update_t3122_chan_load_timer(void *data)
 	struct gsm_network *net = data;
 	struct gsm_bts *bts;
 
-	llist_for_each_entry(bts, &net->bts_list, list)
+	llist_for_each_entry(bts, &net->bts_list, list) {
 		bts_update_t3122_chan_load(bts);
+		ccch_overload_update(bts);
+		dyn_ts_reserve_update(bts);
+	}
 
 	/* Keep this timer ticking. */
 	osmo_timer_schedule(&net->t3122_chan_load_timer, T3122_CHAN_LOAD_SAMPLE_INTERVAL, 0);
@@ -31,6 +31,7 @@
 #include <osmocom/bsc/lchan_rtp_fsm.h>
 #include <osmocom/bsc/bsc_subscriber.h>
 #include <osmocom/bsc/osmo_bsc_sigtran.h>
+#include <osmocom/bsc/sccp_conn_id.h>
 #include <osmocom/bsc/osmo_bsc_lcls.h>
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
 #include <osmocom/bsc/osmo_bsc.h>
@@ -43,6 +44,7 @@
 #include <osmocom/bsc/codec_pref.h>
 #include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
 #include <osmocom/core/byteswap.h>
+#include <osmocom/core/timer_compat.h>
 
 #define S(x)	(1 << (x))
 
@@ -239,7 +241,7 @@ static void handle_bssap_n_connect(struct osmo_fsm_inst *fi, struct osmo_scu_pri
 				       &scu_prim->u.connect.called_addr, NULL, 0);
 
 		/* Make sure the conn FSM will osmo_sccp_tx_disconn() on term */
-		conn->sccp.state = SUBSCR_SCCP_ST_CONNECTED;
+		gscon_sccp_state_set(conn, SUBSCR_SCCP_ST_CONNECTED);
 
 		/* Inter-BSC MT Handover Request, another BSS is handovering to us. */
 		handover_start_inter_bsc_in(conn, msg);
@@ -805,7 +807,7 @@ static void gscon_cleanup(struct osmo_fsm_inst *fi, enum osmo_fsm_term_cause cau
 		struct bsc_msc_data *msc = conn->sccp.msc;
 		/* FIXME: include a proper cause value / error message? */
 		osmo_sccp_tx_disconn(msc->a.sccp_user, conn->sccp.conn_id, &msc->a.bsc_addr, 0);
-		conn->sccp.state = SUBSCR_SCCP_ST_NONE;
+		gscon_sccp_state_set(conn, SUBSCR_SCCP_ST_NONE);
 	}
 
 	if (conn->bsub) {
@@ -814,6 +816,7 @@ static void gscon_cleanup(struct osmo_fsm_inst *fi, enum osmo_fsm_term_cause cau
 		conn->bsub = NULL;
 	}
 
+	sccp_conn_id_clear(conn);
 	llist_del(&conn->entry);
 	talloc_free(conn);
 }
@@ -908,6 +911,7 @@ struct gsm_subscriber_connection *bsc_subscr_con_allocate(struct gsm_network *ne
 	INIT_LLIST_HEAD(&conn->dtap_queue);
 	/* BTW, penalty timers will be initialized on-demand. */
 	conn->sccp.conn_id = -1;
+	INIT_LLIST_HEAD(&conn->sccp.conn_id_entry);
 
 	/* don't allocate from 'conn' context, as gscon_cleanup() will call talloc_free(conn) before
 	 * libosmocore will call talloc_free(conn->fi), i.e. avoid use-after-free during cleanup */
@@ -1073,6 +1077,49 @@ void gscon_update_id(struct gsm_subscriber_connection *conn)
 				  conn->bsub? bsc_subscr_id(conn->bsub) : "");
 }
 
+/* Change the state of the conn's SCCP connection and account for it in its MSC's load counters: connections
+ * count from the N-CONNECT until disconnecting, and are in flight until the MSC confirmed them. The time from
+ * N-CONNECT.req to confirmation feeds the MSC's latency average. */
+void gscon_sccp_state_set(struct gsm_subscriber_connection *conn, enum subscr_sccp_state state)
+{
+	struct bsc_msc_data *msc = conn->sccp.msc;
+	enum subscr_sccp_state old_state = conn->sccp.state;
+	struct timespec now, elapsed;
+	unsigned int latency_us;
+
+	if (state == old_state)
+		return;
+	conn->sccp.state = state;
+
+	if (!msc)
+		return;
+
+	if (old_state == SUBSCR_SCCP_ST_NONE)
+		msc->load.conns++;
+	else if (state == SUBSCR_SCCP_ST_NONE)
+		msc->load.conns--;
+
+	if (state == SUBSCR_SCCP_ST_WAIT_CONN_CONF) {
+		msc->load.in_flight++;
+		osmo_clock_gettime(CLOCK_MONOTONIC, &conn->sccp.conn_req_sent);
+		return;
+	}
+
+	if (old_state != SUBSCR_SCCP_ST_WAIT_CONN_CONF)
+		return;
+
+	msc->load.in_flight--;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, &conn->sccp.conn_req_sent, &elapsed);
+	latency_us = elapsed.tv_sec * 1000000 + elapsed.tv_nsec / 1000;
+
+	/* A connection given up before the MSC confirmed it only tells that the MSC takes at least this long;
+	 * count it only if that is longer than the average so far, so that an MSC that does not respond at
+	 * all looks slow instead of not being measured. */
+	if (state == SUBSCR_SCCP_ST_CONNECTED || latency_us > msc->load.latency_us)
+		bsc_msc_latency_sample(msc, latency_us);
+}
+
 bool gscon_is_aoip(struct gsm_subscriber_connection *conn)
 {
 	if (!conn || !conn->sccp.msc)
@@ -32,20 +32,58 @@
 #include <osmocom/bsc/bsc_subscriber.h>
 #include <osmocom/bsc/debug.h>
 
-static struct bsc_subscr *bsc_subscr_alloc(struct llist_head *list)
+/* Each BSSMAP Paging may create a subscriber that is freed again on Paging Response or expiry. Keep up to
+ * this many freed subscribers around for reuse, instead of going through talloc every time. */
+#define BSC_SUBSCR_POOL_MAX 4096
+
+/* The store itself serves as talloc context for all its subscribers, so that the bsc_subscr API does not
+ * need to know about struct gsm_network, and unit tests do not require gsm_data.h. */
+struct bsc_subscr_store *bsc_subscr_store_alloc(void *ctx)
 {
-	struct bsc_subscr *bsub;
+	struct bsc_subscr_store *bsubst;
 
-	bsub = talloc_zero(list, struct bsc_subscr);
-	if (!bsub)
+	bsubst = talloc_zero(ctx, struct bsc_subscr_store);
+	if (!bsubst)
 		return NULL;
 
-	llist_add_tail(&bsub->entry, list);
+	INIT_LLIST_HEAD(&bsubst->bsub_list);
+	INIT_LLIST_HEAD(&bsubst->free_list);
+	hash_init(bsubst->by_imsi);
+	hash_init(bsubst->by_tmsi);
+
+	return bsubst;
+}
+
+static struct bsc_subscr *bsc_subscr_alloc(struct bsc_subscr_store *bsubst)
+{
+	struct bsc_subscr *bsub;
+
+	if (!llist_empty(&bsubst->free_list)) {
+		bsub = llist_first_entry(&bsubst->free_list, struct bsc_subscr, entry);
+		llist_del(&bsub->entry);
+		bsubst->free_list_len--;
+		memset(bsub, 0, sizeof(*bsub));
+	} else {
+		bsub = talloc_zero(bsubst, struct bsc_subscr);
+		if (!bsub)
+			return NULL;
+	}
+
+	bsub->store = bsubst;
+	INIT_LLIST_HEAD(&bsub->hentry_imsi);
+	INIT_LLIST_HEAD(&bsub->hentry_tmsi);
+	INIT_LLIST_HEAD(&bsub->active_paging_requests);
+	llist_add_tail(&bsub->entry, &bsubst->bsub_list);
 
 	return bsub;
 }
 
-struct bsc_subscr *bsc_subscr_find_by_imsi(struct llist_head *list,
+static struct llist_head *imsi_bucket(struct bsc_subscr_store *bsubst, const char *imsi)
+{
+	return &bsubst->by_imsi[hash_str(imsi, HASH_BITS(bsubst->by_imsi))];
+}
+
+struct bsc_subscr *bsc_subscr_find_by_imsi(struct bsc_subscr_store *bsubst,
 					   const char *imsi)
 {
 	struct bsc_subscr *bsub;
@@ -53,14 +91,14 @@ struct bsc_subscr *bsc_subscr_find_by_imsi(struct llist_head *list,
 	if (!imsi || !*imsi)
 		return NULL;
 
-	llist_for_each_entry(bsub, list, entry) {
+	llist_for_each_entry(bsub, imsi_bucket(bsubst, imsi), hentry_imsi) {
 		if (!strcmp(bsub->imsi, imsi))
 			return bsc_subscr_get(bsub);
 	}
 	return NULL;
 }
 
-struct bsc_subscr *bsc_subscr_find_by_tmsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_by_tmsi(struct bsc_subscr_store *bsubst,
 					   uint32_t tmsi)
 {
 	struct bsc_subscr *bsub;
@@ -68,7 +106,7 @@ struct bsc_subscr *bsc_subscr_find_by_tmsi(struct llist_head *list,
 	if (tmsi == GSM_RESERVED_TMSI)
 		return NULL;
 
-	llist_for_each_entry(bsub, list, entry) {
+	hash_for_each_possible(bsubst->by_tmsi, bsub, hentry_tmsi, tmsi) {
 		if (bsub->tmsi == tmsi)
 			return bsc_subscr_get(bsub);
 	}
@@ -79,34 +117,48 @@ void bsc_subscr_set_imsi(struct bsc_subscr *bsub, const char *imsi)
 {
 	if (!bsub)
 		return;
+	hash_del(&bsub->hentry_imsi);
 	osmo_strlcpy(bsub->imsi, imsi, sizeof(bsub->imsi));
+	/* Add to the tail, so that lookups find the oldest subscriber with a given IMSI first */
+	if (bsub->imsi[0])
+		llist_add_tail(&bsub->hentry_imsi, imsi_bucket(bsub->store, bsub->imsi));
+}
+
+void bsc_subscr_set_tmsi(struct bsc_subscr *bsub, uint32_t tmsi)
+{
+	if (!bsub)
+		return;
+	hash_del(&bsub->hentry_tmsi);
+	bsub->tmsi = tmsi;
+	if (tmsi != GSM_RESERVED_TMSI)
+		llist_add_tail(&bsub->hentry_tmsi, hash_bucket(bsub->store->by_tmsi, tmsi));
 }
 
-struct bsc_subscr *bsc_subscr_find_or_create_by_imsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_or_create_by_imsi(struct bsc_subscr_store *bsubst,
 						     const char *imsi)
 {
 	struct bsc_subscr *bsub;
-	bsub = bsc_subscr_find_by_imsi(list, imsi);
+	bsub = bsc_subscr_find_by_imsi(bsubst, imsi);
 	if (bsub)
 		return bsub;
-	bsub = bsc_subscr_alloc(list);
+	bsub = bsc_subscr_alloc(bsubst);
 	if (!bsub)
 		return NULL;
 	bsc_subscr_set_imsi(bsub, imsi);
 	return bsc_subscr_get(bsub);
 }
 
-struct bsc_subscr *bsc_subscr_find_or_create_by_tmsi(struct llist_head *list,
+struct bsc_subscr *bsc_subscr_find_or_create_by_tmsi(struct bsc_subscr_store *bsubst,
 						     uint32_t tmsi)
 {
 	struct bsc_subscr *bsub;
-	bsub = bsc_subscr_find_by_tmsi(list, tmsi);
+	bsub = bsc_subscr_find_by_tmsi(bsubst, tmsi);
 	if (bsub)
 		return bsub;
-	bsub = bsc_subscr_alloc(list);
+	bsub = bsc_subscr_alloc(bsubst);
 	if (!bsub)
 		return NULL;
-	bsub->tmsi = tmsi;
+	bsc_subscr_set_tmsi(bsub, tmsi);
 	return bsc_subscr_get(bsub);
 }
 
@@ -138,8 +190,16 @@ const char *bsc_subscr_id(struct bsc_subscr *bsub)
 
 static void bsc_subscr_free(struct bsc_subscr *bsub)
 {
+	hash_del(&bsub->hentry_imsi);
+	hash_del(&bsub->hentry_tmsi);
 	llist_del(&bsub->entry);
-	talloc_free(bsub);
+
+	if (bsub->store->free_list_len >= BSC_SUBSCR_POOL_MAX) {
+		talloc_free(bsub);
+		return;
+	}
+	llist_add(&bsub->entry, &bsub->store->free_list);
+	bsub->store->free_list_len++;
 }
 
 struct bsc_subscr *_bsc_subscr_get(struct bsc_subscr *bsub,
@@ -45,6 +45,7 @@
 #include <osmocom/bsc/abis_nm.h>
 #include <osmocom/bsc/abis_om2000.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/timer_compat.h>
 #include <osmocom/gsm/gsm_utils.h>
 #include <osmocom/gsm/abis_nm.h>
 #include <osmocom/bsc/chan_alloc.h>
@@ -71,6 +72,7 @@
 #include <osmocom/bsc/lchan_fsm.h>
 #include <osmocom/bsc/lchan_select.h>
 #include <osmocom/bsc/smscb.h>
+#include <osmocom/bsc/latency_prof.h>
 #include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
 
 #include <inttypes.h>
@@ -345,6 +347,27 @@ static void bts_dump_vty_features(struct vty *vty, struct gsm_bts *bts)
 		vty_out(vty, "    (not available)%s", VTY_NEWLINE);
 }
 
+static void bts_dump_vty_oml_bringup(struct vty *vty, struct gsm_bts *bts)
+{
+	struct timespec duration;
+
+	vty_out(vty, "  OML window: %u configured, %u pending, %u queued%s",
+		bts->oml_window, bts->abis_nm_pend_count, llist_count(&bts->abis_queue), VTY_NEWLINE);
+	if (!bts->oml_bringup.started)
+		return;
+
+	vty_out(vty, "  OML bring-up: %u requests, max %u pending, %u unmatched responses",
+		bts->oml_bringup.requests, bts->oml_bringup.max_pend, bts->oml_bringup.unmatched);
+	if (bts->oml_bringup.last_drained.tv_sec || bts->oml_bringup.last_drained.tv_nsec) {
+		timespecsub(&bts->oml_bringup.last_drained, &bts->oml_bringup.first_tx, &duration);
+		vty_out(vty, ", took %ld.%03ld s", (long)duration.tv_sec, duration.tv_nsec / 1000000);
+	}
+	vty_out(vty, "%s", VTY_NEWLINE);
+	if (bts->oml_bringup.responses)
+		vty_out(vty, "  OML round trip: avg %"PRIu64" us, max %"PRIu32" us%s",
+			bts->oml_bringup.rtt_sum_us / bts->oml_bringup.responses, bts->oml_bringup.rtt_max_us, VTY_NEWLINE);
+}
+
 static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 {
 	struct pchan_load pl;
@@ -413,6 +436,26 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 			acc_ramp_get_step_size(&bts->acc_ramp),
 			acc_ramp_get_step_size(&bts->acc_ramp) > 1 ? "es" : "", VTY_NEWLINE);
 	}
+	vty_out(vty, "  CCCH overload control: %senabled%s",
+		bts->ccch_overload.enabled ? "" : "not ", VTY_NEWLINE);
+	if (bts->ccch_overload.enabled)
+		vty_out(vty, "  CCCH overload: %u of ACC 0-9 barred (mask 0x%03x), T3122 %u s, overloaded: %s%s",
+			bts->ccch_overload.level, bts->acc_ramp.overload_barred_accs, bts->ccch_overload.t3122,
+			ccch_overload_causes_str(bts->ccch_overload.causes), VTY_NEWLINE);
+	if (bts->dyn_ts_reserve.max) {
+		vty_out(vty, "  Dynamic TS reserve: %u of %u ready (min %u, max %u),"
+			" forecast %u.%03u TCH requests/s over %u s%s",
+			bts->dyn_ts_reserve.ready, bts->dyn_ts_reserve.target,
+			bts->dyn_ts_reserve.min, bts->dyn_ts_reserve.max,
+			bts->dyn_ts_reserve.rate_milli / 1000, bts->dyn_ts_reserve.rate_milli % 1000,
+			bts->dyn_ts_reserve.horizon, VTY_NEWLINE);
+		vty_out(vty, "  Dynamic TS reserve: %"PRIu64" hits, %"PRIu64" ms setup time saved (PDCH deact %u ms),"
+			" %"PRIu64" PDCH timeslot-seconds given up%s",
+			bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_HIT].current,
+			bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_SAVED_MS].current,
+			bts->dyn_ts_reserve.pdch_deact_ms,
+			bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_PDCH_LOST].current, VTY_NEWLINE);
+	}
 	vty_out(vty, "  RACH TX-Integer: %u%s", bts->si_common.rach_control.tx_integer,
 		VTY_NEWLINE);
 	vty_out(vty, "  RACH Max transmissions: %u%s",
@@ -484,6 +527,7 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 		vty_out(vty, "  E1 Signalling Link:%s", VTY_NEWLINE);
 		e1isl_dump_vty(vty, bts->oml_link);
 	}
+	bts_dump_vty_oml_bringup(vty, bts);
 
 	vty_out(vty, "  Neighbor Cells: ");
 	switch (bts->neigh_list_manual_mode) {
@@ -516,9 +560,14 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 	bts_dump_vty_cbch(vty, &bts->cbch_basic);
 	bts_dump_vty_cbch(vty, &bts->cbch_extended);
 
-	vty_out(vty, "  Channel Requests        : %"PRIu64" total, %"PRIu64" no channel%s",
+	vty_out(vty, "  Channel Requests        : %"PRIu64" total, %"PRIu64" no channel, %"PRIu64" duplicate%s",
 		bts->bts_ctrs->ctr[BTS_CTR_CHREQ_TOTAL].current,
 		bts->bts_ctrs->ctr[BTS_CTR_CHREQ_NO_CHANNEL].current,
+		bts->bts_ctrs->ctr[BTS_CTR_CHREQ_DUPLICATE].current,
+		VTY_NEWLINE);
+	vty_out(vty, "  Imm. Assignment Rejects : %"PRIu64" sent, %"PRIu64" AGCH blocks saved by coalescing%s",
+		bts->bts_ctrs->ctr[BTS_CTR_IMM_ASS_REJ_SENT].current,
+		bts->bts_ctrs->ctr[BTS_CTR_IMM_ASS_REJ_COALESCED].current,
 		VTY_NEWLINE);
 	vty_out(vty, "  Channel Failures        : %"PRIu64" rf_failures, %"PRIu64" rll failures%s",
 		bts->bts_ctrs->ctr[BTS_CTR_CHAN_RF_FAIL].current,
@@ -849,6 +898,29 @@ static void config_write_bts_amr(struct vty *vty, struct gsm_bts *bts,
 		vty_out(vty, "auto%s", VTY_NEWLINE);
 }
 
+static void config_write_ccch_overload(struct vty *vty, const struct ccch_overload *ol)
+{
+	if (ol->enabled)
+		vty_out(vty, "  ccch overload-control%s", VTY_NEWLINE);
+	if (ol->rach_busy_target != CCCH_OVERLOAD_RACH_BUSY_DEFAULT)
+		vty_out(vty, "  ccch overload-control target rach-busy %u%s", ol->rach_busy_target, VTY_NEWLINE);
+	if (ol->rach_access_target != CCCH_OVERLOAD_RACH_ACCESS_DEFAULT)
+		vty_out(vty, "  ccch overload-control target rach-access %u%s", ol->rach_access_target, VTY_NEWLINE);
+	if (ol->sdcch_target != CCCH_OVERLOAD_SDCCH_DEFAULT)
+		vty_out(vty, "  ccch overload-control target sdcch %u%s", ol->sdcch_target, VTY_NEWLINE);
+	if (ol->paging_queue_target != CCCH_OVERLOAD_PAGING_QUEUE_DEFAULT)
+		vty_out(vty, "  ccch overload-control target paging-queue %u%s", ol->paging_queue_target,
+			VTY_NEWLINE);
+	if (ol->hysteresis != CCCH_OVERLOAD_HYSTERESIS_DEFAULT)
+		vty_out(vty, "  ccch overload-control hysteresis %u%s", ol->hysteresis, VTY_NEWLINE);
+	if (ol->max_barred != CCCH_OVERLOAD_MAX_BARRED_DEFAULT)
+		vty_out(vty, "  ccch overload-control max-barred %u%s", ol->max_barred, VTY_NEWLINE);
+	if (ol->bar_interval != CCCH_OVERLOAD_BAR_INTERVAL_DEFAULT
+	    || ol->release_interval != CCCH_OVERLOAD_RELEASE_INTERVAL_DEFAULT)
+		vty_out(vty, "  ccch overload-control interval bar %u release %u%s",
+			ol->bar_interval, ol->release_interval, VTY_NEWLINE);
+}
+
 static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 {
 	int i;
@@ -927,6 +999,12 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 	if (bts->ccch_load_ind_thresh != 10)
 		vty_out(vty, "  ccch load-indication-threshold %u%s",
 			bts->ccch_load_ind_thresh, VTY_NEWLINE);
+	config_write_ccch_overload(vty, &bts->ccch_overload);
+	if (bts->dyn_ts_reserve.max)
+		vty_out(vty, "  dyn-ts-reserve min %u max %u%s",
+			bts->dyn_ts_reserve.min, bts->dyn_ts_reserve.max, VTY_NEWLINE);
+	if (bts->dyn_ts_reserve.horizon != DYN_TS_RESERVE_HORIZON_DEFAULT)
+		vty_out(vty, "  dyn-ts-reserve horizon %u%s", bts->dyn_ts_reserve.horizon, VTY_NEWLINE);
 	if (bts->rach_b_thresh != -1)
 		vty_out(vty, "  rach nm busy threshold %u%s",
 			bts->rach_b_thresh, VTY_NEWLINE);
@@ -995,6 +1073,10 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 		vty_out(vty, "  oml e1 tei %u%s", bts->oml_tei, VTY_NEWLINE);
 		break;
 	}
+	if (bts->oml_window != 1)
+		vty_out(vty, "  oml window %u%s", bts->oml_window, VTY_NEWLINE);
+	if (bts->admission.priority)
+		vty_out(vty, "  admission-priority %u%s", bts->admission.priority, VTY_NEWLINE);
 
 	/* if we have a limit, write it */
 	if (bts->paging.free_chans_need >= 0)
@@ -1154,7 +1236,22 @@ static int config_write_net(struct vty *vty)
 		if (strlen(meas_scenario) > 0)
 			vty_out(vty, " meas-feed scenario %s%s",
 				meas_scenario, VTY_NEWLINE);
-	}
+		if (meas_feed_version_get() != MEAS_FEED_VERSION)
+			vty_out(vty, " meas-feed version %u%s",
+				meas_feed_version_get(), VTY_NEWLINE);
+		if (meas_feed_batch_interval_get() != MEAS_FEED_BATCH_INTERVAL_DEFAULT)
+			vty_out(vty, " meas-feed batch-interval %u%s",
+				meas_feed_batch_interval_get(), VTY_NEWLINE);
+		if (meas_feed_sendmmsg_get())
+			vty_out(vty, " meas-feed sendmmsg%s", VTY_NEWLINE);
+	}
+
+	if (gsmnet->bts_admission.max_parallel != BTS_ADMISSION_MAX_PARALLEL_DEFAULT)
+		vty_out(vty, " bts-admission max-parallel %u%s",
+			gsmnet->bts_admission.max_parallel, VTY_NEWLINE);
+	if (gsmnet->bts_admission.timeout != BTS_ADMISSION_TIMEOUT_DEFAULT)
+		vty_out(vty, " bts-admission timeout %u%s",
+			gsmnet->bts_admission.timeout, VTY_NEWLINE);
 
 	if (gsmnet->allow_unusable_timeslots)
 		vty_out(vty, " allow-unusable-timeslots%s", VTY_NEWLINE);
@@ -1398,7 +1495,7 @@ static void meas_rep_dump_uni_vty(struct vty *vty,
 		VTY_NEWLINE);
 }
 
-static void meas_rep_dump_vty(struct vty *vty, struct gsm_meas_rep *mr,
+static void meas_rep_dump_vty(struct vty *vty, const struct gsm_meas_rep *mr,
 			      const char *prefix)
 {
 	vty_out(vty, "%sMeasurement Report:%s", prefix, VTY_NEWLINE);
@@ -1448,8 +1545,6 @@ DEFUN(show_trx_con,
 
 static void lchan_dump_full_vty(struct vty *vty, struct gsm_lchan *lchan)
 {
-	int idx;
-
 	vty_out(vty, "BTS %u, TRX %u, Timeslot %u, Lchan %u: Type %s%s",
 		lchan->ts->trx->bts->nr, lchan->ts->trx->nr, lchan->ts->nr,
 		lchan->nr, gsm_lchant_name(lchan->type), VTY_NEWLINE);
@@ -1492,20 +1587,15 @@ static void lchan_dump_full_vty(struct vty *vty, struct gsm_lchan *lchan)
 	}
 
 	/* we want to report the last measurement report */
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-			       lchan->meas_rep_idx, 1);
-	meas_rep_dump_vty(vty, &lchan->meas_rep[idx], "  ");
+	meas_rep_dump_vty(vty, lchan_meas_rep_last(lchan), "  ");
 }
 
 static void lchan_dump_short_vty(struct vty *vty, struct gsm_lchan *lchan)
 {
-	struct gsm_meas_rep *mr;
-	int idx;
+	const struct gsm_meas_rep *mr;
 
 	/* we want to report the last measurement report */
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-			       lchan->meas_rep_idx, 1);
-	mr =  &lchan->meas_rep[idx];
+	mr = lchan_meas_rep_last(lchan);
 
 	vty_out(vty, "BTS %u, TRX %u, Timeslot %u %s",
 		lchan->ts->trx->bts->nr, lchan->ts->trx->nr, lchan->ts->nr,
@@ -2198,7 +2288,7 @@ DEFUN(cfg_bts_ci,
 			ci, VTY_NEWLINE);
 		return CMD_WARNING;
 	}
-	bts->cell_identity = ci;
+	gsm_bts_set_ci(bts, ci);
 
 	return CMD_SUCCESS;
 }
@@ -2223,7 +2313,7 @@ DEFUN(cfg_bts_lac,
 		return CMD_WARNING;
 	}
 
-	bts->location_area_code = lac;
+	gsm_bts_set_lac(bts, lac);
 
 	return CMD_SUCCESS;
 }
@@ -2252,7 +2342,7 @@ DEFUN(cfg_bts_bsic,
 			bsic, VTY_NEWLINE);
 		return CMD_WARNING;
 	}
-	bts->bsic = bsic;
+	gsm_bts_set_bsic(bts, bsic);
 
 	return CMD_SUCCESS;
 }
@@ -2448,6 +2538,34 @@ DEFUN(cfg_bts_oml_e1_tei,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_bts_oml_window,
+      cfg_bts_oml_window_cmd,
+      "oml window <1-" OSMO_STRINGIFY_VAL(ABIS_NM_WINDOW_MAX) ">",
+	OML_STR
+      "Number of OML requests that may await a response at the same time"
+      " (BTS models that need strict serialization always use 1)\n"
+      "Number of outstanding requests, 1 for stop-and-wait\n")
+{
+	struct gsm_bts *bts = vty->index;
+
+	bts->oml_window = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_admission_priority,
+      cfg_bts_admission_priority_cmd,
+      "admission-priority <0-255>",
+      "Order of bring-up when more BTS connect than 'bts-admission max-parallel' allows\n"
+      "Priority, BTS with higher values are brought up first\n")
+{
+	struct gsm_bts *bts = vty->index;
+
+	bts->admission.priority = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_bts_challoc, cfg_bts_challoc_cmd,
       "channel allocator (ascending|descending)",
 	"Channel Allocator\n" "Channel Allocator\n"
@@ -2571,6 +2689,155 @@ DEFUN(cfg_bts_ccch_load_ind_thresh,
 	return CMD_SUCCESS;
 }
 
+#define CCCH_OVERLOAD_STR "Bar Access Control Classes and stretch T3122 while the CCCH is overloaded\n"
+
+DEFUN(cfg_bts_ccch_overload,
+      cfg_bts_ccch_overload_cmd,
+      "ccch overload-control",
+      CCCH_STR CCCH_OVERLOAD_STR)
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.enabled = true;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_no_ccch_overload,
+      cfg_bts_no_ccch_overload_cmd,
+      "no ccch overload-control",
+      NO_STR CCCH_STR CCCH_OVERLOAD_STR)
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.enabled = false;
+	ccch_overload_reset(bts);
+	return CMD_SUCCESS;
+}
+
+#define CCCH_OVERLOAD_TARGET_STR CCCH_STR CCCH_OVERLOAD_STR \
+	"Load at or above which one more ACC is barred every 'bar' interval\n"
+
+DEFUN(cfg_bts_ccch_overload_target_percent,
+      cfg_bts_ccch_overload_target_percent_cmd,
+      "ccch overload-control target (rach-busy|rach-access|sdcch) <1-100>",
+      CCCH_OVERLOAD_TARGET_STR
+      "RACH slots with signal above the busy threshold, from CCCH LOAD IND (default "
+      OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_RACH_BUSY_DEFAULT) ")\n"
+      "RACH slots with access bursts, from CCCH LOAD IND (default "
+      OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_RACH_ACCESS_DEFAULT) ")\n"
+      "SDCCH in use (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_SDCCH_DEFAULT) ")\n"
+      "Target in percent\n")
+{
+	struct gsm_bts *bts = vty->index;
+	unsigned int target = atoi(argv[1]);
+
+	if (!strcmp(argv[0], "rach-busy"))
+		bts->ccch_overload.rach_busy_target = target;
+	else if (!strcmp(argv[0], "rach-access"))
+		bts->ccch_overload.rach_access_target = target;
+	else
+		bts->ccch_overload.sdcch_target = target;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_ccch_overload_target_paging,
+      cfg_bts_ccch_overload_target_paging_cmd,
+      "ccch overload-control target paging-queue <1-65535>",
+      CCCH_OVERLOAD_TARGET_STR
+      "Paging requests waiting to be sent (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_PAGING_QUEUE_DEFAULT) ")\n"
+      "Number of paging requests\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.paging_queue_target = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_ccch_overload_hysteresis,
+      cfg_bts_ccch_overload_hysteresis_cmd,
+      "ccch overload-control hysteresis <0-99>",
+      CCCH_STR CCCH_OVERLOAD_STR
+      "Allow barred ACCs again only while all loads are this far below their targets\n"
+      "Percentage of each target (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_HYSTERESIS_DEFAULT) ")\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.hysteresis = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_ccch_overload_max_barred,
+      cfg_bts_ccch_overload_max_barred_cmd,
+      "ccch overload-control max-barred <1-10>",
+      CCCH_STR CCCH_OVERLOAD_STR
+      "Maximum number of ACC 0-9 to bar\n"
+      "Number of ACCs (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_MAX_BARRED_DEFAULT) ")\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.max_barred = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_ccch_overload_interval,
+      cfg_bts_ccch_overload_interval_cmd,
+      "ccch overload-control interval bar <1-60> release <1-600>",
+      CCCH_STR CCCH_OVERLOAD_STR
+      "Pace of barring and allowing ACCs\n"
+      "Time between barring one more ACC while overloaded\n"
+      "Seconds (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_BAR_INTERVAL_DEFAULT) ")\n"
+      "Time between allowing one ACC again while the load is below the targets by the hysteresis\n"
+      "Seconds (default " OSMO_STRINGIFY_VAL(CCCH_OVERLOAD_RELEASE_INTERVAL_DEFAULT) ")\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->ccch_overload.bar_interval = atoi(argv[0]);
+	bts->ccch_overload.release_interval = atoi(argv[1]);
+	return CMD_SUCCESS;
+}
+
+#define DYN_TS_RESERVE_STR "Keep idle dynamic timeslots switched out of PDCH for expected TCH demand\n"
+
+DEFUN(cfg_bts_dyn_ts_reserve,
+      cfg_bts_dyn_ts_reserve_cmd,
+      "dyn-ts-reserve min <0-255> max <1-255>",
+      DYN_TS_RESERVE_STR
+      "Number of dynamic timeslots to keep out of PDCH regardless of the forecast\n"
+      "Number of timeslots\n"
+      "Number of dynamic timeslots to keep out of PDCH at most\n"
+      "Number of timeslots\n")
+{
+	struct gsm_bts *bts = vty->index;
+	unsigned int min = atoi(argv[0]);
+	unsigned int max = atoi(argv[1]);
+
+	if (min > max) {
+		vty_out(vty, "%% min must not exceed max%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	bts->dyn_ts_reserve.min = min;
+	bts->dyn_ts_reserve.max = max;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_no_dyn_ts_reserve,
+      cfg_bts_no_dyn_ts_reserve_cmd,
+      "no dyn-ts-reserve",
+      NO_STR DYN_TS_RESERVE_STR)
+{
+	struct gsm_bts *bts = vty->index;
+	/* Reserved timeslots go back to PDCH on the next evaluation */
+	bts->dyn_ts_reserve.min = 0;
+	bts->dyn_ts_reserve.max = 0;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_dyn_ts_reserve_horizon,
+      cfg_bts_dyn_ts_reserve_horizon_cmd,
+      "dyn-ts-reserve horizon <1-60>",
+      DYN_TS_RESERVE_STR
+      "Keep as many timeslots ready as TCH requests are expected within this time\n"
+      "Seconds (default " OSMO_STRINGIFY_VAL(DYN_TS_RESERVE_HORIZON_DEFAULT) ")\n")
+{
+	struct gsm_bts *bts = vty->index;
+	bts->dyn_ts_reserve.horizon = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
 #define NM_STR "Network Management\n"
 
 DEFUN(cfg_bts_rach_nm_b_thresh,
@@ -3597,7 +3864,7 @@ DEFUN(cfg_bts_no_acc_ramping, cfg_bts_no_acc_ramping_cmd,
 	if (acc_ramp_is_enabled(&bts->acc_ramp)) {
 		acc_ramp_abort(&bts->acc_ramp);
 		acc_ramp_set_enabled(&bts->acc_ramp, false);
-		gsm_bts_set_system_infos(bts);
+		gsm_bts_update_system_infos(bts, SI_DIRTY_ACC);
 	}
 
 	return CMD_SUCCESS;
@@ -4284,7 +4551,7 @@ DEFUN(cfg_trx_arfcn,
 
 	/* FIXME: check if this ARFCN is supported by this TRX */
 
-	trx->arfcn = arfcn;
+	gsm_bts_trx_set_arfcn(trx, arfcn);
 
 	/* FIXME: patch ARFCN into SYSTEM INFORMATION */
 	/* FIXME: use OML layer to update the ARFCN */
@@ -5292,6 +5559,183 @@ DEFUN(cfg_net_meas_feed_scenario, cfg_net_meas_feed_scenario_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_net_meas_feed_version, cfg_net_meas_feed_version_cmd,
+	"meas-feed version (1|2)",
+	MEAS_FEED_STR "Select the format of the Measurement Report feed\n"
+	"Version 1: one report per datagram, in host byte order and struct layout\n"
+	"Version 2: batches of compact reports per datagram, in network byte order\n")
+{
+	meas_feed_version_set(atoi(argv[0]));
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_meas_feed_batch_interval, cfg_net_meas_feed_batch_interval_cmd,
+	"meas-feed batch-interval <1-10000>",
+	MEAS_FEED_STR "Longest time to hold back a version 2 report while its batch fills up\n"
+	"Milliseconds\n")
+{
+	meas_feed_batch_interval_set(atoi(argv[0]));
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_meas_feed_sendmmsg, cfg_net_meas_feed_sendmmsg_cmd,
+	"meas-feed sendmmsg",
+	MEAS_FEED_STR "Send several version 2 batches per sendmmsg() system call\n")
+{
+	if (meas_feed_sendmmsg_set(true) < 0) {
+		vty_out(vty, "%% sendmmsg() is not available on this system%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_no_meas_feed_sendmmsg, cfg_net_no_meas_feed_sendmmsg_cmd,
+	"no meas-feed sendmmsg",
+	NO_STR MEAS_FEED_STR "Send each version 2 batch with its own system call\n")
+{
+	meas_feed_sendmmsg_set(false);
+
+	return CMD_SUCCESS;
+}
+
+#define BTS_ADMISSION_STR "Admission of BTS to their bring-up after the OML link came up\n"
+
+DEFUN(cfg_net_bts_admission_max_parallel, cfg_net_bts_admission_max_parallel_cmd,
+	"bts-admission max-parallel <0-1000>",
+	BTS_ADMISSION_STR
+	"Number of BTS running their OML and RSL bring-up at the same time\n"
+	"Number of BTS, 0 for no limit\n")
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+
+	net->bts_admission.max_parallel = atoi(argv[0]);
+	/* admit waiting BTS if the limit was raised */
+	bts_admission_kick(net);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_net_bts_admission_timeout, cfg_net_bts_admission_timeout_cmd,
+	"bts-admission timeout <1-3600>",
+	BTS_ADMISSION_STR
+	"Time after which a BTS that is not in service yet gives up its bring-up slot\n"
+	"Timeout in seconds\n")
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+
+	net->bts_admission.timeout = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+static void vty_out_latency_hist(struct vty *vty, const char *handler, const char *msg,
+				 const struct latency_hist *h, bool histogram)
+{
+	int i;
+
+	vty_out(vty, "%-18s %-30s %10"PRIu64" %9u %9u %9u %9u%s", handler, msg, h->count,
+		latency_hist_avg_us(h), latency_hist_percentile_us(h, 50), latency_hist_percentile_us(h, 99),
+		h->max_us, VTY_NEWLINE);
+	if (!histogram)
+		return;
+	for (i = 0; i < LATENCY_PROF_BUCKETS; i++) {
+		if (!h->bucket[i])
+			continue;
+		if (i < LATENCY_PROF_BUCKETS - 1)
+			vty_out(vty, "  < %u us: %u%s", latency_hist_bucket_limit_us(i), h->bucket[i], VTY_NEWLINE);
+		else
+			vty_out(vty, "  >= %u us: %u%s", latency_hist_bucket_limit_us(i - 1), h->bucket[i],
+				VTY_NEWLINE);
+	}
+}
+
+DEFUN(show_latency, show_latency_cmd,
+	"show latency [histogram]",
+	SHOW_STR "Display the time taken by the main message handlers, recorded by 'latency-profiler enable'."
+	" VTY and CTRL commands are not broken out; they only show as main loop lag in the 'loop' row,"
+	" from probe_timer_cb()\n"
+	"Also show the histogram of each handler and message type\n")
+{
+	bool histogram = argc > 0;
+	int i, j;
+
+	vty_out(vty, "Latency profiler: %s%s", latency_prof_enabled ? "enabled" : "disabled", VTY_NEWLINE);
+	vty_out(vty, "%-18s %-30s %10s %9s %9s %9s %9s%s", "handler", "message", "count",
+		"avg[us]", "p50[us]", "p99[us]", "max[us]", VTY_NEWLINE);
+
+	for (i = 0; i < _NUM_LATENCY_PROF_HANDLERS; i++) {
+		const struct latency_hist *h = latency_prof_total(i);
+
+		if (!h->count)
+			continue;
+		if (!latency_prof_has_msg_types(i)) {
+			vty_out_latency_hist(vty, latency_prof_handler_name(i), "-", h, histogram);
+			continue;
+		}
+		vty_out_latency_hist(vty, latency_prof_handler_name(i), "(all)", h, false);
+		for (j = 0; j < 256; j++) {
+			h = latency_prof_get(i, j);
+			if (!h)
+				continue;
+			vty_out_latency_hist(vty, "", latency_prof_msg_type_name(i, j), h, histogram);
+		}
+	}
+
+	return CMD_SUCCESS;
+}
+
+#define LATENCY_PROF_STR "Time the main message handlers, see 'show latency'\n"
+
+DEFUN(latency_profiler, latency_profiler_cmd,
+	"latency-profiler (enable|disable)",
+	LATENCY_PROF_STR
+	"Start recording\n"
+	"Stop recording, keeping the samples recorded so far\n")
+{
+	latency_prof_enable(!strcmp(argv[0], "enable"));
+	return CMD_SUCCESS;
+}
+
+DEFUN(latency_profiler_reset, latency_profiler_reset_cmd,
+	"latency-profiler reset",
+	LATENCY_PROF_STR "Discard all samples\n")
+{
+	latency_prof_reset();
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_bts_admission, show_bts_admission_cmd,
+	"show bts-admission",
+	SHOW_STR "Display the bring-up order of all BTS\n")
+{
+	struct gsm_network *net = gsmnet_from_vty(vty);
+	struct bts_admission_sched *sched = &net->bts_admission;
+	struct timespec elapsed;
+	unsigned int pos;
+	struct gsm_bts *bts;
+
+	vty_out(vty, "BTS bring-up: %u in progress, limit %u (0: none), %u waiting%s",
+		sched->num_bringup, sched->max_parallel, llist_count(&sched->waiting), VTY_NEWLINE);
+
+	llist_for_each_entry(bts, &net->bts_list, list) {
+		vty_out(vty, " BTS %u: %s, priority %u", bts->nr,
+			bts_admission_state_name(bts->admission.state), bts->admission.priority);
+		pos = bts_admission_queue_pos(bts);
+		if (pos)
+			vty_out(vty, ", queue position %u", pos);
+		if (bts_admission_time_to_service(bts, &elapsed))
+			vty_out(vty, ", %s %ld.%03ld s",
+				bts->admission.state == BTS_ADMISSION_IN_SERVICE ? "time to service" : "since OML up",
+				(long)elapsed.tv_sec, elapsed.tv_nsec / 1000000);
+		vty_out(vty, "%s", VTY_NEWLINE);
+	}
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_timer, show_timer_cmd,
       "show timer " OSMO_TDEF_VTY_ARG_T_OPTIONAL,
       SHOW_STR "Show timers\n"
@@ -5369,6 +5813,12 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(GSMNET_NODE, &cfg_net_dyn_ts_allow_tch_f_cmd);
 	install_element(GSMNET_NODE, &cfg_net_meas_feed_dest_cmd);
 	install_element(GSMNET_NODE, &cfg_net_meas_feed_scenario_cmd);
+	install_element(GSMNET_NODE, &cfg_net_meas_feed_version_cmd);
+	install_element(GSMNET_NODE, &cfg_net_meas_feed_batch_interval_cmd);
+	install_element(GSMNET_NODE, &cfg_net_meas_feed_sendmmsg_cmd);
+	install_element(GSMNET_NODE, &cfg_net_no_meas_feed_sendmmsg_cmd);
+	install_element(GSMNET_NODE, &cfg_net_bts_admission_max_parallel_cmd);
+	install_element(GSMNET_NODE, &cfg_net_bts_admission_timeout_cmd);
 	install_element(GSMNET_NODE, &cfg_net_timer_cmd);
 	install_element(GSMNET_NODE, &cfg_net_allow_unusable_timeslots_cmd);
 
@@ -5376,6 +5826,8 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element_ve(&show_bts_cmd);
 	install_element_ve(&show_bts_fail_rep_cmd);
 	install_element_ve(&show_rejected_bts_cmd);
+	install_element_ve(&show_bts_admission_cmd);
+	install_element_ve(&show_latency_cmd);
 	install_element_ve(&show_trx_cmd);
 	install_element_ve(&show_trx_con_cmd);
 	install_element_ve(&show_ts_cmd);
@@ -5426,6 +5878,8 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(BTS_NODE, &cfg_bts_deprecated_stream_id_cmd);
 	install_element(BTS_NODE, &cfg_bts_oml_e1_cmd);
 	install_element(BTS_NODE, &cfg_bts_oml_e1_tei_cmd);
+	install_element(BTS_NODE, &cfg_bts_oml_window_cmd);
+	install_element(BTS_NODE, &cfg_bts_admission_priority_cmd);
 	install_element(BTS_NODE, &cfg_bts_challoc_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_tx_integer_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_max_trans_cmd);
@@ -5436,6 +5890,16 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(BTS_NODE, &cfg_bts_chan_desc_bs_ag_blks_res_cmd);
 	install_element(BTS_NODE, &cfg_bts_chan_dscr_bs_ag_blks_res_cmd);
 	install_element(BTS_NODE, &cfg_bts_ccch_load_ind_thresh_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_cmd);
+	install_element(BTS_NODE, &cfg_bts_no_ccch_overload_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_target_percent_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_target_paging_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_hysteresis_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_max_barred_cmd);
+	install_element(BTS_NODE, &cfg_bts_ccch_overload_interval_cmd);
+	install_element(BTS_NODE, &cfg_bts_dyn_ts_reserve_cmd);
+	install_element(BTS_NODE, &cfg_bts_no_dyn_ts_reserve_cmd);
+	install_element(BTS_NODE, &cfg_bts_dyn_ts_reserve_horizon_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_nm_b_thresh_cmd);
 	install_element(BTS_NODE, &cfg_bts_rach_nm_ldavg_cmd);
 	install_element(BTS_NODE, &cfg_bts_cell_barred_cmd);
@@ -5560,6 +6024,8 @@ int bsc_vty_init(struct gsm_network *network)
 	install_element(ENABLE_NODE, &assignment_subscr_conn_cmd);
 	install_element(ENABLE_NODE, &smscb_cmd_cmd);
 	install_element(ENABLE_NODE, &ctrl_trap_cmd);
+	install_element(ENABLE_NODE, &latency_profiler_cmd);
+	install_element(ENABLE_NODE, &latency_profiler_reset_cmd);
 
 	abis_nm_vty_init();
 	abis_om2k_vty_init();
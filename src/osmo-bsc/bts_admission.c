@@ -0,0 +1,216 @@
+/* Admission scheduler for BTS bring-up after mass reconnects */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/timer_compat.h>
+
+#include <osmocom/bsc/bts_admission.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/abis_nm.h>
+#include <osmocom/bsc/debug.h>
+
+const struct value_string bts_admission_state_names[] = {
+	{ BTS_ADMISSION_IDLE,		"idle" },
+	{ BTS_ADMISSION_WAITING,	"waiting" },
+	{ BTS_ADMISSION_BRINGUP,	"bring-up" },
+	{ BTS_ADMISSION_IN_SERVICE,	"in-service" },
+	{}
+};
+
+static unsigned long timespec_ms(const struct timespec *ts)
+{
+	return ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
+}
+
+static bool slot_available(const struct bts_admission_sched *sched)
+{
+	return !sched->max_parallel || sched->num_bringup < sched->max_parallel;
+}
+
+static void bts_admission_timeout_cb(void *data)
+{
+	struct gsm_bts *bts = data;
+
+	LOG_BTS(bts, DLINP, LOGL_NOTICE, "Bring-up not complete after %u s, giving up its admission slot\n",
+		bts->network->bts_admission.timeout);
+	bts_admission_done(bts);
+}
+
+static void admit(struct gsm_bts *bts)
+{
+	struct bts_admission_sched *sched = &bts->network->bts_admission;
+	struct timespec waited;
+	struct msgb *msg;
+
+	llist_del_init(&bts->admission.entry);
+	bts->admission.state = BTS_ADMISSION_BRINGUP;
+	sched->num_bringup++;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &bts->admission.admitted);
+	timespecsub(&bts->admission.admitted, &bts->admission.requested, &waited);
+	LOG_BTS(bts, DLINP, LOGL_INFO, "Admitted for bring-up after waiting %lu ms (%u of %u slots in use)\n",
+		timespec_ms(&waited), sched->num_bringup, sched->max_parallel);
+
+	osmo_timer_setup(&bts->admission.timeout, bts_admission_timeout_cb, bts);
+	osmo_timer_schedule(&bts->admission.timeout, sched->timeout, 0);
+
+	/* Process what the BTS sent while waiting. Any message may cause the OML link to be dropped, which
+	 * discards the remaining held messages. */
+	while (bts->admission.state == BTS_ADMISSION_BRINGUP
+	       && (msg = msgb_dequeue(&bts->admission.held_msgs)))
+		abis_nm_rcvmsg(msg);
+}
+
+static void bts_admission_kick_cb(void *data)
+{
+	struct gsm_network *net = data;
+	struct bts_admission_sched *sched = &net->bts_admission;
+
+	while (slot_available(sched) && !llist_empty(&sched->waiting))
+		admit(llist_entry(sched->waiting.next, struct gsm_bts, admission.entry));
+}
+
+/*! Admit waiting BTS as far as there are free slots, from a timer so that held OML messages are never
+ * processed from within the code path of another BTS. Also call when max_parallel was raised. */
+void bts_admission_kick(struct gsm_network *net)
+{
+	struct bts_admission_sched *sched = &net->bts_admission;
+
+	if (osmo_timer_pending(&sched->kick_timer))
+		return;
+	osmo_timer_setup(&sched->kick_timer, bts_admission_kick_cb, net);
+	osmo_timer_schedule(&sched->kick_timer, 0, 0);
+}
+
+/*! A new OML link came up: admit the BTS right away if there is a free slot and nobody is waiting,
+ * otherwise queue it by priority. */
+void bts_admission_request(struct gsm_bts *bts)
+{
+	struct bts_admission_sched *sched = &bts->network->bts_admission;
+	struct gsm_bts *other;
+
+	if (bts->admission.state != BTS_ADMISSION_IDLE)
+		bts_admission_release(bts);
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &bts->admission.requested);
+
+	if (slot_available(sched) && llist_empty(&sched->waiting)) {
+		admit(bts);
+		return;
+	}
+
+	/* insert behind all waiting BTS of the same or higher priority */
+	llist_for_each_entry(other, &sched->waiting, admission.entry) {
+		if (other->admission.priority < bts->admission.priority)
+			break;
+	}
+	llist_add_tail(&bts->admission.entry, &other->admission.entry);
+	bts->admission.state = BTS_ADMISSION_WAITING;
+
+	LOG_BTS(bts, DLINP, LOGL_NOTICE, "Waiting for bring-up at queue position %u (%u of %u slots in use)\n",
+		bts_admission_queue_pos(bts), sched->num_bringup, sched->max_parallel);
+}
+
+/*! Keep an OML message from \a bts for later if the BTS is not admitted yet.
+ * \returns true if \a msg was taken. */
+bool bts_admission_hold(struct gsm_bts *bts, struct msgb *msg)
+{
+	if (bts->admission.state != BTS_ADMISSION_WAITING)
+		return false;
+	msgb_enqueue(&bts->admission.held_msgs, msg);
+	return true;
+}
+
+/*! The BTS finished its bring-up (or timed out), so its slot goes to the next waiting BTS */
+void bts_admission_done(struct gsm_bts *bts)
+{
+	struct timespec elapsed;
+
+	if (bts->admission.state != BTS_ADMISSION_BRINGUP)
+		return;
+
+	osmo_timer_del(&bts->admission.timeout);
+	bts->admission.state = BTS_ADMISSION_IN_SERVICE;
+	bts->network->bts_admission.num_bringup--;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &bts->admission.in_service);
+
+	timespecsub(&bts->admission.in_service, &bts->admission.requested, &elapsed);
+	LOG_BTS(bts, DLINP, LOGL_NOTICE, "In service %lu ms after its OML link came up\n", timespec_ms(&elapsed));
+
+	bts_admission_kick(bts->network);
+}
+
+/*! The OML link went away: leave the queue or give up the slot, and discard held messages */
+void bts_admission_release(struct gsm_bts *bts)
+{
+	switch (bts->admission.state) {
+	case BTS_ADMISSION_WAITING:
+		llist_del_init(&bts->admission.entry);
+		break;
+	case BTS_ADMISSION_BRINGUP:
+		osmo_timer_del(&bts->admission.timeout);
+		bts->network->bts_admission.num_bringup--;
+		bts_admission_kick(bts->network);
+		break;
+	default:
+		break;
+	}
+
+	while (!llist_empty(&bts->admission.held_msgs))
+		msgb_free(msgb_dequeue(&bts->admission.held_msgs));
+
+	bts->admission.state = BTS_ADMISSION_IDLE;
+}
+
+/*! \returns position of a waiting BTS in the queue, starting at 1, or 0 if not waiting */
+unsigned int bts_admission_queue_pos(const struct gsm_bts *bts)
+{
+	const struct gsm_bts *other;
+	unsigned int pos = 0;
+
+	if (bts->admission.state != BTS_ADMISSION_WAITING)
+		return 0;
+
+	llist_for_each_entry(other, &bts->network->bts_admission.waiting, admission.entry) {
+		pos++;
+		if (other == bts)
+			break;
+	}
+	return pos;
+}
+
+/*! Time from the OML link coming up until the BTS was in service; while still waiting or in bring-up,
+ * the time elapsed so far.
+ * \returns false if the BTS has no OML link. */
+bool bts_admission_time_to_service(const struct gsm_bts *bts, struct timespec *elapsed)
+{
+	struct timespec now;
+
+	switch (bts->admission.state) {
+	case BTS_ADMISSION_IDLE:
+		return false;
+	case BTS_ADMISSION_IN_SERVICE:
+		timespecsub(&bts->admission.in_service, &bts->admission.requested, elapsed);
+		return true;
+	default:
+		osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+		timespecsub(&now, &bts->admission.requested, elapsed);
+		return true;
+	}
+}
@@ -69,6 +69,8 @@ struct gsm_bts_model bts_model_nanobts = {
 	 * default, can still be enabled through VTY cmd with same name.
 	 */
 	.force_combined_si = true,
+	/* ip.access and osmo-bts answer each OML request in turn, so requests may be pipelined */
+	.oml_window_max = ABIS_NM_WINDOW_MAX,
 	.nm_att_tlvdef = {
 		.def = {
 			/* ip.access specifics */
@@ -399,8 +401,10 @@ void ipaccess_drop_rsl(struct gsm_bts_trx *trx, const char *reason)
 	trx->rsl_link = NULL;
 	osmo_stat_item_dec(trx->bts->bts_statg->items[BTS_STAT_RSL_CONNECTED], 1);
 
-	if (trx->bts->c0 == trx)
+	if (trx->bts->c0 == trx) {
 		paging_flush_bts(trx->bts, NULL);
+		rsl_imm_ass_rej_discard(trx->bts);
+	}
 }
 
 void ipaccess_drop_oml(struct gsm_bts *bts, const char *reason)
@@ -419,6 +423,8 @@ void ipaccess_drop_oml(struct gsm_bts *bts, const char *reason)
 	bts->oml_link = NULL;
 	bts->uptime = 0;
 	osmo_stat_item_dec(bts->bts_statg->items[BTS_STAT_OML_CONNECTED], 1);
+	bts_admission_release(bts);
+	rsl_imm_ass_rej_discard(bts);
 
 	/* we have issues reconnecting RSL, drop everything. */
 	llist_for_each_entry(trx, &bts->trx_list, list)
@@ -561,6 +567,7 @@ ipaccess_sign_link_up(void *unit_data, struct e1inp_line *line,
 			sign_link->trx->bts->ip_access.flags |= OML_UP;
 		}
 		osmo_stat_item_inc(bts->bts_statg->items[BTS_STAT_OML_CONNECTED], 1);
+		bts_admission_request(bts);
 		break;
 	case E1INP_SIGN_RSL: {
 		struct e1inp_ts *ts;
@@ -589,6 +596,8 @@ ipaccess_sign_link_up(void *unit_data, struct e1inp_line *line,
 					(RSL_UP << sign_link->trx->nr);
 		}
 		osmo_stat_item_inc(bts->bts_statg->items[BTS_STAT_RSL_CONNECTED], 1);
+		if (all_trx_rsl_connected_unlocked(bts))
+			bts_admission_done(bts);
 		break;
 	}
 	default:
@@ -627,6 +636,9 @@ static int ipaccess_sign_link(struct msgb *msg)
 	        ret = abis_rsl_rcvmsg(msg);
 	        break;
 	case E1INP_SIGN_OML:
+		/* not admitted for bring-up yet, see bts_admission.c */
+		if (bts_admission_hold(link->trx->bts, msg))
+			break;
 	        ret = abis_nm_rcvmsg(msg);
 	        break;
 	default:
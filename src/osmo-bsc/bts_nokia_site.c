@@ -1487,7 +1487,8 @@ static void nokia_abis_nm_queue_send_next(struct gsm_bts *bts)
 			break;
 	}
 
-	bts->abis_nm_pend = wait;
+	/* Nokia sites are strictly stop-and-wait, see abis_nm_queue_send_next() for the windowed variant */
+	bts->abis_nm_pend_count = wait ? 1 : 0;
 }
 
 /* TODO: put in a separate file ? */
@@ -0,0 +1,195 @@
+/* CCCH overload control: bar Access Control Classes and stretch T3122 from live load */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+
+#include <osmocom/core/tdef.h>
+
+#include <osmocom/bsc/ccch_overload.h>
+#include <osmocom/bsc/acc_ramp.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/debug.h>
+
+const struct value_string ccch_overload_cause_names[] = {
+	{ CCCH_OVERLOAD_RACH_BUSY,	"rach-busy" },
+	{ CCCH_OVERLOAD_RACH_ACCESS,	"rach-access" },
+	{ CCCH_OVERLOAD_SDCCH,		"sdcch" },
+	{ CCCH_OVERLOAD_PAGING,		"paging" },
+	{ CCCH_OVERLOAD_AGCH,		"agch" },
+	{}
+};
+
+/*! \returns the names of all causes set in \a causes, separated by commas, or "none" */
+const char *ccch_overload_causes_str(unsigned int causes)
+{
+	static char buf[64];
+	const struct value_string *vs;
+	char *pos = buf;
+
+	buf[0] = '\0';
+	for (vs = ccch_overload_cause_names; vs->str; vs++) {
+		if (!(causes & vs->value))
+			continue;
+		pos += snprintf(pos, buf + sizeof(buf) - pos, "%s%s", pos == buf ? "" : ",", vs->str);
+	}
+	return buf[0] ? buf : "none";
+}
+
+/* Percentage of SDCCH in use, from the channel load kept up to date by ts_chan_load_update() */
+static unsigned int sdcch_load_percent(const struct gsm_bts *bts)
+{
+	static const enum gsm_phys_chan_config sdcch_pchans[] = {
+		GSM_PCHAN_CCCH_SDCCH4,
+		GSM_PCHAN_CCCH_SDCCH4_CBCH,
+		GSM_PCHAN_SDCCH8_SACCH8C,
+		GSM_PCHAN_SDCCH8_SACCH8C_CBCH,
+	};
+	unsigned int used = 0, total = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sdcch_pchans); i++) {
+		used += bts->chan_load.pchan[sdcch_pchans[i]].used;
+		total += bts->chan_load.pchan[sdcch_pchans[i]].total;
+	}
+	return total ? used * 100 / total : 0;
+}
+
+/* Whether load reaches target, lowered by hysteresis percent of it */
+static bool reaches(unsigned int load, unsigned int target, unsigned int hysteresis)
+{
+	return (uint64_t)load * 100 >= (uint64_t)target * (100 - hysteresis);
+}
+
+/* \returns enum ccch_overload_cause flags for all loads that reach their targets lowered by hysteresis */
+static unsigned int overload_causes(struct gsm_bts *bts, unsigned int hysteresis, unsigned int agch_deleted)
+{
+	struct ccch_overload *ol = &bts->ccch_overload;
+	unsigned int causes = 0;
+
+	if (ol->rach_load_age <= CCCH_OVERLOAD_RACH_LOAD_MAX_AGE) {
+		if (reaches(ol->rach_busy, ol->rach_busy_target, hysteresis))
+			causes |= CCCH_OVERLOAD_RACH_BUSY;
+		if (reaches(ol->rach_access, ol->rach_access_target, hysteresis))
+			causes |= CCCH_OVERLOAD_RACH_ACCESS;
+	}
+	if (reaches(sdcch_load_percent(bts), ol->sdcch_target, hysteresis))
+		causes |= CCCH_OVERLOAD_SDCCH;
+	if (reaches(bts->paging.pending_requests_len, ol->paging_queue_target, hysteresis))
+		causes |= CCCH_OVERLOAD_PAGING;
+	if (agch_deleted)
+		causes |= CCCH_OVERLOAD_AGCH;
+	return causes;
+}
+
+/* Bar ol->level ACCs from ol->rotate on, skipping ACCs that are barred by configuration anyway, and stretch
+ * T3122 accordingly. The System Information is only updated when the barred ACCs change. */
+static void ccch_overload_apply(struct gsm_bts *bts)
+{
+	struct ccch_overload *ol = &bts->ccch_overload;
+	uint16_t permanent = ((bts->si_common.rach_control.t2 & 0x03) << 8) | bts->si_common.rach_control.t3;
+	uint16_t barred = 0;
+	unsigned int base;
+	unsigned int i, n;
+
+	for (i = 0, n = 0; i < 10 && n < ol->level; i++) {
+		unsigned int acc = (ol->rotate + i) % 10;
+		if (permanent & (1 << acc))
+			continue;
+		barred |= 1 << acc;
+		n++;
+	}
+	acc_ramp_set_overload_barred(&bts->acc_ramp, barred);
+
+	base = bts->T3122;
+	if (!base)
+		base = osmo_tdef_get(bts->network->T_defs, 3122, OSMO_TDEF_S, -1);
+	if (!ol->level || base >= CCCH_OVERLOAD_T3122_MAX)
+		ol->t3122 = 0;
+	else
+		ol->t3122 = base + (CCCH_OVERLOAD_T3122_MAX - base) * ol->level / 10;
+
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_CCCH_OVERLOAD_BARRED], ol->level);
+}
+
+/*! Evaluate the current load of \a bts and bar or allow ACCs as needed; to be called once per second. */
+void ccch_overload_update(struct gsm_bts *bts)
+{
+	struct ccch_overload *ol = &bts->ccch_overload;
+	uint64_t deleted = bts->bts_ctrs->ctr[BTS_CTR_AGCH_DELETE_IND].current;
+	unsigned int agch_deleted = deleted - ol->agch_deleted_prev;
+	unsigned int level = ol->level;
+
+	ol->agch_deleted_prev = deleted;
+	if (ol->rach_load_age <= CCCH_OVERLOAD_RACH_LOAD_MAX_AGE)
+		ol->rach_load_age++;
+
+	if (!ol->enabled || !trx_is_usable(bts->c0)) {
+		ccch_overload_reset(bts);
+		return;
+	}
+
+	if (ol->bar_hold)
+		ol->bar_hold--;
+
+	ol->causes = overload_causes(bts, 0, agch_deleted);
+	if (ol->causes) {
+		ol->relieved_secs = 0;
+		if (ol->level < ol->max_barred && !ol->bar_hold) {
+			ol->level++;
+			ol->bar_hold = ol->bar_interval;
+		}
+	} else if (overload_causes(bts, ol->hysteresis, agch_deleted)) {
+		/* between target and hysteresis: hold the current level */
+		ol->relieved_secs = 0;
+	} else if (ol->level && ++ol->relieved_secs >= ol->release_interval) {
+		ol->relieved_secs = 0;
+		ol->level--;
+	}
+
+	/* max_barred may have been lowered by VTY */
+	if (ol->level > ol->max_barred)
+		ol->level = ol->max_barred;
+
+	if (ol->level && ++ol->rotate_secs >= CCCH_OVERLOAD_ROTATE_INTERVAL) {
+		ol->rotate_secs = 0;
+		ol->rotate = (ol->rotate + 1) % 10;
+	}
+
+	if (ol->level != level)
+		LOG_BTS(bts, DRSL, LOGL_NOTICE, "CCCH overload control: %u of ACC 0-9 barred (overloaded: %s)\n",
+			ol->level, ccch_overload_causes_str(ol->causes));
+	ccch_overload_apply(bts);
+}
+
+/*! Allow all ACCs barred by overload control, e.g. when it is disabled or the BTS goes down. */
+void ccch_overload_reset(struct gsm_bts *bts)
+{
+	struct ccch_overload *ol = &bts->ccch_overload;
+
+	ol->causes = 0;
+	ol->bar_hold = 0;
+	ol->relieved_secs = 0;
+	ol->rotate_secs = 0;
+	if (!ol->level && !bts->acc_ramp.overload_barred_accs)
+		return;
+
+	LOG_BTS(bts, DRSL, LOGL_NOTICE, "CCCH overload control: allowing all ACCs again\n");
+	ol->level = 0;
+	ccch_overload_apply(bts);
+}
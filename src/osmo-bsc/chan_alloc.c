@@ -37,73 +37,67 @@
 
 #include <osmocom/core/talloc.h>
 
-/* Update channel load calculation for the given BTS */
+/* Add the channel load of the given BTS to cl. This is O(1), the counts are maintained by
+ * ts_chan_load_update() as lchans and timeslots change state. */
 void bts_chan_load(struct pchan_load *cl, const struct gsm_bts *bts)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cl->pchan); i++) {
+		cl->pchan[i].total += bts->chan_load.pchan[i].total;
+		cl->pchan[i].used += bts->chan_load.pchan[i].used;
+	}
+}
+
+/* Add the channel load of the given BTS to cl by scanning all TRX, timeslots and lchans. Only used to
+ * verify the incrementally maintained counts, see bts_chan_load_check(). */
+void bts_chan_load_scan(struct pchan_load *cl, const struct gsm_bts *bts)
 {
 	struct gsm_bts_trx *trx;
 
 	llist_for_each_entry(trx, &bts->trx_list, list) {
 		int i;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+			struct load_counter lc;
+			ts_chan_load_count(&lc, ts);
+			cl->pchan[ts->pchan_on_init].total += lc.total;
+			cl->pchan[ts->pchan_on_init].used += lc.used;
+		}
+	}
+}
+
+/* Compare the incrementally maintained channel load of a BTS against a full scan. On mismatch, log an
+ * error and resync the counts from the scan. Return true if the counts were consistent. */
+bool bts_chan_load_check(struct gsm_bts *bts)
+{
+	struct pchan_load scan = {};
+	bool ok = true;
+	int i;
+
+	bts_chan_load_scan(&scan, bts);
 
-		/* skip administratively deactivated tranxsceivers */
-		if (!trx_is_usable(trx))
+	for (i = 0; i < ARRAY_SIZE(scan.pchan); i++) {
+		const struct load_counter *have = &bts->chan_load.pchan[i];
+		const struct load_counter *want = &scan.pchan[i];
+		if (have->total == want->total && have->used == want->used)
 			continue;
+		LOG_BTS(bts, DRLL, LOGL_ERROR, "channel load for %s out of sync: used=%u total=%u,"
+			" but a full scan counts used=%u total=%u\n", gsm_pchan_name(i),
+			have->used, have->total, want->used, want->total);
+		ok = false;
+	}
 
-		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
-			struct gsm_bts_trx_ts *ts = &trx->ts[i];
-			struct load_counter *pl = &cl->pchan[ts->pchan_on_init];
-			struct gsm_lchan *lchan;
-
-			/* skip administratively deactivated timeslots */
-			if (!nm_is_running(&ts->mo.nm_state))
-				continue;
-
-			/* Dynamic timeslots have to be counted separately
-			 * when not in TCH/F or TCH/H mode because they don't
-			 * have an lchan's allocated to them. At the same time,
-			 * dynamic timeslots in NONE and PDCH modes are same
-			 * as in UNUSED mode from the CS channel load perspective
-			 * beause they can be switched to TCH mode at any moment.
-			 * I.e. they are "available" for TCH. */
-			if ((ts->pchan_on_init == GSM_PCHAN_TCH_F_TCH_H_PDCH ||
-			     ts->pchan_on_init == GSM_PCHAN_TCH_F_PDCH) &&
-			    (ts->pchan_is == GSM_PCHAN_NONE ||
-			     ts->pchan_is == GSM_PCHAN_PDCH)) {
-				pl->total++;
-			}
-
-			/* Count allocated logical channels.
-			 * Note: A GSM_PCHAN_TCH_F_TCH_H_PDCH can be switched
-			 * to a single TCH/F or to two TCH/H. So when it's in
-			 * the TCH/H mode, total number of available channels
-			 * is 1 more than when it's in the TCH/F mode.
-			 * I.e. "total" count will fluctuate depending on
-			 * whether GSM_PCHAN_TCH_F_TCH_H_PDCH timeslot is
-			 * in TCH/F or TCH/H (or in NONE/PDCH) mode. */
-			ts_for_each_lchan(lchan, ts) {
-				/* don't even count CBCH slots in total */
-				if (lchan->type == GSM_LCHAN_CBCH)
-					continue;
-
-				pl->total++;
-
-				/* lchans under a BORKEN TS should be counted
-				 * as used just as BORKEN lchans under a normal TS */
-				if (ts->fi->state == TS_ST_BORKEN) {
-					pl->used++;
-					continue;
-				}
-
-				switch (lchan->fi->state) {
-				case LCHAN_ST_UNUSED:
-					break;
-				default:
-					pl->used++;
-					break;
-				}
-			}
+	if (!ok) {
+		struct gsm_bts_trx *trx;
+		memset(&bts->chan_load, 0, sizeof(bts->chan_load));
+		llist_for_each_entry(trx, &bts->trx_list, list) {
+			for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+				memset(&trx->ts[i].chan_load, 0, sizeof(trx->ts[i].chan_load));
 		}
+		bts_chan_load_update(bts);
 	}
+	return ok;
 }
 
 /* Update channel load calculation for all BTS in the BSC */
@@ -182,6 +176,10 @@ bts_update_t3122_chan_load(struct gsm_bts *bts)
 	if (!trx_is_usable(bts->c0))
 		return;
 
+	/* The full scan is expensive, cross-check the incremental counts only when debugging */
+	if (log_check_level(DRLL, LOGL_DEBUG))
+		bts_chan_load_check(bts);
+
 	/* Sum up current load across all channels. */
 	memset(&pl, 0, sizeof(pl));
 	bts_chan_load(&pl, bts);
@@ -0,0 +1,178 @@
+/* Keep dynamic timeslots switched out of PDCH ahead of forecast TCH demand */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmocom/core/timer.h>
+#include <osmocom/core/timer_compat.h>
+
+#include <osmocom/bsc/dyn_ts_reserve.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/debug.h>
+
+static bool ts_is_dyn(const struct gsm_bts_trx_ts *ts)
+{
+	switch (ts->pchan_on_init) {
+	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
+	case GSM_PCHAN_TCH_F_PDCH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Whether a TCH request could use this dynamic timeslot without a PDCH deactivation, or will be able to
+ * once the deactivation started for the reserve is acked */
+static bool ts_is_ready(struct gsm_bts_trx_ts *ts)
+{
+	if (!ts_is_dyn(ts) || !ts_is_usable(ts) || ts_is_lchan_waiting_for_pchan(ts, NULL))
+		return false;
+
+	switch (ts->fi->state) {
+	case TS_ST_UNUSED:
+		return true;
+	case TS_ST_WAIT_PDCH_DEACT:
+		return ts->tch_reserved;
+	default:
+		return false;
+	}
+}
+
+static unsigned int count_ready(struct gsm_bts *bts)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int ready = 0;
+	int i;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (!trx_is_usable(trx))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			if (ts_is_ready(&trx->ts[i]))
+				ready++;
+		}
+	}
+	return ready;
+}
+
+/*! Update the TCH demand forecast of \a bts and switch dynamic timeslots out of PDCH or back into it to
+ * meet it; to be called once per second. */
+void dyn_ts_reserve_update(struct gsm_bts *bts)
+{
+	struct dyn_ts_reserve *r = &bts->dyn_ts_reserve;
+	struct gsm_bts_trx *trx;
+	unsigned int target;
+	unsigned int idle_reserved = 0;
+	int i;
+
+	r->rate_milli = (r->rate_milli * (DYN_TS_RESERVE_SMOOTHING - 1) + r->tch_requests * 1000)
+			/ DYN_TS_RESERVE_SMOOTHING;
+	r->tch_requests = 0;
+
+	target = (r->rate_milli * r->horizon + 500) / 1000;
+	if (target < r->min)
+		target = r->min;
+	if (target > r->max)
+		target = r->max;
+	/* Without GPRS, dynamic timeslots stay out of PDCH anyway */
+	if (bts->gprs.mode == BTS_GPRS_NONE)
+		target = 0;
+	r->target = target;
+
+	r->ready = 0;
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (!trx_is_usable(trx))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+			if (!ts_is_ready(ts))
+				continue;
+			r->ready++;
+			if (ts->tch_reserved && ts->fi->state == TS_ST_UNUSED)
+				idle_reserved++;
+		}
+	}
+	rate_ctr_add(&bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_PDCH_LOST], idle_reserved);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (r->ready == target)
+			break;
+		if (!trx_is_usable(trx))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trx->ts) && r->ready != target; i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+
+			if (r->ready < target && ts_is_dyn(ts) && ts->fi && ts->fi->state == TS_ST_PDCH
+			    && !ts_is_lchan_waiting_for_pchan(ts, NULL)) {
+				LOG_TS(ts, LOGL_INFO, "Switching out of PDCH for expected TCH demand (%u of %u ready)\n",
+				       r->ready, target);
+				ts->tch_reserved = true;
+				osmo_fsm_inst_dispatch(ts->fi, TS_EV_TCH_RESERVE, NULL);
+				r->ready++;
+			} else if (r->ready > target && ts->tch_reserved && ts_is_ready(ts)
+				   && ts->fi->state == TS_ST_UNUSED) {
+				LOG_TS(ts, LOGL_INFO, "No longer needed for expected TCH demand (%u of %u ready)\n",
+				       r->ready, target);
+				ts->tch_reserved = false;
+				osmo_fsm_inst_dispatch(ts->fi, TS_EV_TCH_RESERVE_END, NULL);
+				r->ready--;
+			}
+		}
+	}
+
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_DYN_TS_RESERVED], r->ready);
+}
+
+/*! A dynamic timeslot became unused: \returns whether to keep it out of PDCH for the reserve. */
+bool dyn_ts_reserve_keep(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_bts *bts = ts->trx->bts;
+	unsigned int target = bts->dyn_ts_reserve.target;
+
+	/* ts itself is among the ready timeslots, so the reserve is short of target without it */
+	if (!ts->tch_reserved && target && count_ready(bts) <= target)
+		ts->tch_reserved = true;
+	return ts->tch_reserved;
+}
+
+/*! A TCH request was served from a dynamic timeslot that the reserve kept out of PDCH */
+void dyn_ts_reserve_hit(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_bts *bts = ts->trx->bts;
+
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_HIT]);
+	rate_ctr_add(&bts->bts_ctrs->ctr[BTS_CTR_DYN_TS_RESERVE_SAVED_MS], bts->dyn_ts_reserve.pdch_deact_ms);
+}
+
+/*! PDCH deactivation of \a ts was acked: average its round trip, which is what a reserve hit saves */
+void dyn_ts_reserve_pdch_deact_done(struct gsm_bts_trx_ts *ts)
+{
+	struct dyn_ts_reserve *r = &ts->trx->bts->dyn_ts_reserve;
+	struct timespec now, elapsed;
+	unsigned int ms;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, &ts->pdch_deact_start, &elapsed);
+	ms = elapsed.tv_sec * 1000 + elapsed.tv_nsec / 1000000;
+
+	if (!r->pdch_deact_ms)
+		r->pdch_deact_ms = ms ? : 1;
+	else
+		r->pdch_deact_ms = (r->pdch_deact_ms * (DYN_TS_RESERVE_SMOOTHING - 1) + ms)
+				   / DYN_TS_RESERVE_SMOOTHING;
+}
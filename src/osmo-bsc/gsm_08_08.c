@@ -159,6 +159,31 @@ static struct bsc_subscr *extract_sub(struct gsm_subscriber_connection *conn,
 	return subscr;
 }
 
+/* Pick the ready MSC with the lowest bsc_msc_load_score(). Of equally loaded MSCs, pick the one that was
+ * picked least recently, like round robin does. */
+static struct bsc_msc_data *bsc_find_msc_by_load(struct gsm_network *net, int is_emerg)
+{
+	struct bsc_msc_data *msc, *best = NULL;
+	uint64_t score, best_score = 0;
+
+	llist_for_each_entry(msc, &net->mscs, entry) {
+		if (is_emerg && !msc->allow_emerg)
+			continue;
+		if (!a_reset_conn_ready(msc))
+			continue;
+
+		score = bsc_msc_load_score(msc);
+		if (best && score >= best_score)
+			continue;
+		best = msc;
+		best_score = score;
+	}
+
+	if (best)
+		llist_move_tail(&best->entry, &net->mscs);
+	return best;
+}
+
 static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 				   struct msgb *msg)
 {
@@ -194,6 +219,14 @@ static struct bsc_msc_data *bsc_find_msc(struct gsm_subscriber_connection *conn,
 		goto round_robin;
 
 round_robin:
+	if (net->msc_selection == BSC_MSC_SELECTION_LOAD_BASED) {
+		msc = bsc_find_msc_by_load(net, is_emerg);
+		if (msc)
+			return msc;
+		/* No MSC is ready. Pick one anyway, so that the conn is rejected the same way as with round
+		 * robin. */
+	}
+
 	llist_for_each_entry(msc, &net->mscs, entry) {
 		if (is_emerg && !msc->allow_emerg)
 			continue;
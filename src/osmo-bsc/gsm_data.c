@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include <netinet/in.h>
 #include <talloc.h>
@@ -100,29 +101,158 @@ struct gsm_bts_trx *gsm_bts_trx_by_nr(struct gsm_bts *bts, int nr)
 	return NULL;
 }
 
+#define BTS_LAC_CI_KEY(lac, ci) (((uint32_t)(lac) << 16) | (uint32_t)(ci))
+#define BTS_ARFCN_BSIC_KEY(arfcn, bsic) (((uint32_t)(arfcn) << 8) | (uint32_t)(bsic))
+
+void gsm_bts_cell_index_init(struct gsm_network *net)
+{
+	hash_init(net->bts_by_lac);
+	hash_init(net->bts_by_lac_ci);
+	hash_init(net->bts_by_ci);
+	hash_init(net->bts_by_arfcn_bsic);
+}
+
+/* Insert into a cell index bucket, keeping the bucket in BTS number order like bts_list, so that lookups
+ * return matches in the same order as a walk over bts_list does. */
+static void bts_cell_index_add(struct llist_head *bucket, struct gsm_bts *bts, size_t entry_offset)
+{
+	struct llist_head *entry = (struct llist_head *)((char *)bts + entry_offset);
+	struct llist_head *pos;
+
+	for (pos = bucket->next; pos != bucket; pos = pos->next) {
+		const struct gsm_bts *other = (const struct gsm_bts *)((char *)pos - entry_offset);
+		if (other->nr > bts->nr)
+			break;
+	}
+	/* inserts before pos, or at the end of the bucket */
+	llist_add_tail(entry, pos);
+}
+
+static void bts_cell_index_update(struct gsm_bts *bts)
+{
+	struct gsm_network *net = bts->network;
+
+	hash_del(&bts->lac_entry);
+	hash_del(&bts->lac_ci_entry);
+	hash_del(&bts->ci_entry);
+	hash_del(&bts->arfcn_bsic_entry);
+
+	bts_cell_index_add(hash_bucket(net->bts_by_lac, (uint32_t)bts->location_area_code), bts,
+			   offsetof(struct gsm_bts, lac_entry));
+	bts_cell_index_add(hash_bucket(net->bts_by_lac_ci,
+				       BTS_LAC_CI_KEY(bts->location_area_code, bts->cell_identity)), bts,
+			   offsetof(struct gsm_bts, lac_ci_entry));
+	bts_cell_index_add(hash_bucket(net->bts_by_ci, (uint32_t)bts->cell_identity), bts,
+			   offsetof(struct gsm_bts, ci_entry));
+	bts_cell_index_add(hash_bucket(net->bts_by_arfcn_bsic, BTS_ARFCN_BSIC_KEY(bts->c0->arfcn, bts->bsic)), bts,
+			   offsetof(struct gsm_bts, arfcn_bsic_entry));
+}
+
+/* Set the LAC and keep the network's cell index in sync. Always use this instead of writing
+ * bts->location_area_code directly. */
+void gsm_bts_set_lac(struct gsm_bts *bts, uint16_t lac)
+{
+	bts->location_area_code = lac;
+	/* only BTS registered in the bts_list are indexed */
+	if (hash_hashed(&bts->lac_entry))
+		bts_cell_index_update(bts);
+}
+
+/* Set the Cell Identity and keep the network's cell index in sync */
+void gsm_bts_set_ci(struct gsm_bts *bts, uint16_t ci)
+{
+	bts->cell_identity = ci;
+	if (hash_hashed(&bts->ci_entry))
+		bts_cell_index_update(bts);
+}
+
+/* Set the BSIC and keep the network's cell index in sync */
+void gsm_bts_set_bsic(struct gsm_bts *bts, uint8_t bsic)
+{
+	bts->bsic = bsic;
+	if (hash_hashed(&bts->arfcn_bsic_entry))
+		bts_cell_index_update(bts);
+}
+
+/* Set the ARFCN of a TRX. The ARFCN of C0 is part of the cell index, so always use this instead of
+ * writing trx->arfcn directly. */
+void gsm_bts_trx_set_arfcn(struct gsm_bts_trx *trx, uint16_t arfcn)
+{
+	trx->arfcn = arfcn;
+	if (trx == trx->bts->c0 && hash_hashed(&trx->bts->arfcn_bsic_entry))
+		bts_cell_index_update(trx->bts);
+}
+
 /* Search for a BTS in the given Location Area; optionally start searching
  * with start_bts (for continuing to search after the first result) */
-struct gsm_bts *gsm_bts_by_lac(struct gsm_network *net, unsigned int lac,
-				struct gsm_bts *start_bts)
+struct gsm_bts *gsm_bts_by_lac(const struct gsm_network *net, unsigned int lac,
+				const struct gsm_bts *start_bts)
 {
-	int i;
 	struct gsm_bts *bts;
-	int skip = 0;
 
-	if (start_bts)
-		skip = 1;
+	if (lac == GSM_LAC_RESERVED_ALL_BTS) {
+		llist_for_each_entry(bts, &net->bts_list, list) {
+			if (start_bts && bts->nr <= start_bts->nr)
+				continue;
+			return bts;
+		}
+		return NULL;
+	}
 
-	for (i = 0; i < net->num_bts; i++) {
-		bts = gsm_bts_num(net, i);
+	hash_for_each_possible(net->bts_by_lac, bts, lac_entry, (uint32_t)lac) {
+		if (bts->location_area_code != lac)
+			continue;
+		if (start_bts && bts->nr <= start_bts->nr)
+			continue;
+		return bts;
+	}
+	return NULL;
+}
 
-		if (skip) {
-			if (start_bts == bts)
-				skip = 0;
+/* Search for a BTS with the given LAC and CI, like gsm_bts_by_lac() */
+struct gsm_bts *gsm_bts_by_lac_ci(const struct gsm_network *net, uint16_t lac, uint16_t ci,
+				  const struct gsm_bts *start_bts)
+{
+	struct gsm_bts *bts;
+
+	hash_for_each_possible(net->bts_by_lac_ci, bts, lac_ci_entry, BTS_LAC_CI_KEY(lac, ci)) {
+		if (bts->location_area_code != lac || bts->cell_identity != ci)
 			continue;
-		}
+		if (start_bts && bts->nr <= start_bts->nr)
+			continue;
+		return bts;
+	}
+	return NULL;
+}
 
-		if (lac == GSM_LAC_RESERVED_ALL_BTS || bts->location_area_code == lac)
-			return bts;
+/* Search for a BTS by the ARFCN of its C0 and its BSIC, like gsm_bts_by_lac() */
+struct gsm_bts *gsm_bts_by_arfcn_bsic(const struct gsm_network *net, uint16_t arfcn, uint8_t bsic,
+				      const struct gsm_bts *start_bts)
+{
+	struct gsm_bts *bts;
+
+	hash_for_each_possible(net->bts_by_arfcn_bsic, bts, arfcn_bsic_entry, BTS_ARFCN_BSIC_KEY(arfcn, bsic)) {
+		if (bts->c0->arfcn != arfcn || bts->bsic != bsic)
+			continue;
+		if (start_bts && bts->nr <= start_bts->nr)
+			continue;
+		return bts;
+	}
+	return NULL;
+}
+
+/* Search for a BTS with the given CI, like gsm_bts_by_lac() */
+struct gsm_bts *gsm_bts_by_ci(const struct gsm_network *net, uint16_t ci,
+			      const struct gsm_bts *start_bts)
+{
+	struct gsm_bts *bts;
+
+	hash_for_each_possible(net->bts_by_ci, bts, ci_entry, (uint32_t)ci) {
+		if (bts->cell_identity != ci)
+			continue;
+		if (start_bts && bts->nr <= start_bts->nr)
+			continue;
+		return bts;
 	}
 	return NULL;
 }
@@ -225,6 +355,7 @@ struct gsm_bts *gsm_bts_alloc_register(struct gsm_network *net, enum gsm_bts_typ
 	bts->bsic = bsic;
 
 	llist_add_tail(&bts->list, &net->bts_list);
+	bts_cell_index_update(bts);
 
 	return bts;
 }
@@ -369,6 +500,10 @@ static const struct osmo_stat_item_desc bts_stat_desc[] = {
 	{ "rsl_connected", "Number of RSL links connected", "", 16, 0 },
 	{ "lchan_borken", "Number of lchans in the BORKEN state", "", 16, 0 },
 	{ "ts_borken", "Number of timeslots in the BORKEN state", "", 16, 0 },
+	{ "paging:request_queue_length", "Paging Request queue length", "", 60, 0 },
+	{ "paging:first_tx_delay", "Time a Paging Request waited in the queue until first sent", "ms", 60, 0 },
+	{ "ccch_overload:barred", "Access Control Classes barred by CCCH overload control", "", 16, 0 },
+	{ "dyn_ts_reserve:reserved", "Idle dynamic timeslots kept out of PDCH for expected TCH demand", "", 16, 0 },
 };
 
 static const struct osmo_stat_item_group_desc bts_statg_desc = {
@@ -600,8 +735,50 @@ struct gsm_bts *gsm_bts_by_cell_id(const struct gsm_network *net,
 				   const struct gsm0808_cell_id *cell_id,
 				   int match_idx)
 {
-	struct gsm_bts *bts;
+	const union gsm0808_cell_id_u *id = &cell_id->id;
+	struct gsm_bts *bts = NULL;
 	int i = 0;
+
+	/* The common identifier types are looked up in the cell index */
+	switch (cell_id->id_discr) {
+	case CELL_IDENT_WHOLE_GLOBAL:
+		if (osmo_plmn_cmp(&id->global.lai.plmn, &net->plmn))
+			return NULL;
+		do {
+			bts = gsm_bts_by_lac_ci(net, id->global.lai.lac, id->global.cell_identity, bts);
+		} while (bts && i++ < match_idx);
+		return bts;
+	case CELL_IDENT_LAC_AND_CI:
+		do {
+			bts = gsm_bts_by_lac_ci(net, id->lac_and_ci.lac, id->lac_and_ci.ci, bts);
+		} while (bts && i++ < match_idx);
+		return bts;
+	case CELL_IDENT_CI:
+		do {
+			bts = gsm_bts_by_ci(net, id->ci, bts);
+		} while (bts && i++ < match_idx);
+		return bts;
+	case CELL_IDENT_LAI_AND_LAC:
+		if (osmo_plmn_cmp(&id->lai_and_lac.plmn, &net->plmn))
+			return NULL;
+		if (id->lai_and_lac.lac == GSM_LAC_RESERVED_ALL_BTS)
+			return NULL;
+		do {
+			bts = gsm_bts_by_lac(net, id->lai_and_lac.lac, bts);
+		} while (bts && i++ < match_idx);
+		return bts;
+	case CELL_IDENT_LAC:
+		/* gsm_bts_by_lac() would treat this reserved LAC as a wildcard */
+		if (id->lac == GSM_LAC_RESERVED_ALL_BTS)
+			return NULL;
+		do {
+			bts = gsm_bts_by_lac(net, id->lac, bts);
+		} while (bts && i++ < match_idx);
+		return bts;
+	default:
+		break;
+	}
+
 	llist_for_each_entry(bts, &net->bts_list, list) {
 		if (!gsm_bts_matches_cell_id(bts, cell_id))
 			continue;
@@ -668,6 +845,33 @@ int gsm_bts_local_neighbor_del(struct gsm_bts *bts, const struct gsm_bts *neighb
 	return 1;
 }
 
+/* Make room in the free_ts bitmaps of a BTS for a newly allocated TRX */
+static int bts_free_ts_grow(struct gsm_bts *bts, struct gsm_bts_trx *trx)
+{
+	unsigned int words = (bts->num_trx * TRX_NR_TS + 63) / 64;
+	struct gsm_bts_trx **trx_by_nr;
+	int i;
+
+	trx_by_nr = talloc_realloc(bts, bts->free_ts.trx, struct gsm_bts_trx *, bts->num_trx);
+	if (!trx_by_nr)
+		return -ENOMEM;
+	bts->free_ts.trx = trx_by_nr;
+	bts->free_ts.trx[trx->nr] = trx;
+
+	if (words <= bts->free_ts.words)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(bts->free_ts.map); i++) {
+		uint64_t *map = talloc_realloc(bts, bts->free_ts.map[i], uint64_t, words);
+		if (!map)
+			return -ENOMEM;
+		memset(&map[bts->free_ts.words], 0, (words - bts->free_ts.words) * sizeof(*map));
+		bts->free_ts.map[i] = map;
+	}
+	bts->free_ts.words = words;
+	return 0;
+}
+
 struct gsm_bts_trx *gsm_bts_trx_alloc(struct gsm_bts *bts)
 {
 	struct gsm_bts_trx *trx = talloc_zero(bts, struct gsm_bts_trx);
@@ -680,6 +884,12 @@ struct gsm_bts_trx *gsm_bts_trx_alloc(struct gsm_bts *bts)
 	trx->nr = bts->num_trx++;
 	trx->mo.nm_state.administrative = NM_STATE_UNLOCKED;
 
+	if (bts_free_ts_grow(bts, trx)) {
+		bts->num_trx--;
+		talloc_free(trx);
+		return NULL;
+	}
+
 	gsm_mo_init(&trx->mo, bts, NM_OC_RADIO_CARRIER,
 		    bts->nr, trx->nr, 0xff);
 	gsm_mo_init(&trx->bb_transc.mo, bts, NM_OC_BASEB_TRANSC,
@@ -764,6 +974,13 @@ static void bts_init_cbch_state(struct bts_smscb_chan_state *cstate, struct gsm_
  * This part is shared among the thin programs in osmo-bsc/src/utils/.
  * osmo-bsc requires further initialization that pulls in more dependencies (see
  * bsc_bts_alloc_register()). */
+static int gsm_bts_talloc_destructor(struct gsm_bts *bts)
+{
+	/* the IMMEDIATE ASSIGN REJECT batch would otherwise be sent from a freed bts */
+	osmo_timer_del(&bts->imm_ass_rej.timer);
+	return 0;
+}
+
 struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 {
 	struct gsm_bts *bts = talloc_zero(net, struct gsm_bts);
@@ -772,10 +989,15 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 
 	if (!bts)
 		return NULL;
+	talloc_set_destructor(bts, gsm_bts_talloc_destructor);
 
 	bts->nr = bts_num;
 	bts->num_trx = 0;
 	INIT_LLIST_HEAD(&bts->trx_list);
+	INIT_LLIST_HEAD(&bts->lac_entry);
+	INIT_LLIST_HEAD(&bts->lac_ci_entry);
+	INIT_LLIST_HEAD(&bts->ci_entry);
+	INIT_LLIST_HEAD(&bts->arfcn_bsic_entry);
 	bts->network = net;
 
 	bts->ms_max_power = 15;	/* dBm */
@@ -827,8 +1049,23 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 	bts->rach_b_thresh = -1;
 	bts->rach_ldavg_slots = -1;
 
+	bts->ccch_overload = (struct ccch_overload){
+		.rach_busy_target = CCCH_OVERLOAD_RACH_BUSY_DEFAULT,
+		.rach_access_target = CCCH_OVERLOAD_RACH_ACCESS_DEFAULT,
+		.sdcch_target = CCCH_OVERLOAD_SDCCH_DEFAULT,
+		.paging_queue_target = CCCH_OVERLOAD_PAGING_QUEUE_DEFAULT,
+		.hysteresis = CCCH_OVERLOAD_HYSTERESIS_DEFAULT,
+		.max_barred = CCCH_OVERLOAD_MAX_BARRED_DEFAULT,
+		.bar_interval = CCCH_OVERLOAD_BAR_INTERVAL_DEFAULT,
+		.release_interval = CCCH_OVERLOAD_RELEASE_INTERVAL_DEFAULT,
+		.rach_load_age = CCCH_OVERLOAD_RACH_LOAD_MAX_AGE + 1,
+	};
+	bts->dyn_ts_reserve.horizon = DYN_TS_RESERVE_HORIZON_DEFAULT;
+
 	bts->paging.free_chans_need = -1;
 	INIT_LLIST_HEAD(&bts->paging.pending_requests);
+	hash_init(bts->paging.pending_requests_by_bsub);
+	INIT_LLIST_HEAD(&bts->paging.T3113_queue);
 
 	bts->features.data = &bts->_features_data[0];
 	bts->features.data_len = sizeof(bts->_features_data);
@@ -867,6 +1104,7 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 	bts->si_common.rach_control.tx_integer = 9;  /* 12 slots spread - 217/115 slots delay */
 	bts->si_common.rach_control.max_trans = 3; /* 7 retransmissions */
 	bts->si_common.rach_control.t2 = 4; /* no emergency calls */
+	bts->si_dirty = SI_DIRTY_ALL;
 	bts->si_common.chan_desc.att = 1; /* attachment required */
 	bts->si_common.chan_desc.bs_pa_mfrms = RSL_BS_PA_MFRMS_5; /* paging frames */
 	bts->si_common.chan_desc.bs_ag_blks_res = 1; /* reserved AGCH blocks */
@@ -874,6 +1112,9 @@ struct gsm_bts *gsm_bts_alloc(struct gsm_network *net, uint8_t bts_num)
 	gsm_bts_set_radio_link_timeout(bts, 32); /* Use RADIO LINK TIMEOUT of 32 */
 
 	INIT_LLIST_HEAD(&bts->abis_queue);
+	bts->oml_window = 1;
+	INIT_LLIST_HEAD(&bts->admission.entry);
+	INIT_LLIST_HEAD(&bts->admission.held_msgs);
 	INIT_LLIST_HEAD(&bts->loc_list);
 	INIT_LLIST_HEAD(&bts->local_neighbors);
 	INIT_LLIST_HEAD(&bts->oml_fail_rep);
@@ -970,6 +1211,9 @@ void gsm_bts_mo_reset(struct gsm_bts *bts)
 			gsm_abis_mo_reset(&ts->mo);
 		}
 	}
+
+	/* No TRX is usable anymore, which the channel load and free lchan counts have to reflect */
+	bts_avail_update(bts);
 }
 
 struct gsm_bts_trx *gsm_bts_trx_num(const struct gsm_bts *bts, int num)
@@ -1387,6 +1631,170 @@ bool trx_is_usable(const struct gsm_bts_trx *trx)
 	return true;
 }
 
+/* Count the channel load of one timeslot, by the same rules as the full scan in bts_chan_load_scan(). */
+void ts_chan_load_count(struct load_counter *lc, struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_lchan *lchan;
+
+	*lc = (struct load_counter){};
+
+	/* skip administratively deactivated transceivers and timeslots */
+	if (!trx_is_usable(ts->trx) || !nm_is_running(&ts->mo.nm_state) || !ts->fi)
+		return;
+
+	/* Dynamic timeslots in NONE and PDCH mode have no lchans, but are available for TCH */
+	if ((ts->pchan_on_init == GSM_PCHAN_TCH_F_TCH_H_PDCH ||
+	     ts->pchan_on_init == GSM_PCHAN_TCH_F_PDCH) &&
+	    (ts->pchan_is == GSM_PCHAN_NONE ||
+	     ts->pchan_is == GSM_PCHAN_PDCH))
+		lc->total++;
+
+	ts_for_each_lchan(lchan, ts) {
+		/* don't even count CBCH slots in total */
+		if (lchan->type == GSM_LCHAN_CBCH)
+			continue;
+
+		lc->total++;
+
+		/* lchans under a BORKEN TS count as used */
+		if (ts->fi->state == TS_ST_BORKEN
+		    || (lchan->fi && lchan->fi->state != LCHAN_ST_UNUSED))
+			lc->used++;
+	}
+}
+
+/* Recount the channel load of one timeslot and apply the difference to its BTS' chan_load. To be called
+ * whenever anything that ts_chan_load_count() looks at may have changed: lchan states entering or leaving
+ * UNUSED, timeslot states entering or leaving BORKEN, pchan switches and NM state changes. This is
+ * O(lchans in the timeslot), which keeps bts_chan_load() from having to scan the entire BTS. */
+void ts_chan_load_update(struct gsm_bts_trx_ts *ts)
+{
+	struct pchan_load *bts_load = &ts->trx->bts->chan_load;
+	struct load_counter now;
+
+	ts_chan_load_count(&now, ts);
+
+	/* Take back the previous contribution, which may have been counted for a different pchan */
+	bts_load->pchan[ts->chan_load.pchan].total -= ts->chan_load.lc.total;
+	bts_load->pchan[ts->chan_load.pchan].used -= ts->chan_load.lc.used;
+
+	bts_load->pchan[ts->pchan_on_init].total += now.total;
+	bts_load->pchan[ts->pchan_on_init].used += now.used;
+
+	ts->chan_load.pchan = ts->pchan_on_init;
+	ts->chan_load.lc = now;
+}
+
+void trx_chan_load_update(struct gsm_bts_trx *trx)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+		ts_chan_load_update(&trx->ts[i]);
+}
+
+/* Recount all timeslots of a BTS, e.g. after an NM state change affecting whole TRX */
+void bts_chan_load_update(struct gsm_bts *bts)
+{
+	struct gsm_bts_trx *trx;
+	llist_for_each_entry(trx, &bts->trx_list, list)
+		trx_chan_load_update(trx);
+}
+
+/* Mark or unmark a timeslot in its BTS' free_ts bitmaps: marked are usable timeslots that have at least
+ * one UNUSED lchan, regardless of whether it is currently switched to a suitable pchan. Called along with
+ * ts_chan_load_update() from ts_avail_update(). */
+void ts_free_lchans_update(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_bts *bts = ts->trx->bts;
+	unsigned int bit = ts->trx->nr * TRX_NR_TS + ts->nr;
+	uint64_t mask = 1ULL << (bit % 64);
+	struct gsm_lchan *lchan;
+	bool has_free = false;
+
+	if (trx_is_usable(ts->trx) && ts->fi
+	    && ts->fi->state != TS_ST_NOT_INITIALIZED && ts->fi->state != TS_ST_BORKEN) {
+		ts_for_each_potential_lchan(lchan, ts) {
+			if (lchan->fi && lchan->fi->state == LCHAN_ST_UNUSED) {
+				has_free = true;
+				break;
+			}
+		}
+	}
+
+	if (ts->free_ts.marked)
+		bts->free_ts.map[ts->free_ts.pchan][bit / 64] &= ~mask;
+	if (has_free)
+		bts->free_ts.map[ts->pchan_on_init][bit / 64] |= mask;
+	ts->free_ts.marked = has_free;
+	ts->free_ts.pchan = ts->pchan_on_init;
+}
+
+/* Iterate the timeslots marked in the free_ts bitmap for pchan, in ascending or, if reverse is true,
+ * descending order of TRX and timeslot number. *bit is the iterator state: pass -1 to start, and the
+ * same variable again to continue after the returned timeslot. Return NULL when done. */
+struct gsm_bts_trx_ts *bts_free_ts_next(const struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
+					int *bit, bool reverse)
+{
+	const uint64_t *map = bts->free_ts.map[pchan];
+	int nbits = bts->free_ts.words * 64;
+	int b;
+	int word;
+	uint64_t w;
+
+	if (!map)
+		return NULL;
+
+	if (!reverse) {
+		b = *bit + 1;
+		if (b >= nbits)
+			return NULL;
+		word = b / 64;
+		w = map[word] & (~0ULL << (b % 64));
+		while (!w) {
+			if (++word >= bts->free_ts.words)
+				return NULL;
+			w = map[word];
+		}
+		b = word * 64 + __builtin_ctzll(w);
+	} else {
+		b = (*bit < 0) ? nbits - 1 : *bit - 1;
+		if (b < 0)
+			return NULL;
+		word = b / 64;
+		w = map[word] & (~0ULL >> (63 - (b % 64)));
+		while (!w) {
+			if (--word < 0)
+				return NULL;
+			w = map[word];
+		}
+		b = word * 64 + 63 - __builtin_clzll(w);
+	}
+
+	*bit = b;
+	return &bts->free_ts.trx[b / TRX_NR_TS]->ts[b % TRX_NR_TS];
+}
+
+/* To be called whenever the availability of a timeslot or one of its lchans may have changed: lchan states
+ * entering or leaving UNUSED, timeslot states entering or leaving BORKEN or NOT_INITIALIZED, pchan switches
+ * and NM state changes. Updates the channel load, the free lchan bitmaps and the free TCH counts. */
+void ts_avail_update(struct gsm_bts_trx_ts *ts)
+{
+	ts_chan_load_update(ts);
+	ts_free_lchans_update(ts);
+	ts_free_tch_update(ts);
+}
+
+void bts_avail_update(struct gsm_bts *bts)
+{
+	struct gsm_bts_trx *trx;
+	int i;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+			ts_avail_update(&trx->ts[i]);
+	}
+}
+
 void gsm_trx_all_ts_dispatch(struct gsm_bts_trx *trx, uint32_t ts_ev, void *data)
 {
 	int i;
@@ -1609,66 +2017,121 @@ bool ts_is_capable_of_lchant(struct gsm_bts_trx_ts *ts, enum gsm_chan_t type)
 	}
 }
 
-static int trx_count_free_ts(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan)
+/* Count free lchans of given pchan type in one timeslot; dynamic timeslots in PDCH mode count as what they
+ * could be switched to. */
+static int ts_count_free(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config pchan)
 {
-	struct gsm_bts_trx_ts *ts;
 	struct gsm_lchan *lchan;
-	int j;
 	int count = 0;
 
-	if (!trx_is_usable(trx))
+	if (!trx_is_usable(ts->trx))
+		return 0;
+	if (!ts_is_usable(ts))
 		return 0;
 
-	for (j = 0; j < ARRAY_SIZE(trx->ts); j++) {
-		ts = &trx->ts[j];
-		if (!ts_is_usable(ts))
-			continue;
-
-		if (ts->pchan_is == GSM_PCHAN_PDCH) {
-			/* Dynamic timeslots in PDCH mode will become TCH if needed. */
-			switch (ts->pchan_on_init) {
-			case GSM_PCHAN_TCH_F_PDCH:
-				if (pchan == GSM_PCHAN_TCH_F)
-					count++;
-				continue;
+	if (ts->pchan_is == GSM_PCHAN_PDCH) {
+		/* Dynamic timeslots in PDCH mode will become TCH if needed. */
+		switch (ts->pchan_on_init) {
+		case GSM_PCHAN_TCH_F_PDCH:
+			if (pchan == GSM_PCHAN_TCH_F)
+				return 1;
+			return 0;
+
+		case GSM_PCHAN_TCH_F_TCH_H_PDCH:
+			if (pchan == GSM_PCHAN_TCH_F)
+				return 1;
+			else if (pchan == GSM_PCHAN_TCH_H)
+				return 2;
+			return 0;
 
-			case GSM_PCHAN_TCH_F_TCH_H_PDCH:
-				if (pchan == GSM_PCHAN_TCH_F)
-					count++;
-				else if (pchan == GSM_PCHAN_TCH_H)
-					count += 2;
-				continue;
-
-			default:
-				/* Not dynamic, not applicable. */
-				continue;
-			}
+		default:
+			/* Not dynamic, not applicable. */
+			return 0;
 		}
+	}
 
-		if (ts->pchan_is != pchan)
-			continue;
+	if (ts->pchan_is != pchan)
+		return 0;
 
-		ts_for_each_lchan(lchan, ts) {
-			if (lchan_state_is(lchan, LCHAN_ST_UNUSED))
-				count++;
-		}
+	ts_for_each_lchan(lchan, ts) {
+		if (lchan_state_is(lchan, LCHAN_ST_UNUSED))
+			count++;
 	}
 
 	return count;
 }
 
-/* Count number of free TS of given pchan type */
-int bts_count_free_ts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan)
+/* Count number of free TS of given pchan type by scanning all TRX and timeslots. For TCH/F and TCH/H,
+ * bts_count_free_ts() returns the same from incrementally maintained counts. */
+int bts_count_free_ts_scan(struct gsm_bts *bts, enum gsm_phys_chan_config pchan)
 {
 	struct gsm_bts_trx *trx;
 	int count = 0;
+	int i;
 
-	llist_for_each_entry(trx, &bts->trx_list, list)
-		count += trx_count_free_ts(trx, pchan);
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (!trx_is_usable(trx))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+			count += ts_count_free(&trx->ts[i], pchan);
+	}
 
 	return count;
 }
 
+/* Count number of free TS of given pchan type. This is O(1) for TCH/F and TCH/H, see ts_free_tch_update(). */
+int bts_count_free_ts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan)
+{
+	switch (pchan) {
+	case GSM_PCHAN_TCH_F:
+		return bts->free_tch.tch_f;
+	case GSM_PCHAN_TCH_H:
+		return bts->free_tch.tch_h;
+	default:
+		return bts_count_free_ts_scan(bts, pchan);
+	}
+}
+
+/* Recount the free TCH/F and TCH/H of one timeslot and apply the difference to its BTS' free_tch. Called
+ * along with ts_chan_load_update() from ts_avail_update(). */
+void ts_free_tch_update(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_bts *bts = ts->trx->bts;
+	int tch_f = ts_count_free(ts, GSM_PCHAN_TCH_F);
+	int tch_h = ts_count_free(ts, GSM_PCHAN_TCH_H);
+
+	bts->free_tch.tch_f += tch_f - ts->free_tch.tch_f;
+	bts->free_tch.tch_h += tch_h - ts->free_tch.tch_h;
+	ts->free_tch.tch_f = tch_f;
+	ts->free_tch.tch_h = tch_h;
+}
+
+/* Compare the incrementally maintained free TCH counts of a BTS against a full scan. On mismatch, log an
+ * error and resync the counts from the scan. Return true if the counts were consistent. */
+bool bts_free_tch_check(struct gsm_bts *bts)
+{
+	int tch_f = bts_count_free_ts_scan(bts, GSM_PCHAN_TCH_F);
+	int tch_h = bts_count_free_ts_scan(bts, GSM_PCHAN_TCH_H);
+	struct gsm_bts_trx *trx;
+	int i;
+
+	if (bts->free_tch.tch_f == tch_f && bts->free_tch.tch_h == tch_h)
+		return true;
+
+	LOG_BTS(bts, DRLL, LOGL_ERROR, "free TCH count out of sync: TCH/F=%d TCH/H=%d,"
+		" but a full scan counts TCH/F=%d TCH/H=%d\n",
+		bts->free_tch.tch_f, bts->free_tch.tch_h, tch_f, tch_h);
+
+	memset(&bts->free_tch, 0, sizeof(bts->free_tch));
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			memset(&trx->ts[i].free_tch, 0, sizeof(trx->ts[i].free_tch));
+			ts_free_tch_update(&trx->ts[i]);
+		}
+	}
+	return false;
+}
+
 bool ts_is_usable(const struct gsm_bts_trx_ts *ts)
 {
 	if (!trx_is_usable(ts->trx)) {
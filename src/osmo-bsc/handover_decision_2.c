@@ -25,6 +25,8 @@
 #include <stdbool.h>
 #include <errno.h>
 
+#include <osmocom/core/timer_compat.h>
+
 #include <osmocom/bsc/debug.h>
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/handover_fsm.h>
@@ -37,6 +39,7 @@
 #include <osmocom/bsc/penalty_timers.h>
 #include <osmocom/bsc/neighbor_ident.h>
 #include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/latency_prof.h>
 
 #define LOGPHOBTS(bts, level, fmt, args...) \
 	LOGP(DHODEC, level, "(BTS %u) " fmt, bts->nr, ## args)
@@ -133,6 +136,10 @@ static const char *ho_reason_name(int value)
 static bool hodec2_initialized = false;
 static enum ho_reason global_ho_reason;
 
+/* Candidate list for bts_resolve_congestion(), kept across congestion checks and only ever grown */
+static struct ho_candidate *congestion_clist;
+static unsigned int congestion_clist_size;
+
 static void congestion_check_cb(void *arg);
 
 /* This function gets called on ho2 init, whenever the congestion check interval is changed, and also
@@ -216,131 +223,6 @@ static unsigned int conn_penalty_time_remaining(struct gsm_subscriber_connection
 	return penalty_timers_remaining(conn->hodec2.penalty_timers, for_object);
 }
 
-/* did we get a RXLEV for a given cell in the given report? Mark matches as MRC_F_PROCESSED. */
-static struct gsm_meas_rep_cell *cell_in_rep(struct gsm_meas_rep *mr, uint16_t arfcn, uint8_t bsic)
-{
-	int i;
-
-	for (i = 0; i < mr->num_cell; i++) {
-		struct gsm_meas_rep_cell *mrc = &mr->cell[i];
-
-		if (mrc->arfcn != arfcn)
-			continue;
-		if (mrc->bsic != bsic)
-			continue;
-
-		return mrc;
-	}
-	return NULL;
-}
-
-/* obtain averaged rxlev for given neighbor */
-static int neigh_meas_avg(struct neigh_meas_proc *nmp, int window)
-{
-	unsigned int i, idx;
-	int avg = 0;
-
-	/* reduce window to the actual number of existing measurements */
-	if (window > nmp->rxlev_cnt)
-		window = nmp->rxlev_cnt;
-	/* this should never happen */
-	if (window <= 0)
-		return 0;
-
-	idx = calc_initial_idx(ARRAY_SIZE(nmp->rxlev),
-			       nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev),
-			       window);
-
-	for (i = 0; i < window; i++) {
-		int j = (idx+i) % ARRAY_SIZE(nmp->rxlev);
-
-		avg += nmp->rxlev[j];
-	}
-
-	return avg / window;
-}
-
-/* Find empty slot or the worst neighbor. */
-static struct neigh_meas_proc *find_unused_or_worst_neigh(struct gsm_lchan *lchan)
-{
-	struct neigh_meas_proc *nmp_worst = NULL;
-	int worst;
-	int j;
-
-	/* First try to find an empty/unused slot. */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
-		if (!nmp->arfcn)
-			return nmp;
-	}
-
-	/* No empty slot found. Return worst neighbor to be evicted. */
-	worst = 0; /* (overwritten on first loop, but avoid compiler warning) */
-	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
-		int avg = neigh_meas_avg(nmp, MAX_WIN_NEIGH_AVG);
-		if (nmp_worst && avg >= worst)
-			continue;
-		worst = avg;
-		nmp_worst = nmp;
-	}
-
-	return nmp_worst;
-}
-
-/* process neighbor cell measurement reports */
-static void process_meas_neigh(struct gsm_meas_rep *mr)
-{
-	int i, j, idx;
-
-	/* For each reported cell, try to update measurements we already have from previous reports. */
-	for (j = 0; j < ARRAY_SIZE(mr->lchan->neigh_meas); j++) {
-		struct neigh_meas_proc *nmp = &mr->lchan->neigh_meas[j];
-		unsigned int idx;
-		struct gsm_meas_rep_cell *mrc;
-
-		/* skip unused entries */
-		if (!nmp->arfcn)
-			continue;
-
-		mrc = cell_in_rep(mr, nmp->arfcn, nmp->bsic);
-		idx = nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev);
-		if (mrc) {
-			nmp->rxlev[idx] = mrc->rxlev;
-			nmp->last_seen_nr = mr->nr;
-			mrc->flags |= MRC_F_PROCESSED;
-		} else {
-			nmp->rxlev[idx] = 0;
-		}
-		nmp->rxlev_cnt++;
-	}
-
-	/* Add cells that we don't know about yet, if necessary overwriting previous records that reflect
-	 * cells with worse receive levels */
-	for (i = 0; i < mr->num_cell; i++) {
-		struct gsm_meas_rep_cell *mrc = &mr->cell[i];
-		struct neigh_meas_proc *nmp;
-
-		if (mrc->flags & MRC_F_PROCESSED)
-			continue;
-
-		nmp = find_unused_or_worst_neigh(mr->lchan);
-
-		nmp->arfcn = mrc->arfcn;
-		nmp->bsic = mrc->bsic;
-
-		nmp->rxlev_cnt = 0;
-		idx = nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev);
-		nmp->rxlev[idx] = mrc->rxlev;
-		nmp->rxlev_cnt++;
-		nmp->last_seen_nr = mr->nr;
-		LOGPHOLCHAN(mr->lchan, LOGL_DEBUG, "neigh %u new in report rxlev=%d last_seen_nr=%u\n",
-			    nmp->arfcn, mrc->rxlev, nmp->last_seen_nr);
-
-		mrc->flags |= MRC_F_PROCESSED;
-	}
-}
-
 static bool codec_type_is_supported(struct gsm_subscriber_connection *conn,
 				    enum gsm0808_speech_codec_type type)
 {
@@ -1247,7 +1129,7 @@ static void on_measurement_report(struct gsm_meas_rep *mr)
 
 	/* parse actual neighbor cell info */
 	if (mr->num_cell > 0 && mr->num_cell < 7)
-		process_meas_neigh(mr);
+		neigh_meas_process(mr);
 
 	/* check for ongoing handover/assignment */
 	if (!lchan->conn) {
@@ -1406,6 +1288,7 @@ static int bts_resolve_congestion(struct gsm_bts *bts, int tchf_congestion, int
 	struct gsm_bts_trx_ts *ts;
 	int i, j;
 	struct ho_candidate *clist;
+	unsigned int clist_size;
 	unsigned int candidates;
 	struct ho_candidate *best_cand = NULL, *worst_cand = NULL;
 	struct gsm_lchan *delete_lchan = NULL;
@@ -1423,11 +1306,16 @@ static int bts_resolve_congestion(struct gsm_bts *bts, int tchf_congestion, int
 	LOGPHOBTS(bts, LOGL_INFO, "congested: %d TCH/F and %d TCH/H should be moved\n",
 		  tchf_congestion, tchh_congestion);
 
-	/* allocate array of all bts */
-	clist = talloc_zero_array(tall_bsc_ctx, struct ho_candidate,
-		bts->num_trx * 8 * 2 * (1 + ARRAY_SIZE(lc->neigh_meas)));
-	if (!clist)
-		return 0;
+	/* make room for candidates from all lchans of the bts */
+	clist_size = bts->num_trx * 8 * 2 * (1 + ARRAY_SIZE(lc->neigh_meas));
+	if (congestion_clist_size < clist_size) {
+		clist = talloc_realloc(tall_bsc_ctx, congestion_clist, struct ho_candidate, clist_size);
+		if (!clist)
+			return 0;
+		congestion_clist = clist;
+		congestion_clist_size = clist_size;
+	}
+	clist = congestion_clist;
 
 	candidates = 0;
 
@@ -1803,8 +1691,7 @@ next_c2:
 
 
 exit:
-	/* free array */
-	talloc_free(clist);
+	bts->network->hodec2.congestion_check_stats.candidates += candidates;
 
 	if (tchf_congestion <= 0 && tchh_congestion <= 0)
 		LOGP(DHODEC, LOGL_INFO, "Congestion at BTS %d solved!\n",
@@ -1859,21 +1746,48 @@ static void bts_congestion_check(struct gsm_bts *bts)
 	}
 
 	LOGPHOBTS(bts, LOGL_DEBUG, "Attempting to resolve congestion...\n");
+	bts->network->hodec2.congestion_check_stats.congested_bts++;
 	bts_resolve_congestion(bts, min_free_tchf - tchf_count, min_free_tchh - tchh_count);
 }
 
+/* Check all BTS for congestion. The free TCH counts are maintained incrementally, so a BTS that is not
+ * congested costs next to nothing; candidates are only collected for congested BTS. */
 void hodec2_congestion_check(struct gsm_network *net)
 {
 	struct gsm_bts *bts;
+	struct timespec start, end, elapsed;
+	unsigned long us;
+
+	net->hodec2.congestion_check_stats.congested_bts = 0;
+	net->hodec2.congestion_check_stats.candidates = 0;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &start);
 
 	llist_for_each_entry(bts, &net->bts_list, list)
 		bts_congestion_check(bts);
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &end);
+	timespecsub(&end, &start, &elapsed);
+	us = elapsed.tv_sec * 1000000 + elapsed.tv_nsec / 1000;
+
+	net->hodec2.congestion_check_stats.runs++;
+	net->hodec2.congestion_check_stats.last_us = us;
+	net->hodec2.congestion_check_stats.total_us += us;
+	if (us > net->hodec2.congestion_check_stats.max_us)
+		net->hodec2.congestion_check_stats.max_us = us;
+
+	LOGP(DHODEC, LOGL_DEBUG, "HO algorithm 2: congestion check took %lu us, %u congested BTS,"
+	     " %u candidates\n", us, net->hodec2.congestion_check_stats.congested_bts,
+	     net->hodec2.congestion_check_stats.candidates);
 }
 
 static void congestion_check_cb(void *arg)
 {
 	struct gsm_network *net = arg;
+	struct timespec start;
+
+	latency_prof_start(&start);
 	hodec2_congestion_check(net);
+	latency_prof_stop(LATENCY_PROF_HODEC2_CONGESTION, 0, &start);
 	reinit_congestion_timer(net);
 }
 
@@ -125,6 +125,31 @@ int bts_handover_count(struct gsm_bts *bts, int ho_scopes)
 	return count;
 }
 
+/* Match one local cell against search_for when all local cells are regarded as neighbors.
+ * Return -EINVAL if more than one local cell matches exactly. */
+static int match_local_cell(struct gsm_subscriber_connection *conn, struct gsm_bts *bts,
+			    const struct neighbor_ident_key *search_for, bool log_errors,
+			    struct gsm_bts **local_target_cell, struct gsm_bts **wildcard_match)
+{
+	struct neighbor_ident_key bts_key = *bts_ident_key(bts);
+	if (neighbor_ident_key_match(&bts_key, search_for, true)) {
+		if (*local_target_cell) {
+			if (log_errors)
+				LOG_HO(conn, LOGL_ERROR,
+				       "NEIGHBOR CONFIGURATION ERROR: Multiple local cells match %s"
+				       " (BTS %d and BTS %d)."
+				       " Aborting Handover because of ambiguous network topology.\n",
+				       neighbor_ident_key_name(search_for),
+				       (*local_target_cell)->nr, bts->nr);
+			return -EINVAL;
+		}
+		*local_target_cell = bts;
+	}
+	if (neighbor_ident_key_match(&bts_key, search_for, false))
+		*wildcard_match = bts;
+	return 0;
+}
+
 /* Find out a handover target cell for the given neighbor_ident_key,
  * and make sure there are no ambiguous matches.
  * Given a source BTS and a target ARFCN+BSIC, find which cell is the right handover target.
@@ -145,7 +170,7 @@ int find_handover_target_cell(struct gsm_bts **local_target_cell_p,
 	struct gsm_bts *from_bts;
 	struct gsm_bts *local_target_cell = NULL;
 	const struct gsm0808_cell_id_list2 *remote_target_cell = NULL;
-	struct gsm_bts_ref *neigh;
+	struct gsm_bts *neigh_bts;
 	bool ho_active;
 	bool as_active;
 
@@ -186,23 +211,19 @@ int find_handover_target_cell(struct gsm_bts **local_target_cell_p,
 
 		LOG_HO(conn, LOGL_DEBUG, "No explicit neighbors, regarding all local cells as neighbors\n");
 
-		llist_for_each_entry(bts, &net->bts_list, list) {
-			struct neighbor_ident_key bts_key = *bts_ident_key(bts);
-			if (neighbor_ident_key_match(&bts_key, search_for, true)) {
-				if (local_target_cell) {
-					if (log_errors)
-						LOG_HO(conn, LOGL_ERROR,
-						       "NEIGHBOR CONFIGURATION ERROR: Multiple local cells match %s"
-						       " (BTS %d and BTS %d)."
-						       " Aborting Handover because of ambiguous network topology.\n",
-						       neighbor_ident_key_name(search_for),
-						       local_target_cell->nr, bts->nr);
+		if (search_for->bsic == BSIC_ANY) {
+			llist_for_each_entry(bts, &net->bts_list, list) {
+				if (match_local_cell(conn, bts, search_for, log_errors,
+						     &local_target_cell, &wildcard_match))
+					return -EINVAL;
+			}
+		} else {
+			/* Local cells have a specific BSIC, so only those with this ARFCN and BSIC can match */
+			gsm_bts_for_each_by_arfcn_bsic(net, bts, search_for->arfcn, search_for->bsic) {
+				if (match_local_cell(conn, bts, search_for, log_errors,
+						     &local_target_cell, &wildcard_match))
 					return -EINVAL;
-				}
-				local_target_cell = bts;
 			}
-			if (neighbor_ident_key_match(&bts_key, search_for, false))
-				wildcard_match = bts;
 		}
 
 		if (!local_target_cell)
@@ -240,18 +261,20 @@ int find_handover_target_cell(struct gsm_bts **local_target_cell_p,
 
 	LOG_HO(conn, LOGL_DEBUG, "There are explicit neighbors configured for this cell\n");
 
-	/* Iterate explicit local neighbor cells */
-	llist_for_each_entry(neigh, &from_bts->local_neighbors, entry) {
-		struct gsm_bts *neigh_bts = neigh->bts;
-		struct neighbor_ident_key neigh_bts_key = *bts_ident_key(neigh_bts);
-		neigh_bts_key.from_bts = from_bts->nr;
+	/* Iterate the local cells with the ARFCN and BSIC searched for, and pick those that are explicit
+	 * neighbors. A local cell never has BSIC_ANY, so a wildcard search matches no local neighbor. */
+	gsm_bts_for_each_by_arfcn_bsic(net, neigh_bts, search_for->arfcn, search_for->bsic) {
+		struct neighbor_ident_key neigh_bts_key;
 
-		LOG_HO(conn, LOGL_DEBUG, "Local neighbor %s\n", neighbor_ident_key_name(&neigh_bts_key));
+		if (!gsm_bts_ref_find(&from_bts->local_neighbors, neigh_bts))
+			continue;
 
-		if (!neighbor_ident_key_match(&neigh_bts_key, search_for, true)) {
-			LOG_HO(conn, LOGL_DEBUG, "Doesn't match %s\n", neighbor_ident_key_name(search_for));
+		neigh_bts_key = *bts_ident_key(neigh_bts);
+		neigh_bts_key.from_bts = from_bts->nr;
+		if (!neighbor_ident_key_match(&neigh_bts_key, search_for, true))
 			continue;
-		}
+
+		LOG_HO(conn, LOGL_DEBUG, "Local neighbor %s matches\n", neighbor_ident_key_name(&neigh_bts_key));
 
 		if (local_target_cell) {
 			if (log_errors)
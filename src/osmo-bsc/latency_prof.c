@@ -0,0 +1,231 @@
+/* Latency profiler for the handlers run from the osmo-bsc main loop */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer_compat.h>
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/abis_nm.h>
+#include <osmocom/gsm/gsm0808.h>
+
+#include <osmocom/bsc/latency_prof.h>
+#include <osmocom/bsc/pcuif_proto.h>
+
+bool latency_prof_enabled = false;
+
+const struct value_string latency_prof_handler_names[] = {
+	{ LATENCY_PROF_LOOP,			"loop" },
+	{ LATENCY_PROF_RSL,			"rsl" },
+	{ LATENCY_PROF_OML,			"oml" },
+	{ LATENCY_PROF_BSSMAP_UDT,		"bssmap-udt" },
+	{ LATENCY_PROF_BSSMAP_DT,		"bssmap-dt" },
+	{ LATENCY_PROF_DTAP,			"dtap" },
+	{ LATENCY_PROF_PCU,			"pcu" },
+	{ LATENCY_PROF_HODEC2_CONGESTION,	"hodec2-congestion" },
+	{}
+};
+
+/* PCU messages received by the BSC */
+static const struct value_string pcu_msg_type_names[] = {
+	{ PCU_IF_MSG_DATA_REQ,	"DATA_REQ" },
+	{ PCU_IF_MSG_ACT_REQ,	"ACT_REQ" },
+	{ PCU_IF_MSG_PAG_REQ,	"PAG_REQ" },
+	{ PCU_IF_MSG_TXT_IND,	"TXT_IND" },
+	{}
+};
+
+static void *latency_prof_ctx;
+/* per handler and message type, allocated on the first sample */
+static struct latency_hist *hist[_NUM_LATENCY_PROF_HANDLERS][256];
+static struct latency_hist total[_NUM_LATENCY_PROF_HANDLERS];
+
+static struct osmo_timer_list probe_timer;
+static struct timespec probe_due;
+
+static void probe_schedule(void)
+{
+	struct timespec interval = {
+		.tv_sec = LATENCY_PROF_PROBE_INTERVAL / 1000,
+		.tv_nsec = (LATENCY_PROF_PROBE_INTERVAL % 1000) * 1000000,
+	};
+	struct timespec now;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecadd(&now, &interval, &probe_due);
+	osmo_timer_schedule(&probe_timer, interval.tv_sec, interval.tv_nsec / 1000);
+}
+
+/* How late the probe timer fires is how long the main loop was kept from serving it */
+static void probe_timer_cb(void *data)
+{
+	latency_prof_stop(LATENCY_PROF_LOOP, 0, &probe_due);
+	probe_schedule();
+}
+
+/*! Set the talloc context for the histograms */
+void latency_prof_init(void *ctx)
+{
+	latency_prof_ctx = ctx;
+}
+
+/*! Start or stop recording; samples recorded so far are kept */
+void latency_prof_enable(bool enable)
+{
+	latency_prof_enabled = enable;
+	if (!probe_timer.cb)
+		osmo_timer_setup(&probe_timer, probe_timer_cb, NULL);
+	if (!enable)
+		osmo_timer_del(&probe_timer);
+	else if (!osmo_timer_pending(&probe_timer))
+		probe_schedule();
+}
+
+/*! Discard all samples */
+void latency_prof_reset(void)
+{
+	int i, j;
+
+	for (i = 0; i < _NUM_LATENCY_PROF_HANDLERS; i++) {
+		for (j = 0; j < ARRAY_SIZE(hist[i]); j++) {
+			talloc_free(hist[i][j]);
+			hist[i][j] = NULL;
+		}
+	}
+	memset(total, 0, sizeof(total));
+}
+
+static void hist_add(struct latency_hist *h, uint32_t us)
+{
+	unsigned int bucket = us ? 32 - __builtin_clz(us) : 0;
+
+	if (bucket >= LATENCY_PROF_BUCKETS)
+		bucket = LATENCY_PROF_BUCKETS - 1;
+	h->bucket[bucket]++;
+	h->count++;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+}
+
+void _latency_prof_record(enum latency_prof_handler handler, uint8_t msg_type, const struct timespec *start)
+{
+	struct latency_hist **h = &hist[handler][msg_type];
+	struct timespec now, elapsed;
+	uint64_t us;
+
+	/* enabled after the start of this call */
+	if (!start->tv_sec && !start->tv_nsec)
+		return;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	if (timespeccmp(&now, start, <))
+		us = 0;
+	else {
+		timespecsub(&now, start, &elapsed);
+		us = (uint64_t)elapsed.tv_sec * 1000000 + elapsed.tv_nsec / 1000;
+	}
+	if (us > UINT32_MAX)
+		us = UINT32_MAX;
+
+	if (!*h) {
+		*h = talloc_zero(latency_prof_ctx, struct latency_hist);
+		if (!*h)
+			return;
+	}
+	hist_add(*h, us);
+	hist_add(&total[handler], us);
+}
+
+/*! \returns the samples of one handler and message type, or NULL if there are none */
+const struct latency_hist *latency_prof_get(enum latency_prof_handler handler, uint8_t msg_type)
+{
+	return hist[handler][msg_type];
+}
+
+/*! \returns the samples of one handler over all message types */
+const struct latency_hist *latency_prof_total(enum latency_prof_handler handler)
+{
+	return &total[handler];
+}
+
+/*! \returns whether samples of \a handler are kept per message type */
+bool latency_prof_has_msg_types(enum latency_prof_handler handler)
+{
+	switch (handler) {
+	case LATENCY_PROF_RSL:
+	case LATENCY_PROF_OML:
+	case LATENCY_PROF_BSSMAP_UDT:
+	case LATENCY_PROF_BSSMAP_DT:
+	case LATENCY_PROF_PCU:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const char *latency_prof_msg_type_name(enum latency_prof_handler handler, uint8_t msg_type)
+{
+	switch (handler) {
+	case LATENCY_PROF_RSL:
+		return rsl_msg_name(msg_type);
+	case LATENCY_PROF_OML:
+		return get_value_string(abis_nm_msgtype_names, msg_type);
+	case LATENCY_PROF_BSSMAP_UDT:
+	case LATENCY_PROF_BSSMAP_DT:
+		return gsm0808_bssmap_name(msg_type);
+	case LATENCY_PROF_PCU:
+		return get_value_string(pcu_msg_type_names, msg_type);
+	default:
+		return "-";
+	}
+}
+
+uint32_t latency_hist_avg_us(const struct latency_hist *h)
+{
+	return h->count ? h->total_us / h->count : 0;
+}
+
+/*! \returns the upper limit of a histogram bucket in us, UINT32_MAX for the last one */
+uint32_t latency_hist_bucket_limit_us(unsigned int bucket)
+{
+	if (bucket >= LATENCY_PROF_BUCKETS - 1)
+		return UINT32_MAX;
+	return 1 << bucket;
+}
+
+/*! \returns the upper limit of the bucket in which the given percentile of samples falls, but at most the
+ * longest sample seen */
+uint32_t latency_hist_percentile_us(const struct latency_hist *h, unsigned int percent)
+{
+	uint64_t want = (h->count * percent + 99) / 100;
+	uint64_t seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+
+	for (i = 0; i < LATENCY_PROF_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen >= want)
+			break;
+	}
+	return OSMO_MIN(latency_hist_bucket_limit_us(i), h->max_us);
+}
@@ -392,6 +392,8 @@ static void lchan_reset(struct gsm_lchan *lchan)
 		lchan->mgw_endpoint_ci_bts = NULL;
 	}
 
+	lchan_meas_hist_free(lchan);
+
 	/* NUL all volatile state */
 	*lchan = (struct gsm_lchan){
 		.ts = lchan->ts,
@@ -409,9 +411,16 @@ static void lchan_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_sta
 {
 	struct gsm_lchan *lchan = lchan_fi_lchan(fi);
 	lchan_reset(lchan);
+	ts_avail_update(lchan->ts);
 	osmo_fsm_inst_dispatch(lchan->ts->fi, TS_EV_LCHAN_UNUSED, lchan);
 }
 
+static void lchan_fsm_cbch_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct gsm_lchan *lchan = lchan_fi_lchan(fi);
+	ts_avail_update(lchan->ts);
+}
+
 /* Configure the multirate setting on this channel. */
 static int lchan_mr_config(struct gsm_lchan *lchan, const struct gsm48_multi_rate_conf *mr_conf)
 {
@@ -513,6 +522,9 @@ static void lchan_fsm_wait_ts_ready_onenter(struct osmo_fsm_inst *fi, uint32_t p
 	struct lchan_activate_info *info = &lchan->activate.info;
 	int ms_power_dbm;
 
+	/* leaving UNUSED, the lchan now counts as used in the channel load */
+	ts_avail_update(lchan->ts);
+
 	if (lchan->release.requested) {
 		lchan_fail("Release requested while activating");
 		return;
@@ -1072,6 +1084,9 @@ static void lchan_fsm_borken_onenter(struct osmo_fsm_inst *fi, uint32_t prev_sta
 {
 	struct gsm_lchan *lchan = lchan_fi_lchan(fi);
 	enum bts_counter_id ctr;
+
+	ts_avail_update(lchan->ts);
+
 	switch (prev_state) {
 	case LCHAN_ST_UNUSED:
 		ctr = BTS_CTR_LCHAN_BORKEN_FROM_UNUSED;
@@ -1163,6 +1178,7 @@ static const struct osmo_fsm_state lchan_fsm_states[] = {
 	},
 	[LCHAN_ST_CBCH] = {
 		.name = "CBCH",
+		.onenter = lchan_fsm_cbch_onenter,
 		.out_state_mask = 0
 			| S(LCHAN_ST_UNUSED)
 			,
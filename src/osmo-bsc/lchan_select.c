@@ -30,12 +30,10 @@
 #include <osmocom/bsc/lchan_select.h>
 
 static struct gsm_lchan *
-_lc_find_trx(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan,
-	     enum gsm_phys_chan_config as_pchan)
+_lc_find_ts(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config pchan,
+	    enum gsm_phys_chan_config as_pchan)
 {
 	struct gsm_lchan *lchan;
-	struct gsm_bts_trx_ts *ts;
-	int j, start, stop, dir;
 
 #define LOGPLCHANALLOC(fmt, args...) \
 		LOGP(DRLL, LOGL_DEBUG, "looking for lchan %s%s%s: " fmt, \
@@ -43,79 +41,68 @@ _lc_find_trx(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan,
 		     pchan == as_pchan ? "" : " as ", \
 		     pchan == as_pchan ? "" : gsm_pchan_name(as_pchan), ## args)
 
-	if (!trx_is_usable(trx)) {
-		LOGPLCHANALLOC("%s trx not usable\n", gsm_trx_name(trx));
+	if (!ts_is_usable(ts))
+		return NULL;
+	/* The caller first selects what kind of TS to search in, e.g. looking for exact
+	 * GSM_PCHAN_TCH_F, or maybe among dynamic GSM_PCHAN_TCH_F_TCH_H_PDCH... */
+	if (ts->pchan_on_init != pchan) {
+		LOGPLCHANALLOC("%s is != %s\n", gsm_ts_and_pchan_name(ts),
+			       gsm_pchan_name(pchan));
 		return NULL;
 	}
-
-	if (trx->bts->chan_alloc_reverse) {
-		/* check TS 7..0 */
-		start = 7;
-		stop = -1;
-		dir = -1;
-	} else {
-		/* check TS 0..7 */
-		start = 0;
-		stop = 8;
-		dir = 1;
+	/* Next, is this timeslot in or can it be switched to the pchan we want to use it for? */
+	if (!ts_usable_as_pchan(ts, as_pchan)) {
+		LOGPLCHANALLOC("%s is not usable as %s\n", gsm_ts_and_pchan_name(ts),
+			       gsm_pchan_name(as_pchan));
+		return NULL;
 	}
 
-	for (j = start; j != stop; j += dir) {
-		ts = &trx->ts[j];
-		if (!ts_is_usable(ts))
-			continue;
-		/* The caller first selects what kind of TS to search in, e.g. looking for exact
-		 * GSM_PCHAN_TCH_F, or maybe among dynamic GSM_PCHAN_TCH_F_TCH_H_PDCH... */
-		if (ts->pchan_on_init != pchan) {
-			LOGPLCHANALLOC("%s is != %s\n", gsm_ts_and_pchan_name(ts),
-				       gsm_pchan_name(pchan));
-			continue;
-		}
-		/* Next, is this timeslot in or can it be switched to the pchan we want to use it for? */
-		if (!ts_usable_as_pchan(ts, as_pchan)) {
-			LOGPLCHANALLOC("%s is not usable as %s\n", gsm_ts_and_pchan_name(ts),
-				       gsm_pchan_name(as_pchan));
-			continue;
-		}
-
-		/* TS is (going to be) in desired pchan mode. Go ahead and check for an available lchan. */
-		ts_as_pchan_for_each_lchan(lchan, ts, as_pchan) {
-			if (lchan->fi->state == LCHAN_ST_UNUSED) {
-				LOGPLCHANALLOC("%s ss=%d is available%s\n",
-					       gsm_ts_and_pchan_name(ts), lchan->nr,
-					       ts->pchan_is != as_pchan ? " after dyn PCHAN change" : "");
-				return lchan;
-			}
-			LOGPLCHANALLOC("%s ss=%d in type=%s,state=%s not suitable\n",
+	/* TS is (going to be) in desired pchan mode. Go ahead and check for an available lchan. */
+	ts_as_pchan_for_each_lchan(lchan, ts, as_pchan) {
+		if (lchan->fi->state == LCHAN_ST_UNUSED) {
+			LOGPLCHANALLOC("%s ss=%d is available%s\n",
 				       gsm_ts_and_pchan_name(ts), lchan->nr,
-				       gsm_lchant_name(lchan->type),
-				       osmo_fsm_inst_state_name(lchan->fi));
+				       ts->pchan_is != as_pchan ? " after dyn PCHAN change" : "");
+			return lchan;
 		}
+		LOGPLCHANALLOC("%s ss=%d in type=%s,state=%s not suitable\n",
+			       gsm_ts_and_pchan_name(ts), lchan->nr,
+			       gsm_lchant_name(lchan->type),
+			       osmo_fsm_inst_state_name(lchan->fi));
 	}
 
 	return NULL;
 #undef LOGPLCHANALLOC
 }
 
+/* Only look at the timeslots that the BTS' free_ts bitmap for this pchan marks as usable and having an
+ * UNUSED lchan; all other timeslots could never yield an lchan here. The bitmap is ordered by TRX and TS
+ * number, so this visits the candidates in the same order as walking the TRX list and TS 0..7 (or, with
+ * chan_alloc_reverse, the TRX list backwards and TS 7..0). Dynamic timeslots that the dyn TS reserve keeps
+ * out of PDCH are tried first, since the others may need a PDCH deactivation. */
 static struct gsm_lchan *
 _lc_dyn_find_bts(struct gsm_bts *bts, enum gsm_phys_chan_config pchan,
 		 enum gsm_phys_chan_config dyn_as_pchan)
 {
-	struct gsm_bts_trx *trx;
+	struct gsm_bts_trx_ts *ts;
 	struct gsm_lchan *lc;
+	int bit = -1;
 
-	if (bts->chan_alloc_reverse) {
-		llist_for_each_entry_reverse(trx, &bts->trx_list, list) {
-			lc = _lc_find_trx(trx, pchan, dyn_as_pchan);
-			if (lc)
-				return lc;
-		}
-	} else {
-		llist_for_each_entry(trx, &bts->trx_list, list) {
-			lc = _lc_find_trx(trx, pchan, dyn_as_pchan);
+	if (pchan != dyn_as_pchan && bts->dyn_ts_reserve.target) {
+		while ((ts = bts_free_ts_next(bts, pchan, &bit, bts->chan_alloc_reverse))) {
+			if (!ts->tch_reserved)
+				continue;
+			lc = _lc_find_ts(ts, pchan, dyn_as_pchan);
 			if (lc)
 				return lc;
 		}
+		bit = -1;
+	}
+
+	while ((ts = bts_free_ts_next(bts, pchan, &bit, bts->chan_alloc_reverse))) {
+		lc = _lc_find_ts(ts, pchan, dyn_as_pchan);
+		if (lc)
+			return lc;
 	}
 
 	return NULL;
@@ -197,6 +184,7 @@ struct gsm_lchan *lchan_select_by_type(struct gsm_bts *bts, enum gsm_chan_t type
 		lchan = _lc_find_bts(bts, GSM_PCHAN_TCH_F);
 		/* If we don't have TCH/F available, try dynamic TCH/F_PDCH */
 		if (!lchan) {
+			bts->dyn_ts_reserve.tch_requests++;
 			lchan = _lc_dyn_find_bts(bts, GSM_PCHAN_TCH_F_PDCH,
 						 GSM_PCHAN_TCH_F);
 			/* TCH/F_PDCH used as TCH/F -- here, type is already
@@ -219,6 +207,7 @@ struct gsm_lchan *lchan_select_by_type(struct gsm_bts *bts, enum gsm_chan_t type
 		/* No dedicated TCH/x available -- try fully dynamic
 		 * TCH/F_TCH/H_PDCH */
 		if (!lchan) {
+			bts->dyn_ts_reserve.tch_requests++;
 			lchan = _lc_dyn_find_bts(bts,
 						 GSM_PCHAN_TCH_F_TCH_H_PDCH,
 						 GSM_PCHAN_TCH_H);
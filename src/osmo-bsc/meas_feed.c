@@ -1,14 +1,21 @@
 /* UDP-Feed of measurement reports */
 
+#define _GNU_SOURCE
 #include <unistd.h>
+#include <errno.h>
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/socket.h>
 #include <osmocom/core/write_queue.h>
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/timer.h>
+
+#include <osmocom/gsm/gsm48.h>
 
 #include <osmocom/vty/command.h>
 #include <osmocom/vty/vty.h>
@@ -20,14 +27,214 @@
 #include <osmocom/bsc/vty.h>
 #include <osmocom/bsc/debug.h>
 
+#include "../../bscconfig.h"
+
+/* Most v2 batches to pass to one sendmmsg() */
+#define MEAS_FEED_MMSG_MAX	16
+/* Write queue depth: room for a full flush of pending batches while the previous flush is still queued */
+#define MEAS_FEED_WQUEUE_LEN	(2 * MEAS_FEED_MMSG_MAX)
+
 struct meas_feed_state {
 	struct osmo_wqueue wqueue;
 	char scenario[31+1];
 	char *dst_host;
 	uint16_t dst_port;
+	uint16_t version;
+
+	/* MEAS_FEED_VERSION_2: the batch currently being filled, sent when full or when batch_timer fires */
+	struct msgb *batch;
+	struct osmo_timer_list batch_timer;
+	unsigned int batch_interval_ms;
+
+	/* Full batches waiting to be sent together in one sendmmsg() */
+	bool use_sendmmsg;
+	struct llist_head pending;
+	unsigned int pending_count;
 };
 
-static struct meas_feed_state g_mfs = {};
+static struct meas_feed_state g_mfs = {
+	.version = MEAS_FEED_VERSION,
+	.batch_interval_ms = MEAS_FEED_BATCH_INTERVAL_DEFAULT,
+	.pending = LLIST_HEAD_INIT(g_mfs.pending),
+};
+
+static void meas_feed_enqueue(struct msgb *msg)
+{
+	if (osmo_wqueue_enqueue(&g_mfs.wqueue, msg) != 0) {
+		LOGP(DMEAS, LOGL_ERROR, "meas_feed: sending measurement report batch failed\n");
+		msgb_free(msg);
+	}
+}
+
+/* Send all pending v2 batches, with a single sendmmsg() if enabled and nothing is waiting in the write
+ * queue already. Whatever sendmmsg() does not take goes through the write queue. */
+static void meas_feed_pending_flush(void)
+{
+	struct msgb *msg, *msg2;
+
+#ifdef HAVE_SENDMMSG
+	if (g_mfs.use_sendmmsg && g_mfs.pending_count && llist_empty(&g_mfs.wqueue.msg_queue)) {
+		struct mmsghdr mmsg[MEAS_FEED_MMSG_MAX] = {};
+		struct iovec iov[MEAS_FEED_MMSG_MAX];
+		unsigned int n = 0;
+		int rc;
+
+		llist_for_each_entry(msg, &g_mfs.pending, list) {
+			if (n == ARRAY_SIZE(mmsg))
+				break;
+			iov[n].iov_base = msgb_data(msg);
+			iov[n].iov_len = msgb_length(msg);
+			mmsg[n].msg_hdr.msg_iov = &iov[n];
+			mmsg[n].msg_hdr.msg_iovlen = 1;
+			n++;
+		}
+
+		rc = sendmmsg(g_mfs.wqueue.bfd.fd, mmsg, n, 0);
+		if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			LOGP(DMEAS, LOGL_ERROR, "meas_feed: sendmmsg() failed: %s\n", strerror(errno));
+
+		llist_for_each_entry_safe(msg, msg2, &g_mfs.pending, list) {
+			if (rc <= 0)
+				break;
+			llist_del(&msg->list);
+			msgb_free(msg);
+			g_mfs.pending_count--;
+			rc--;
+		}
+	}
+#endif
+
+	llist_for_each_entry_safe(msg, msg2, &g_mfs.pending, list) {
+		llist_del(&msg->list);
+		meas_feed_enqueue(msg);
+	}
+	g_mfs.pending_count = 0;
+}
+
+/* The batch being filled is done, queue it for sending */
+static void meas_feed_v2_batch_close(void)
+{
+	if (!g_mfs.batch)
+		return;
+	llist_add_tail(&g_mfs.batch->list, &g_mfs.pending);
+	g_mfs.pending_count++;
+	g_mfs.batch = NULL;
+
+	if (!g_mfs.use_sendmmsg || g_mfs.pending_count >= MEAS_FEED_MMSG_MAX)
+		meas_feed_pending_flush();
+}
+
+static struct msgb *meas_feed_v2_batch_open(void)
+{
+	struct meas_feed_v2_batch *b;
+	struct msgb *msg = msgb_alloc(MEAS_FEED_V2_MAX_LEN, "Meas. Feed v2");
+	if (!msg)
+		return NULL;
+
+	b = (struct meas_feed_v2_batch *) msgb_put(msg, sizeof(*b));
+	b->hdr.msg_type = MEAS_FEED_MEAS_BATCH;
+	b->hdr.reserved = 0;
+	b->hdr.version = htons(MEAS_FEED_VERSION_2);
+	osmo_strlcpy(b->scenario, g_mfs.scenario, sizeof(b->scenario));
+	b->num_meas = 0;
+
+	g_mfs.batch = msg;
+	if (!osmo_timer_pending(&g_mfs.batch_timer))
+		osmo_timer_schedule(&g_mfs.batch_timer, g_mfs.batch_interval_ms / 1000,
+				    (g_mfs.batch_interval_ms % 1000) * 1000);
+	return msg;
+}
+
+static void meas_feed_batch_timer_cb(void *data)
+{
+	meas_feed_v2_batch_close();
+	meas_feed_pending_flush();
+}
+
+/* Drop the batch being filled and all pending batches, e.g. when the destination changes */
+static void meas_feed_v2_discard(void)
+{
+	struct msgb *msg, *msg2;
+
+	osmo_timer_del(&g_mfs.batch_timer);
+	if (g_mfs.batch) {
+		msgb_free(g_mfs.batch);
+		g_mfs.batch = NULL;
+	}
+	llist_for_each_entry_safe(msg, msg2, &g_mfs.pending, list) {
+		llist_del(&msg->list);
+		msgb_free(msg);
+	}
+	g_mfs.pending_count = 0;
+}
+
+static void meas_feed_v2_add(struct gsm_meas_rep *mr)
+{
+	struct gsm_lchan *lchan = mr->lchan;
+	struct bsc_subscr *bsub = lchan->conn->bsub;
+	struct meas_feed_v2_batch *b;
+	struct meas_feed_v2_meas *m;
+	struct meas_feed_v2_cell *c;
+	/* num_cell == 7 means no neighbor information, so no cells to encode */
+	unsigned int num_cell = mr->num_cell >= 0 && mr->num_cell <= (int)ARRAY_SIZE(mr->cell) ? mr->num_cell : 0;
+	size_t len = sizeof(*m) + num_cell * sizeof(*c);
+	int i;
+
+	if (g_mfs.batch) {
+		b = (struct meas_feed_v2_batch *) msgb_data(g_mfs.batch);
+		if (msgb_tailroom(g_mfs.batch) < len || b->num_meas == UINT8_MAX) {
+			meas_feed_v2_batch_close();
+			/* the next batch starts now and gets a full interval */
+			osmo_timer_del(&g_mfs.batch_timer);
+		}
+	}
+	if (!g_mfs.batch && !meas_feed_v2_batch_open())
+		return;
+	b = (struct meas_feed_v2_batch *) msgb_data(g_mfs.batch);
+
+	m = (struct meas_feed_v2_meas *) msgb_put(g_mfs.batch, len);
+	memset(m, 0, len);
+	if (bsub) {
+		osmo_strlcpy(m->imsi, bsub->imsi, sizeof(m->imsi));
+		m->tmsi = htonl(bsub->tmsi);
+	} else
+		m->tmsi = htonl(GSM_RESERVED_TMSI);
+
+	m->lchan_type = lchan->type;
+	m->pchan_type = lchan->ts->pchan_is;
+	m->bts_nr = lchan->ts->trx->bts->nr;
+	m->trx_nr = lchan->ts->trx->nr;
+	m->ts_nr = lchan->ts->nr;
+	m->ss_nr = lchan->nr;
+
+	m->nr = mr->nr;
+	m->flags = mr->flags;
+	m->ul_full.rx_lev = mr->ul.full.rx_lev;
+	m->ul_full.rx_qual = mr->ul.full.rx_qual;
+	m->ul_sub.rx_lev = mr->ul.sub.rx_lev;
+	m->ul_sub.rx_qual = mr->ul.sub.rx_qual;
+	m->dl_full.rx_lev = mr->dl.full.rx_lev;
+	m->dl_full.rx_qual = mr->dl.full.rx_qual;
+	m->dl_sub.rx_lev = mr->dl.sub.rx_lev;
+	m->dl_sub.rx_qual = mr->dl.sub.rx_qual;
+	m->bs_power = mr->bs_power;
+	m->ms_timing_offset = htons(mr->ms_timing_offset);
+	m->ms_l1_pwr = mr->ms_l1.pwr;
+	m->ms_l1_ta = mr->ms_l1.ta;
+	m->num_cell = mr->num_cell;
+
+	c = (struct meas_feed_v2_cell *) m->data;
+	for (i = 0; i < num_cell; i++) {
+		c[i].arfcn = htons(mr->cell[i].arfcn);
+		c[i].rxlev = mr->cell[i].rxlev;
+		c[i].bsic = mr->cell[i].bsic;
+		c[i].neigh_idx = mr->cell[i].neigh_idx;
+	}
+
+	b->num_meas++;
+	LOGP(DMEAS, LOGL_DEBUG, "meas_feed %s: added measurement report to batch (%u)\n",
+	     gsm_lchan_name(lchan), b->num_meas);
+}
 
 static int process_meas_rep(struct gsm_meas_rep *mr)
 {
@@ -45,6 +252,11 @@ static int process_meas_rep(struct gsm_meas_rep *mr)
 		return 0;
 	}
 
+	if (g_mfs.version == MEAS_FEED_VERSION_2) {
+		meas_feed_v2_add(mr);
+		return 0;
+	}
+
 	bsub = mr->lchan->conn->bsub;
 
 	msg = msgb_alloc(sizeof(struct meas_feed_meas), "Meas. Feed");
@@ -138,14 +350,16 @@ int meas_feed_cfg_set(const char *dst_host, uint16_t dst_port)
 		return 0;
 
 	if (!already_initialized) {
-		osmo_wqueue_init(&g_mfs.wqueue, 10);
+		osmo_wqueue_init(&g_mfs.wqueue, MEAS_FEED_WQUEUE_LEN);
 		g_mfs.wqueue.write_cb = feed_write_cb;
 		g_mfs.wqueue.read_cb = feed_read_cb;
+		osmo_timer_setup(&g_mfs.batch_timer, meas_feed_batch_timer_cb, NULL);
 		osmo_signal_register_handler(SS_LCHAN, meas_feed_sig_cb, NULL);
 		LOGP(DMEAS, LOGL_DEBUG, "meas_feed: registered signal callback\n");
 	}
 
 	if (already_initialized) {
+		meas_feed_v2_discard();
 		osmo_wqueue_clear(&g_mfs.wqueue);
 		osmo_fd_unregister(&g_mfs.wqueue.bfd);
 		close(g_mfs.wqueue.bfd.fd);
@@ -183,3 +397,48 @@ const char *meas_feed_scenario_get(void)
 {
 	return g_mfs.scenario;
 }
+
+/* Switch between MEAS_FEED_VERSION and MEAS_FEED_VERSION_2. Reports batched so far are sent right away. */
+void meas_feed_version_set(uint16_t version)
+{
+	if (version == g_mfs.version)
+		return;
+	if (g_mfs.batch || g_mfs.pending_count) {
+		meas_feed_v2_batch_close();
+		meas_feed_pending_flush();
+	}
+	g_mfs.version = version;
+}
+
+uint16_t meas_feed_version_get(void)
+{
+	return g_mfs.version;
+}
+
+/* Longest time a v2 report is held back waiting for its batch to fill up */
+void meas_feed_batch_interval_set(unsigned int ms)
+{
+	g_mfs.batch_interval_ms = ms;
+}
+
+unsigned int meas_feed_batch_interval_get(void)
+{
+	return g_mfs.batch_interval_ms;
+}
+
+int meas_feed_sendmmsg_set(bool enable)
+{
+#ifndef HAVE_SENDMMSG
+	if (enable)
+		return -ENOTSUP;
+#endif
+	if (!enable && g_mfs.pending_count)
+		meas_feed_pending_flush();
+	g_mfs.use_sendmmsg = enable;
+	return 0;
+}
+
+bool meas_feed_sendmmsg_get(void)
+{
+	return g_mfs.use_sendmmsg;
+}
@@ -20,12 +20,16 @@
  */
 
 #include <errno.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
 
 #include <osmocom/bsc/gsm_data.h>
 #include <osmocom/bsc/meas_rep.h>
+#include <osmocom/bsc/lchan_fsm.h>
 
 static int get_field(const struct gsm_meas_rep *rep,
-		     enum meas_rep_field field)
+		     unsigned int field)
 {
 	switch (field) {
 	case MEAS_REP_DL_RXLEV_FULL:
@@ -52,11 +56,94 @@ static int get_field(const struct gsm_meas_rep *rep,
 		return rep->ul.full.rx_qual;
 	case MEAS_REP_UL_RXQUAL_SUB:
 		return rep->ul.sub.rx_qual;
+	case MEAS_HIST_MS_TA:
+		if (!(rep->flags & MEAS_REP_F_MS_L1))
+			return -EINVAL;
+		return rep->ms_l1.ta;
 	}
 
 	return 0;
 }
 
+/*! Return the report to fill in for the next Measurement Result on this lchan, allocating the lchan's
+ * measurement history on the first report after activation. Call lchan_meas_rep_add() once it is complete. */
+struct gsm_meas_rep *lchan_meas_rep_next(struct gsm_lchan *lchan)
+{
+	struct gsm_meas_rep *mr;
+
+	if (!lchan->meas_hist) {
+		lchan->meas_hist = talloc_zero(lchan->ts->trx, struct lchan_meas_hist);
+		OSMO_ASSERT(lchan->meas_hist);
+	}
+
+	mr = &lchan->meas_hist->last;
+	memset(mr, 0, sizeof(*mr));
+	mr->lchan = lchan;
+	return mr;
+}
+
+/*! Add the report from lchan_meas_rep_next() to the history */
+void lchan_meas_rep_add(struct gsm_lchan *lchan)
+{
+	struct lchan_meas_hist *h = lchan->meas_hist;
+	unsigned int field;
+	unsigned int prev = h->count % (MAX_MEAS_REP + 1);
+	unsigned int cur = (h->count + 1) % (MAX_MEAS_REP + 1);
+	unsigned int val_idx = h->count % MAX_MEAS_REP;
+
+	for (field = 0; field < MEAS_HIST_NUM_FIELDS; field++) {
+		int val = get_field(&h->last, field);
+		if (val < 0) {
+			h->val[field][val_idx] = MEAS_HIST_INVALID;
+			h->sum[field][cur] = h->sum[field][prev];
+			h->num_valid[field][cur] = h->num_valid[field][prev];
+		} else {
+			h->val[field][val_idx] = val;
+			h->sum[field][cur] = h->sum[field][prev] + val;
+			h->num_valid[field][cur] = h->num_valid[field][prev] + 1;
+		}
+	}
+	h->count++;
+}
+
+/*! Return the most recent measurement report of the lchan, all zero if there is none */
+const struct gsm_meas_rep *lchan_meas_rep_last(const struct gsm_lchan *lchan)
+{
+	static const struct gsm_meas_rep none = {};
+	if (!lchan->meas_hist)
+		return &none;
+	return &lchan->meas_hist->last;
+}
+
+void lchan_meas_hist_free(struct gsm_lchan *lchan)
+{
+	talloc_free(lchan->meas_hist);
+	lchan->meas_hist = NULL;
+}
+
+static int meas_hist_avg(const struct gsm_lchan *lchan, unsigned int field, unsigned int num)
+{
+	const struct lchan_meas_hist *h = lchan->meas_hist;
+	unsigned int cur, old;
+	uint16_t sum;
+	uint8_t valid_num;
+
+	if (num < 1 || num > MAX_MEAS_REP)
+		return -EINVAL;
+
+	if (!h || num > h->count)
+		return -EINVAL;
+
+	cur = h->count % (MAX_MEAS_REP + 1);
+	old = (h->count - num) % (MAX_MEAS_REP + 1);
+	valid_num = h->num_valid[field][cur] - h->num_valid[field][old];
+	sum = h->sum[field][cur] - h->sum[field][old];
+
+	if (valid_num == 0)
+		return -EINVAL;
+
+	return sum / valid_num;
+}
 
 unsigned int calc_initial_idx(unsigned int array_size,
 			      unsigned int meas_rep_idx,
@@ -80,32 +167,7 @@ unsigned int calc_initial_idx(unsigned int array_size,
 int get_meas_rep_avg(const struct gsm_lchan *lchan,
 		     enum meas_rep_field field, unsigned int num)
 {
-	unsigned int i, idx;
-	int avg = 0, valid_num = 0;
-
-	if (num < 1)
-		return -EINVAL;
-
-	if (num > lchan->meas_rep_count)
-		return -EINVAL;
-
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-				lchan->meas_rep_idx, num);
-
-	for (i = 0; i < num; i++) {
-		int j = (idx+i) % ARRAY_SIZE(lchan->meas_rep);
-		int val = get_field(&lchan->meas_rep[j], field);
-
-		if (val >= 0) {
-			avg += val;
-			valid_num++;
-		}
-	}
-
-	if (valid_num == 0)
-		return -EINVAL;
-
-	return avg / valid_num;
+	return meas_hist_avg(lchan, field, num);
 }
 
 /* Check if N out of M last values for FIELD are >= bd */
@@ -113,17 +175,20 @@ int meas_rep_n_out_of_m_be(const struct gsm_lchan *lchan,
 			enum meas_rep_field field,
 			unsigned int n, unsigned int m, int be)
 {
-	unsigned int i, idx;
+	const struct lchan_meas_hist *h = lchan->meas_hist;
+	unsigned int i;
 	int count = 0;
 
-	idx = calc_initial_idx(ARRAY_SIZE(lchan->meas_rep),
-				lchan->meas_rep_idx, m);
+	if (!h)
+		return 0;
+
+	/* only look at reports that were actually received */
+	m = OSMO_MIN(m, OSMO_MIN(h->count, MAX_MEAS_REP));
 
 	for (i = 0; i < m; i++) {
-		int j = (idx + i) % ARRAY_SIZE(lchan->meas_rep);
-		int val = get_field(&lchan->meas_rep[j], field);
+		uint8_t val = h->val[field][(h->count - 1 - i) % MAX_MEAS_REP];
 
-		if (val >= be) /* implies that val < 0 will not count */
+		if (val != MEAS_HIST_INVALID && val >= be)
 			count++;
 
 		if (count >= n)
@@ -132,3 +197,123 @@ int meas_rep_n_out_of_m_be(const struct gsm_lchan *lchan,
 
 	return 0;
 }
+
+#define NEIGH_MEAS_KEY(arfcn, bsic) (((uint32_t)(arfcn) << 8) | (uint32_t)(bsic))
+
+static void neigh_meas_add(struct neigh_meas_proc *nmp, uint8_t rxlev)
+{
+	unsigned int prev = nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev_sum);
+
+	nmp->rxlev[nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev)] = rxlev;
+	nmp->rxlev_cnt++;
+	nmp->rxlev_sum[nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev_sum)] = nmp->rxlev_sum[prev] + rxlev;
+}
+
+/*! Obtain averaged rxlev for given neighbor over the last 'window' reports, or fewer if there are not as many
+ * yet. Returns 0 if there are no measurements. */
+int neigh_meas_avg(const struct neigh_meas_proc *nmp, int window)
+{
+	uint16_t sum;
+
+	/* reduce window to the actual number of existing measurements */
+	if (window > nmp->rxlev_cnt)
+		window = nmp->rxlev_cnt;
+	if (window > MAX_WIN_NEIGH_AVG)
+		window = MAX_WIN_NEIGH_AVG;
+	/* this should never happen */
+	if (window <= 0)
+		return 0;
+
+	sum = nmp->rxlev_sum[nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev_sum)]
+		- nmp->rxlev_sum[(nmp->rxlev_cnt - window) % ARRAY_SIZE(nmp->rxlev_sum)];
+	return sum / window;
+}
+
+/* Find empty slot or the worst neighbor. */
+static struct neigh_meas_proc *find_unused_or_worst_neigh(struct gsm_lchan *lchan)
+{
+	struct neigh_meas_proc *nmp_worst = NULL;
+	int worst = 0;
+	int j;
+
+	/* First try to find an empty/unused slot. */
+	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+		if (!nmp->arfcn)
+			return nmp;
+	}
+
+	/* No empty slot found. Return worst neighbor to be evicted. */
+	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+		int avg = neigh_meas_avg(nmp, MAX_WIN_NEIGH_AVG);
+		if (nmp_worst && avg >= worst)
+			continue;
+		worst = avg;
+		nmp_worst = nmp;
+	}
+
+	return nmp_worst;
+}
+
+/*! Process the neighbor cell measurements of a report into the lchan's neigh_meas table: every tracked cell
+ * gets the rxlev from the report, or 0 if it was not reported; cells not tracked yet take an unused slot or
+ * replace the cell with the lowest average rxlev. Averages are O(1) from the running totals, so replacing a
+ * cell no longer re-averages every slot's window. Reported cells are marked with MRC_F_PROCESSED. */
+void neigh_meas_process(struct gsm_meas_rep *mr)
+{
+	struct gsm_lchan *lchan = mr->lchan;
+	uint32_t cell_key[ARRAY_SIZE(mr->cell)];
+	int num_cell = OSMO_MAX(0, OSMO_MIN(mr->num_cell, (int)ARRAY_SIZE(mr->cell)));
+	int i, j;
+
+	/* Key the reported cells by ARFCN and BSIC, so that matching them is a plain integer compare */
+	for (i = 0; i < num_cell; i++)
+		cell_key[i] = NEIGH_MEAS_KEY(mr->cell[i].arfcn, mr->cell[i].bsic);
+
+	/* For each reported cell, try to update measurements we already have from previous reports. */
+	for (j = 0; j < MAX_NEIGH_MEAS; j++) {
+		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+		uint32_t key;
+		uint8_t rxlev = 0;
+
+		/* skip unused entries */
+		if (!nmp->arfcn)
+			continue;
+
+		key = NEIGH_MEAS_KEY(nmp->arfcn, nmp->bsic);
+		for (i = 0; i < num_cell; i++) {
+			if (cell_key[i] == key) {
+				rxlev = mr->cell[i].rxlev;
+				nmp->last_seen_nr = mr->nr;
+				mr->cell[i].flags |= MRC_F_PROCESSED;
+				break;
+			}
+		}
+		neigh_meas_add(nmp, rxlev);
+	}
+
+	/* Add cells that we don't know about yet, if necessary overwriting previous records that reflect
+	 * cells with worse receive levels */
+	for (i = 0; i < num_cell; i++) {
+		struct gsm_meas_rep_cell *mrc = &mr->cell[i];
+		struct neigh_meas_proc *nmp;
+
+		if (mrc->flags & MRC_F_PROCESSED)
+			continue;
+
+		nmp = find_unused_or_worst_neigh(lchan);
+
+		nmp->arfcn = mrc->arfcn;
+		nmp->bsic = mrc->bsic;
+
+		nmp->rxlev_cnt = 0;
+		nmp->rxlev_sum[0] = 0;
+		neigh_meas_add(nmp, mrc->rxlev);
+		nmp->last_seen_nr = mr->nr;
+		LOG_LCHAN(lchan, LOGL_DEBUG, "neigh %u new in report rxlev=%d last_seen_nr=%u\n",
+			  nmp->arfcn, mrc->rxlev, nmp->last_seen_nr);
+
+		mrc->flags |= MRC_F_PROCESSED;
+	}
+}
@@ -32,18 +32,32 @@
 #include <osmocom/gsm/gsm0808.h>
 
 #include <osmocom/bsc/neighbor_ident.h>
+#include <osmocom/bsc/hashtable.h>
 
 struct neighbor_ident_list {
+	/* all entries in the order they were added */
 	struct llist_head list;
+	/* the same entries, hashed by NEIGHBOR_IDENT_HASH_KEY() of their complete key */
+	DECLARE_HASHTABLE(by_key, 10);
+	/* number of entries per from_bts, for neighbor_ident_has_from_bts() */
+	unsigned int from_bts_count[256];
+	/* incremented for each new entry, to tell which of several wildcard matches was added last */
+	unsigned int next_seq;
 };
 
 struct neighbor_ident {
 	struct llist_head entry;
+	struct llist_head hash_entry;
+	unsigned int seq;
 
 	struct neighbor_ident_key key;
 	struct gsm0808_cell_id_list2 val;
 };
 
+/* from_bts takes 9 bits (NEIGHBOR_IDENT_KEY_ANY_BTS becomes 0), ARFCN 10 bits and BSIC 8 bits */
+#define NEIGHBOR_IDENT_HASH_KEY(from_bts, arfcn, bsic) \
+	((((uint32_t)((from_bts) + 1) & 0x1ff) << 18) | (((uint32_t)(arfcn) & 0x3ff) << 8) | (uint32_t)(bsic))
+
 #define APPEND_THING(func, args...) do { \
 		int remain = buflen - (pos - buf); \
 		int l = func(pos, remain, ##args); \
@@ -85,6 +99,7 @@ struct neighbor_ident_list *neighbor_ident_init(void *talloc_ctx)
 	struct neighbor_ident_list *nil = talloc_zero(talloc_ctx, struct neighbor_ident_list);
 	OSMO_ASSERT(nil);
 	INIT_LLIST_HEAD(&nil->list);
+	hash_init(nil->by_key);
 	return nil;
 }
 
@@ -127,9 +142,8 @@ bool neighbor_ident_key_match(const struct neighbor_ident_key *entry,
 	return entry->bsic == search_for->bsic;
 }
 
-static struct neighbor_ident *_neighbor_ident_get(const struct neighbor_ident_list *nil,
-						  const struct neighbor_ident_key *key,
-						  bool exact_match)
+static struct neighbor_ident *_neighbor_ident_get_linear(const struct neighbor_ident_list *nil,
+							 const struct neighbor_ident_key *key)
 {
 	struct neighbor_ident *ni;
 	struct neighbor_ident *wildcard_match = NULL;
@@ -140,16 +154,65 @@ static struct neighbor_ident *_neighbor_ident_get(const struct neighbor_ident_li
 	llist_for_each_entry(ni, &nil->list, entry) {
 		if (neighbor_ident_key_match(&ni->key, key, true))
 			return ni;
-		if (!exact_match) {
-			if (neighbor_ident_key_match(&ni->key, key, false))
-				wildcard_match = ni;
-		}
+		if (neighbor_ident_key_match(&ni->key, key, false))
+			wildcard_match = ni;
 	}
 	return wildcard_match;
 }
 
-static void _neighbor_ident_free(struct neighbor_ident *ni)
+/* Look in the hash bucket of one possible entry key; remember the most recently added wildcard match. */
+static struct neighbor_ident *_neighbor_ident_probe(const struct neighbor_ident_list *nil,
+						    const struct neighbor_ident_key *key,
+						    int from_bts, uint8_t bsic,
+						    struct neighbor_ident **wildcard_match)
+{
+	struct neighbor_ident *ni;
+	uint32_t hkey = NEIGHBOR_IDENT_HASH_KEY(from_bts, key->arfcn, bsic);
+
+	hash_for_each_possible(nil->by_key, ni, hash_entry, hkey) {
+		if (ni->key.from_bts != from_bts || ni->key.arfcn != key->arfcn || ni->key.bsic != bsic)
+			continue;
+		if (neighbor_ident_key_match(&ni->key, key, true))
+			return ni;
+		if (wildcard_match
+		    && neighbor_ident_key_match(&ni->key, key, false)
+		    && (!*wildcard_match || ni->seq > (*wildcard_match)->seq))
+			*wildcard_match = ni;
+	}
+	return NULL;
+}
+
+/* An entry matching a key with a specific from_bts and BSIC can only have that same from_bts or
+ * NEIGHBOR_IDENT_KEY_ANY_BTS, and that same BSIC or BSIC_ANY, so at most four hash buckets need to be looked
+ * at. Returns the same entry as a walk over the entire list would: an exact match if there is one, otherwise
+ * the wildcard match added last. */
+static struct neighbor_ident *_neighbor_ident_get(const struct neighbor_ident_list *nil,
+						  const struct neighbor_ident_key *key,
+						  bool exact_match)
 {
+	struct neighbor_ident *ni;
+	struct neighbor_ident *wildcard_match = NULL;
+
+	if (exact_match)
+		return _neighbor_ident_probe(nil, key, key->from_bts, key->bsic, NULL);
+
+	/* A wildcard search key may match any entry on the ARFCN */
+	if (key->from_bts == NEIGHBOR_IDENT_KEY_ANY_BTS || key->bsic == BSIC_ANY)
+		return _neighbor_ident_get_linear(nil, key);
+
+	if ((ni = _neighbor_ident_probe(nil, key, key->from_bts, key->bsic, &wildcard_match)))
+		return ni;
+	_neighbor_ident_probe(nil, key, key->from_bts, BSIC_ANY, &wildcard_match);
+	_neighbor_ident_probe(nil, key, NEIGHBOR_IDENT_KEY_ANY_BTS, key->bsic, &wildcard_match);
+	_neighbor_ident_probe(nil, key, NEIGHBOR_IDENT_KEY_ANY_BTS, BSIC_ANY, &wildcard_match);
+	return wildcard_match;
+}
+
+static void _neighbor_ident_free(struct neighbor_ident_list *nil, struct neighbor_ident *ni)
+{
+	if (ni->key.from_bts != NEIGHBOR_IDENT_KEY_ANY_BTS)
+		nil->from_bts_count[ni->key.from_bts]--;
+	hash_del(&ni->hash_entry);
 	llist_del(&ni->entry);
 	talloc_free(ni);
 }
@@ -191,8 +254,12 @@ int neighbor_ident_add(struct neighbor_ident_list *nil, const struct neighbor_id
 		*ni = (struct neighbor_ident){
 			.key = *key,
 			.val = *val,
+			.seq = nil->next_seq++,
 		};
 		llist_add_tail(&ni->entry, &nil->list);
+		hash_add(nil->by_key, &ni->hash_entry, NEIGHBOR_IDENT_HASH_KEY(key->from_bts, key->arfcn, key->bsic));
+		if (key->from_bts != NEIGHBOR_IDENT_KEY_ANY_BTS)
+			nil->from_bts_count[key->from_bts]++;
 		return ni->val.id_list_len;
 	}
 
@@ -226,7 +293,7 @@ bool neighbor_ident_del(struct neighbor_ident_list *nil, const struct neighbor_i
 	ni = _neighbor_ident_get(nil, key, true);
 	if (!ni)
 		return false;
-	_neighbor_ident_free(ni);
+	_neighbor_ident_free(nil, ni);
 	return true;
 }
 
@@ -234,7 +301,15 @@ void neighbor_ident_clear(struct neighbor_ident_list *nil)
 {
 	struct neighbor_ident *ni;
 	while ((ni = llist_first_entry_or_null(&nil->list, struct neighbor_ident, entry)))
-		_neighbor_ident_free(ni);
+		_neighbor_ident_free(nil, ni);
+}
+
+/*! Whether any entry was added for the given from_bts, not counting NEIGHBOR_IDENT_KEY_ANY_BTS entries */
+bool neighbor_ident_has_from_bts(const struct neighbor_ident_list *nil, uint8_t from_bts)
+{
+	if (!nil)
+		return false;
+	return nil->from_bts_count[from_bts] > 0;
 }
 
 /*! Iterate all neighbor_ident_list entries and call iter_cb for each.
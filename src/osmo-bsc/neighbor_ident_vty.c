@@ -391,11 +391,7 @@ static bool nil_match_bts(const struct neighbor_ident_key *key,
 
 bool neighbor_ident_bts_entry_exists(uint8_t from_bts)
 {
-	struct nil_match_bts_data d = {
-		.bts_nr = from_bts,
-	};
-	neighbor_ident_iter(g_neighbor_cells, nil_match_bts, &d);
-	return (bool)d.found;
+	return neighbor_ident_has_from_bts(g_neighbor_cells, from_bts);
 }
 
 static int neighbor_del_all(struct vty *vty)
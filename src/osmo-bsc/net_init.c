@@ -24,6 +24,8 @@
 #include <osmocom/bsc/handover_cfg.h>
 #include <osmocom/bsc/chan_alloc.h>
 #include <osmocom/bsc/neighbor_ident.h>
+#include <osmocom/bsc/bsc_subscriber.h>
+#include <osmocom/bsc/sccp_conn_id.h>
 
 static struct osmo_tdef gsm_network_T_defs[] = {
 	{ .T=7, .default_val=10, .desc="inter-BSC/MSC Handover outgoing, BSSMAP HO Required to HO Command timeout" },
@@ -42,6 +44,8 @@ static struct osmo_tdef gsm_network_T_defs[] = {
 	{ .T=3117, .default_val=10, .desc="(unused)" },
 	{ .T=3119, .default_val=10, .desc="(unused)" },
 	{ .T=3122, .default_val=GSM_T3122_DEFAULT, .desc="Wait time after RR Immediate Assignment Reject" },
+	{ .T=993122, .default_val=5, .unit=OSMO_TDEF_MS,
+		.desc="Collect Request References for up to this long to reject up to four in one RR Immediate Assignment Reject (0 = send right away)" },
 	{ .T=3141, .default_val=10, .desc="(unused)" },
 	{ .T=3212, .default_val=5, .unit=OSMO_TDEF_CUSTOM,
 		.desc="Periodic Location Update timer, sent to MS (1 = 6 minutes)" },
@@ -77,12 +81,16 @@ struct gsm_network *gsm_network_init(void *ctx)
 	net->a5_encryption_mask = (1 << 3) | (1 << 1);
 
 	INIT_LLIST_HEAD(&net->subscr_conns);
+	sccp_conn_id_init(net);
 
-	net->bsc_subscribers = talloc_zero(net, struct llist_head);
-	INIT_LLIST_HEAD(net->bsc_subscribers);
+	net->bsc_subscribers = bsc_subscr_store_alloc(net);
 
 	INIT_LLIST_HEAD(&net->bts_list);
 	net->num_bts = 0;
+	gsm_bts_cell_index_init(net);
+	INIT_LLIST_HEAD(&net->bts_admission.waiting);
+	net->bts_admission.max_parallel = BTS_ADMISSION_MAX_PARALLEL_DEFAULT;
+	net->bts_admission.timeout = BTS_ADMISSION_TIMEOUT_DEFAULT;
 
 	net->T_defs = gsm_network_T_defs;
 	osmo_tdefs_reset(net->T_defs);
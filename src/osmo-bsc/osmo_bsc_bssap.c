@@ -40,6 +40,7 @@
 #include <osmocom/bsc/osmo_bsc_lcls.h>
 #include <osmocom/bsc/a_reset.h>
 #include <osmocom/bsc/handover.h>
+#include <osmocom/bsc/latency_prof.h>
 #include <osmocom/core/fsm.h>
 #include <osmocom/core/socket.h>
 #include <osmocom/core/sockaddr_str.h>
@@ -135,7 +136,7 @@ page_subscriber(struct bsc_msc_data *msc, struct gsm_bts *bts,
 	}
 
 	subscr->lac = lac;
-	subscr->tmsi = tmsi;
+	bsc_subscr_set_tmsi(subscr, tmsi);
 
 	ret = bsc_grace_paging_request(msc->network->rf_ctrl->policy, subscr, chan_needed, msc, bts);
 	if (ret == 0)
@@ -166,11 +167,7 @@ page_cgi(struct bsc_msc_data *msc, struct gsm0808_cell_id_list2 *cil,
 		if (!osmo_plmn_cmp(&id->lai.plmn, &msc->network->plmn)) {
 			int paged = 0;
 			struct gsm_bts *bts;
-			llist_for_each_entry(bts, &msc->network->bts_list, list) {
-				if (bts->location_area_code != id->lai.lac)
-					continue;
-				if (bts->cell_identity != id->cell_identity)
-					continue;
+			gsm_bts_for_each_by_lac_ci(msc->network, bts, id->lai.lac, id->cell_identity) {
 				page_subscriber(msc, bts, tmsi, id->lai.lac, mi_string, chan_needed);
 				paged = 1;
 			}
@@ -197,11 +194,7 @@ page_lac_and_ci(struct bsc_msc_data *msc, struct gsm0808_cell_id_list2 *cil,
 		struct osmo_lac_and_ci_id *id = &cil->id_list[i].lac_and_ci;
 		int paged = 0;
 		struct gsm_bts *bts;
-		llist_for_each_entry(bts, &msc->network->bts_list, list) {
-			if (bts->location_area_code != id->lac)
-				continue;
-			if (bts->cell_identity != id->ci)
-				continue;
+		gsm_bts_for_each_by_lac_ci(msc->network, bts, id->lac, id->ci) {
 			page_subscriber(msc, bts, tmsi, id->lac, mi_string, chan_needed);
 			paged = 1;
 		}
@@ -222,9 +215,7 @@ page_ci(struct bsc_msc_data *msc, struct gsm0808_cell_id_list2 *cil,
 		uint16_t ci = cil->id_list[i].ci;
 		int paged = 0;
 		struct gsm_bts *bts;
-		llist_for_each_entry(bts, &msc->network->bts_list, list) {
-			if (bts->cell_identity != ci)
-				continue;
+		gsm_bts_for_each_by_ci(msc->network, bts, ci) {
 			page_subscriber(msc, bts, tmsi, GSM_LAC_RESERVED_ALL_BTS, mi_string, chan_needed);
 			paged = 1;
 		}
@@ -246,9 +237,7 @@ page_lai_and_lac(struct bsc_msc_data *msc, struct gsm0808_cell_id_list2 *cil,
 		if (!osmo_plmn_cmp(&id->plmn, &msc->network->plmn)) {
 			int paged = 0;
 			struct gsm_bts *bts;
-			llist_for_each_entry(bts, &msc->network->bts_list, list) {
-				if (bts->location_area_code != id->lac)
-					continue;
+			gsm_bts_for_each_by_lac(msc->network, bts, id->lac) {
 				page_subscriber(msc, bts, tmsi, id->lac, mi_string, chan_needed);
 				paged = 1;
 			}
@@ -275,9 +264,7 @@ page_lac(struct bsc_msc_data *msc, struct gsm0808_cell_id_list2 *cil,
 		uint16_t lac = cil->id_list[i].lac;
 		int paged = 0;
 		struct gsm_bts *bts;
-		llist_for_each_entry(bts, &msc->network->bts_list, list) {
-			if (bts->location_area_code != lac)
-				continue;
+		gsm_bts_for_each_by_lac(msc->network, bts, lac) {
 			page_subscriber(msc, bts, tmsi, lac, mi_string, chan_needed);
 			paged = 1;
 		}
@@ -1204,6 +1191,8 @@ int bsc_handle_udt(struct bsc_msc_data *msc,
 		   struct msgb *msgb, unsigned int length)
 {
 	struct bssmap_header *bs;
+	struct timespec start;
+	uint8_t msg_type;
 
 	LOGP(DMSC, LOGL_DEBUG, "Rx MSC UDT: %s\n",
 		osmo_hexdump(msgb->l3h, length));
@@ -1220,7 +1209,10 @@ int bsc_handle_udt(struct bsc_msc_data *msc,
 	switch (bs->type) {
 	case BSSAP_MSG_BSS_MANAGEMENT:
 		msgb->l4h = &msgb->l3h[sizeof(*bs)];
+		msg_type = length > sizeof(*bs) ? msgb->l4h[0] : 0;
+		latency_prof_start(&start);
 		bssmap_rcvmsg_udt(msc, msgb, length - sizeof(*bs));
+		latency_prof_stop(LATENCY_PROF_BSSMAP_UDT, msg_type, &start);
 		break;
 	default:
 		LOGP(DMSC, LOGL_NOTICE, "Unimplemented msg type: %s\n",
@@ -1263,6 +1255,9 @@ static unsigned int bssmap_msg_len(struct msgb *msg, unsigned int length,
 int bsc_handle_dt(struct gsm_subscriber_connection *conn,
 		  struct msgb *msg, unsigned int len)
 {
+	struct timespec start;
+	uint8_t msg_type;
+
 	log_set_context(LOG_CTX_BSC_SUBSCR, conn->bsub);
 
 	if (len < sizeof(struct bssmap_header)) {
@@ -1272,10 +1267,15 @@ int bsc_handle_dt(struct gsm_subscriber_connection *conn,
 	switch (msg->l3h[0]) {
 	case BSSAP_MSG_BSS_MANAGEMENT:
 		msg->l4h = &msg->l3h[sizeof(struct bssmap_header)];
+		msg_type = len > sizeof(struct bssmap_header) ? msg->l4h[0] : 0;
+		latency_prof_start(&start);
 		bssmap_rcvmsg_dt1(conn, msg, bssmap_msg_len(msg, len, conn));
+		latency_prof_stop(LATENCY_PROF_BSSMAP_DT, msg_type, &start);
 		break;
 	case BSSAP_MSG_DTAP:
+		latency_prof_start(&start);
 		dtap_rcvmsg(conn, msg, len);
+		latency_prof_stop(LATENCY_PROF_DTAP, 0, &start);
 		break;
 	default:
 		LOGP(DMSC, LOGL_NOTICE, "Unimplemented BSSAP msg type: %s\n",
@@ -26,6 +26,7 @@
 #include <osmocom/bsc/osmo_bsc_rf.h>
 #include <osmocom/bsc/bsc_msc_data.h>
 #include <osmocom/bsc/signal.h>
+#include <osmocom/bsc/a_reset.h>
 
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/signal.h>
@@ -200,6 +201,25 @@ static int get_msc_connection_status(struct ctrl_cmd *cmd, void *data)
 	return CTRL_CMD_REPLY;
 }
 
+CTRL_CMD_DEFINE_RO(msc_load, "load");
+static int get_msc_load(struct ctrl_cmd *cmd, void *data)
+{
+	struct bsc_msc_data *msc = (struct bsc_msc_data *)cmd->node;
+
+	if (msc == NULL) {
+		cmd->reply = "msc not found";
+		return CTRL_CMD_ERROR;
+	}
+
+	cmd->reply = talloc_asprintf(cmd, "%u,%u,%u,%s", msc->load.conns, msc->load.in_flight,
+				     msc->load.latency_us, a_reset_conn_ready(msc) ? "ready" : "not-ready");
+	if (!cmd->reply) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+	return CTRL_CMD_REPLY;
+}
+
 /* Backwards compat. */
 CTRL_CMD_DEFINE_RO(msc0_connection_status, "msc_connection_status");
 static int msc_connection_status = 0; /* XXX unused */
@@ -706,6 +726,9 @@ int bsc_ctrl_cmds_install(struct gsm_network *net)
 	if (rc)
 		goto end;
 	rc = ctrl_cmd_install(CTRL_NODE_MSC, &cmd_msc_connection_status);
+	if (rc)
+		goto end;
+	rc = ctrl_cmd_install(CTRL_NODE_MSC, &cmd_msc_load);
 	if (rc)
 		goto end;
 	rc = ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_msc0_connection_status);
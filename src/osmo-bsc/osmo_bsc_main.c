@@ -38,6 +38,7 @@
 #include <osmocom/bsc/assignment_fsm.h>
 #include <osmocom/bsc/handover_fsm.h>
 #include <osmocom/bsc/smscb.h>
+#include <osmocom/bsc/latency_prof.h>
 
 #include <osmocom/ctrl/control_cmd.h>
 #include <osmocom/ctrl/control_if.h>
@@ -387,6 +388,7 @@ static int inp_sig_cb(unsigned int subsys, unsigned int signal,
 				osmo_timer_del(&trx->bts->cbch_timer);
 		}
 
+		rsl_imm_ass_rej_discard(trx->bts);
 		gsm_bts_mo_reset(trx->bts);
 
 		abis_nm_clear_queue(trx->bts);
@@ -851,6 +853,7 @@ int main(int argc, char **argv)
 	bsc_subscr_conn_fsm_init();
 	assignment_fsm_init();
 	handover_fsm_init();
+	latency_prof_init(tall_bsc_ctx);
 
 	/* Read the config */
 	rc = bsc_network_configure(config_file);
@@ -197,6 +197,7 @@ struct bsc_msc_data *osmo_msc_data_alloc(struct gsm_network *net, int nr)
 
 	msc_data->nr = nr;
 	msc_data->allow_emerg = 1;
+	msc_data->selection_weight = 1;
 	msc_data->a.asp_proto = OSMO_SS7_ASP_PROT_M3UA;
 
 	/* Defaults for the audio setup */
@@ -231,6 +232,31 @@ struct bsc_msc_data *osmo_msc_data_alloc(struct gsm_network *net, int nr)
 	return msc_data;
 }
 
+/* Weight of a new latency sample in the moving average, 1/N */
+#define MSC_LATENCY_EWMA_N 8
+
+/* Added to the latency in bsc_msc_load_score(), so that MSCs with next to no latency still compare by their
+ * number of connections */
+#define MSC_LOAD_LATENCY_BIAS_US 10000
+
+void bsc_msc_latency_sample(struct bsc_msc_data *msc, unsigned int latency_us)
+{
+	if (!msc->load.latency_samples)
+		msc->load.latency_us = latency_us;
+	else
+		msc->load.latency_us = ((uint64_t)msc->load.latency_us * (MSC_LATENCY_EWMA_N - 1) + latency_us)
+				       / MSC_LATENCY_EWMA_N;
+	msc->load.latency_samples++;
+}
+
+/* How loaded an MSC is for 'msc-selection load-based', lower is better: its connections, counting those
+ * still waiting for Connection Confirm twice, times its response latency, per selection weight. */
+uint64_t bsc_msc_load_score(const struct bsc_msc_data *msc)
+{
+	uint64_t conns = msc->load.conns + msc->load.in_flight + 1;
+	return conns * (msc->load.latency_us + MSC_LOAD_LATENCY_BIAS_US) / OSMO_MAX(msc->selection_weight, 1);
+}
+
 struct osmo_cell_global_id *cgi_for_msc(struct bsc_msc_data *msc, struct gsm_bts *bts)
 {
 	static struct osmo_cell_global_id cgi;
@@ -34,6 +34,7 @@
 #include <osmocom/bsc/a_reset.h>
 #include <osmocom/bsc/bsc_subscr_conn_fsm.h>
 #include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/sccp_conn_id.h>
 #include <osmocom/mgcp_client/mgcp_common.h>
 
 /* A pointer to a list with all involved MSCs
@@ -45,41 +46,17 @@ static struct llist_head *msc_list;
 #define CS7_POINTCODE_DEFAULT_OFFSET 2
 #define DEFAULT_ASP_REMOTE_IP "127.0.0.1"
 
-/* The SCCP stack will not assign connection IDs to us automatically, we
- * will do this ourselves using a counter variable, that counts one up
- * for every new connection */
-static uint32_t conn_id_counter;
-
 /* Helper function to Check if the given connection id is already assigned */
 static struct gsm_subscriber_connection *get_bsc_conn_by_conn_id(int conn_id)
 {
-	conn_id &= 0xFFFFFF;
-	struct gsm_subscriber_connection *conn;
-
-	llist_for_each_entry(conn, &bsc_gsmnet->subscr_conns, entry) {
-		if (conn->sccp.conn_id == conn_id)
-			return conn;
-	}
-
-	return NULL;
+	return sccp_conn_id_find(bsc_gsmnet, conn_id);
 }
 
-/* Pick a free connection id */
+/* Pick a free connection id. The SCCP stack will not assign connection IDs to us automatically, we
+ * will do this ourselves, see sccp_conn_id_pick_free(). */
 static int pick_free_conn_id(const struct bsc_msc_data *msc)
 {
-	int conn_id = conn_id_counter;
-	int i;
-
-	for (i = 0; i < 0xFFFFFF; i++) {
-		conn_id++;
-		conn_id &= 0xFFFFFF;
-		if (get_bsc_conn_by_conn_id(conn_id) == false) {
-			conn_id_counter = conn_id;
-			return conn_id;
-		}
-	}
-
-	return -1;
+	return sccp_conn_id_pick_free(bsc_gsmnet);
 }
 
 /* Patch regular BSSMAP RESET to add extra T to announce Osmux support (osmocom extension) */
@@ -205,7 +182,7 @@ static int handle_n_connect_from_msc(struct osmo_sccp_user *scu, struct osmo_scu
 	if (!conn)
 		return -ENOMEM;
 	conn->sccp.msc = msc;
-	conn->sccp.conn_id = scu_prim->u.connect.conn_id;
+	sccp_conn_id_set(bsc_gsmnet, conn, scu_prim->u.connect.conn_id);
 
 	/* Take actions asked for by the enclosed PDU */
 	osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_CONN_IND, scu_prim);
@@ -244,7 +221,7 @@ static int sccp_sap_up(struct osmo_prim_hdr *oph, void *_scu)
 		conn = get_bsc_conn_by_conn_id(scu_prim->u.connect.conn_id);
 		if (conn) {
 			osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_CONN_CFM, scu_prim);
-			conn->sccp.state = SUBSCR_SCCP_ST_CONNECTED;
+			gscon_sccp_state_set(conn, SUBSCR_SCCP_ST_CONNECTED);
 			if (msgb_l2len(oph->msg) > 0)
 				handle_data_from_msc(conn, oph->msg);
 		} else {
@@ -274,7 +251,7 @@ static int sccp_sap_up(struct osmo_prim_hdr *oph, void *_scu)
 		/* indication of disconnect */
 		conn = get_bsc_conn_by_conn_id(scu_prim->u.disconnect.conn_id);
 		if (conn) {
-			conn->sccp.state = SUBSCR_SCCP_ST_NONE;
+			gscon_sccp_state_set(conn, SUBSCR_SCCP_ST_NONE);
 			if (msgb_l2len(oph->msg) > 0)
 				handle_data_from_msc(conn, oph->msg);
 			osmo_fsm_inst_dispatch(conn->fi, GSCON_EV_A_DISC_IND, scu_prim);
@@ -341,11 +318,12 @@ int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct ms
 		return -EINVAL;
 	}
 
-	conn->sccp.conn_id = conn_id = pick_free_conn_id(msc);
-	if (conn->sccp.conn_id < 0) {
+	conn_id = pick_free_conn_id(msc);
+	if (conn_id < 0) {
 		LOGP(DMSC, LOGL_ERROR, "Unable to allocate SCCP Connection ID\n");
 		return -1;
 	}
+	sccp_conn_id_set(bsc_gsmnet, conn, conn_id);
 	LOGP(DMSC, LOGL_DEBUG, "Allocated new connection id: %d\n", conn->sccp.conn_id);
 	ss7 = osmo_ss7_instance_find(msc->a.cs7_instance);
 	OSMO_ASSERT(ss7);
@@ -355,7 +333,7 @@ int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct ms
 	rc = osmo_sccp_tx_conn_req_msg(msc->a.sccp_user, conn_id, &msc->a.bsc_addr,
 				       &msc->a.msc_addr, msg);
 	if (rc >= 0)
-		conn->sccp.state = SUBSCR_SCCP_ST_WAIT_CONN_CONF;
+		gscon_sccp_state_set(conn, SUBSCR_SCCP_ST_WAIT_CONN_CONF);
 
 	return rc;
 }
@@ -26,6 +26,7 @@
 #include <osmocom/bsc/bsc_subscriber.h>
 #include <osmocom/bsc/debug.h>
 #include <osmocom/bsc/osmux.h>
+#include <osmocom/bsc/a_reset.h>
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/gsm/gsm48.h>
@@ -170,6 +171,9 @@ static void write_msc(struct vty *vty, struct bsc_msc_data *msc)
 		vty_out(vty, " osmux %s%s", msc->use_osmux == OSMUX_USAGE_ON ? "on" : "only",
 			VTY_NEWLINE);
 	}
+
+	if (msc->selection_weight != 1)
+		vty_out(vty, " selection-weight %u%s", msc->selection_weight, VTY_NEWLINE);
 }
 
 static int config_write_msc(struct vty *vty)
@@ -194,6 +198,9 @@ static int config_write_bsc(struct vty *vty)
 		vty_out(vty, " bsc-auto-rf-off %d%s",
 			bsc_gsmnet->auto_off_timeout, VTY_NEWLINE);
 
+	if (bsc_gsmnet->msc_selection == BSC_MSC_SELECTION_LOAD_BASED)
+		vty_out(vty, " msc-selection load-based%s", VTY_NEWLINE);
+
 	return CMD_SUCCESS;
 }
 
@@ -604,6 +611,31 @@ DEFUN(cfg_net_no_rf_off_time,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_net_bsc_msc_selection,
+      cfg_net_bsc_msc_selection_cmd,
+      "msc-selection (round-robin|load-based)",
+      "How to pick the MSC for a new MS originated connection\n"
+      "Take turns over all MSCs (default)\n"
+      "Pick the ready MSC with the fewest connections per selection-weight, scaled by its response latency\n")
+{
+	if (!strcmp(argv[0], "load-based"))
+		bsc_gsmnet->msc_selection = BSC_MSC_SELECTION_LOAD_BASED;
+	else
+		bsc_gsmnet->msc_selection = BSC_MSC_SELECTION_ROUND_ROBIN;
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_msc_selection_weight,
+      cfg_msc_selection_weight_cmd,
+      "selection-weight <1-1000>",
+      "Relative capacity of this MSC for 'msc-selection load-based'\n"
+      "An MSC with twice the weight is given twice as many connections (default 1)\n")
+{
+	struct bsc_msc_data *msc = bsc_msc_data(vty);
+	msc->selection_weight = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_statistics,
       show_statistics_cmd,
       "show statistics",
@@ -627,6 +659,11 @@ DEFUN(show_mscs,
 		vty_out(vty, "%s%s",
 			osmo_sccp_inst_addr_name(msc->a.sccp, &msc->a.msc_addr),
 			VTY_NEWLINE);
+		vty_out(vty, " %s, %u connections (%u in flight), latency %u.%03u ms, weight %u%s",
+			a_reset_conn_ready(msc) ? "ready" : "not ready",
+			msc->load.conns, msc->load.in_flight,
+			msc->load.latency_us / 1000, msc->load.latency_us % 1000,
+			msc->selection_weight, VTY_NEWLINE);
 	}
 
 	return CMD_SUCCESS;
@@ -737,7 +774,7 @@ DEFUN(show_subscr_all,
 	vty_out(vty, " IMSI             TMSI      LAC    Use%s", VTY_NEWLINE);
 	/*           " 001010123456789  ffffffff  65534  1" */
 
-	llist_for_each_entry(bsc_subscr, bsc_gsmnet->bsc_subscribers, entry)
+	llist_for_each_entry(bsc_subscr, &bsc_gsmnet->bsc_subscribers->bsub_list, entry)
 		dump_one_sub(vty, bsc_subscr);
 
 	return CMD_SUCCESS;
@@ -797,6 +834,7 @@ int bsc_vty_init_extra(void)
 	install_element(BSC_NODE, &cfg_net_rf_socket_cmd);
 	install_element(BSC_NODE, &cfg_net_rf_off_time_cmd);
 	install_element(BSC_NODE, &cfg_net_no_rf_off_time_cmd);
+	install_element(BSC_NODE, &cfg_net_bsc_msc_selection_cmd);
 	install_element(BSC_NODE, &cfg_net_bsc_missing_msc_ussd_cmd);
 	install_element(BSC_NODE, &cfg_net_bsc_no_missing_msc_text_cmd);
 
@@ -851,6 +889,7 @@ int bsc_vty_init_extra(void)
 	install_element(MSC_NODE, &cfg_msc_mgw_x_osmo_ign_cmd);
 	install_element(MSC_NODE, &cfg_msc_no_mgw_x_osmo_ign_cmd);
 	install_element(MSC_NODE, &cfg_msc_osmux_cmd);
+	install_element(MSC_NODE, &cfg_msc_selection_weight_cmd);
 
 	return 0;
 }
@@ -40,6 +40,7 @@
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/tdef.h>
+#include <osmocom/core/timer_compat.h>
 #include <osmocom/gsm/gsm48.h>
 #include <osmocom/gsm/gsm0502.h>
 
@@ -56,7 +57,24 @@
 
 void *tall_paging_ctx = NULL;
 
-#define PAGING_TIMER 0, 500000
+#define PAGING_TIMER_us 500000
+#define PAGING_TIMER 0, PAGING_TIMER_us
+
+#define GSM_FRAME_DURATION_us	4615
+#define GSM51_MFRAME_DURATION_us (51 * GSM_FRAME_DURATION_us) /* 235365 us */
+
+/* A Paging Request Type 1 fits up to two Mobile Identities into one paging block */
+#define PAGING_MI_PER_BLOCK 2
+
+/* 3GPP TS 45.002 6.5.2: at most 9 paging blocks per 51-multiframe (non-combined CCCH, BS_AG_BLKS_RES = 0)
+ * and BS_PA_MFRMS up to 9, so there are never more than 81 paging groups on a BTS. */
+#define MAX_PAGING_GROUPS (9 * 9)
+
+/* Paging a whole LAC allocates and frees one gsm_paging_request per BTS. Instead of going through talloc
+ * each time, keep up to this many freed requests around for reuse. */
+#define PAGING_REQ_POOL_MAX 1024
+static LLIST_HEAD(paging_req_pool);
+static unsigned int paging_req_pool_len;
 
 /*
  * TODO MSCSPLIT: the paging in libbsc is closely tied to MSC land in that the
@@ -64,23 +82,64 @@ void *tall_paging_ctx = NULL;
  * this entire file needs to be rewired for use with an A interface.
  */
 
+static struct gsm_paging_request *paging_req_alloc(void)
+{
+	struct gsm_paging_request *req;
+
+	if (llist_empty(&paging_req_pool))
+		return talloc_zero(tall_paging_ctx, struct gsm_paging_request);
+
+	req = llist_first_entry(&paging_req_pool, struct gsm_paging_request, entry);
+	llist_del(&req->entry);
+	paging_req_pool_len--;
+	memset(req, 0, sizeof(*req));
+	return req;
+}
+
+static void paging_req_free(struct gsm_paging_request *req)
+{
+	if (paging_req_pool_len >= PAGING_REQ_POOL_MAX) {
+		talloc_free(req);
+		return;
+	}
+	llist_add(&req->entry, &paging_req_pool);
+	paging_req_pool_len++;
+}
+
 /*
  * Kill one paging request update the internal list...
  */
 static void paging_remove_request(struct gsm_bts_paging_state *paging_bts,
 				  struct gsm_paging_request *to_be_deleted)
 {
-	osmo_timer_del(&to_be_deleted->T3113);
+	llist_del(&to_be_deleted->T3113_entry);
+	if (llist_empty(&paging_bts->T3113_queue))
+		osmo_timer_del(&paging_bts->T3113_timer);
 	llist_del(&to_be_deleted->entry);
+	hash_del(&to_be_deleted->hentry);
+	llist_del(&to_be_deleted->bsub_entry);
+	paging_bts->pending_requests_len--;
+	osmo_stat_item_set(paging_bts->bts->bts_statg->items[BTS_STAT_PAGING_REQ_QUEUE_LENGTH],
+			   paging_bts->pending_requests_len);
 	bsc_subscr_put(to_be_deleted->bsub);
-	talloc_free(to_be_deleted);
+	paging_req_free(to_be_deleted);
+}
+
+/* Record how long \a request waited in the queue before it was paged for the first time */
+static void paging_update_first_tx_delay(struct gsm_paging_request *request)
+{
+	struct timespec now, age;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	timespecsub(&now, &request->enqueue_time, &age);
+	osmo_stat_item_set(request->bts->bts_statg->items[BTS_STAT_PAGING_FIRST_TX_DELAY],
+			   age.tv_sec * 1000 + age.tv_nsec / 1000000);
 }
 
 static void page_ms(struct gsm_paging_request *request)
 {
 	uint8_t mi[128];
 	unsigned int mi_len;
-	unsigned int page_group;
 	struct gsm_bts *bts = request->bts;
 
 	log_set_context(LOG_CTX_BSC_SUBSCR, request->bsub);
@@ -94,12 +153,33 @@ static void page_ms(struct gsm_paging_request *request)
 	else
 		mi_len = gsm48_generate_mid_from_tmsi(mi, request->bsub->tmsi);
 
-	page_group = gsm0502_calc_paging_group(&bts->si_common.chan_desc,
-					       str_to_imsi(request->bsub->imsi));
-	rsl_paging_cmd(bts, page_group, mi_len, mi, request->chan_type, false);
+	rsl_paging_cmd(bts, request->pgroup, mi_len, mi, request->chan_type, false);
+	rate_ctr_inc(&bts->bts_ctrs->ctr[BTS_CTR_PAGING_SENT]);
+	if (request->attempts == 0)
+		paging_update_first_tx_delay(request);
 	log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
 }
 
+/*! Estimate how many Mobile Identities the PCH of \a bts can carry during one PAGING_TIMER interval,
+ *  derived from the CCCH configuration in the Control Channel Description. */
+static unsigned int paging_ccch_capacity_per_tick(struct gsm_bts *bts)
+{
+	unsigned int n_pag_blocks = gsm0502_get_n_pag_blocks(&bts->si_common.chan_desc);
+	unsigned int n_blocks = n_pag_blocks * PAGING_TIMER_us / GSM51_MFRAME_DURATION_us;
+
+	return OSMO_MAX(n_blocks, 1) * PAGING_MI_PER_BLOCK;
+}
+
+/*! Estimate how many Mobile Identities fit into the paging blocks of one single paging group during one
+ *  PAGING_TIMER interval. A paging group recurs every BS_PA_MFRMS 51-multiframes. */
+static unsigned int paging_group_capacity_per_tick(struct gsm_bts *bts)
+{
+	unsigned int mfrms_us = (bts->si_common.chan_desc.bs_pa_mfrms + 2) * GSM51_MFRAME_DURATION_us;
+	unsigned int occurrences = (PAGING_TIMER_us + mfrms_us - 1) / mfrms_us;
+
+	return occurrences * PAGING_MI_PER_BLOCK;
+}
+
 static void paging_schedule_if_needed(struct gsm_bts_paging_state *paging_bts)
 {
 	if (llist_empty(&paging_bts->pending_requests))
@@ -120,18 +200,15 @@ static void paging_give_credit(void *data)
 	paging_handle_pending_requests(paging_bts);
 }
 
-/*! count the number of free channels for given RSL channel type required
+/*! check whether enough channels are free for given RSL channel type required
  * \param[in] BTS on which we shall count
+ * \param[in] pl channel load of \a bts, as obtained from bts_chan_load()
  * \param[in] rsl_type the RSL channel needed type
- * \returns number of free channels matching \a rsl_type in \a bts */
-static int can_send_pag_req(struct gsm_bts *bts, int rsl_type)
+ * \returns nonzero if fewer than free_chans_need channels matching \a rsl_type are free in \a bts */
+static int can_send_pag_req(struct gsm_bts *bts, const struct pchan_load *pl, int rsl_type)
 {
-	struct pchan_load pl;
 	int count;
 
-	memset(&pl, 0, sizeof(pl));
-	bts_chan_load(&pl, bts);
-
 	switch (rsl_type) {
 	case RSL_CHANNEED_TCH_F:
 	case RSL_CHANNEED_TCH_ForH:
@@ -154,19 +231,19 @@ static int can_send_pag_req(struct gsm_bts *bts, int rsl_type)
 	/* could available SDCCH */
 count_sdcch:
 	count = 0;
-	count += pl.pchan[GSM_PCHAN_SDCCH8_SACCH8C].total
-			- pl.pchan[GSM_PCHAN_SDCCH8_SACCH8C].used;
-	count += pl.pchan[GSM_PCHAN_CCCH_SDCCH4].total
-			- pl.pchan[GSM_PCHAN_CCCH_SDCCH4].used;
+	count += pl->pchan[GSM_PCHAN_SDCCH8_SACCH8C].total
+			- pl->pchan[GSM_PCHAN_SDCCH8_SACCH8C].used;
+	count += pl->pchan[GSM_PCHAN_CCCH_SDCCH4].total
+			- pl->pchan[GSM_PCHAN_CCCH_SDCCH4].used;
 	return bts->paging.free_chans_need > count;
 
 count_tch:
 	count = 0;
-	count += pl.pchan[GSM_PCHAN_TCH_F].total
-			- pl.pchan[GSM_PCHAN_TCH_F].used;
+	count += pl->pchan[GSM_PCHAN_TCH_F].total
+			- pl->pchan[GSM_PCHAN_TCH_F].used;
 	if (bts->network->neci)
-		count += pl.pchan[GSM_PCHAN_TCH_H].total
-				- pl.pchan[GSM_PCHAN_TCH_H].used;
+		count += pl->pchan[GSM_PCHAN_TCH_H].total
+				- pl->pchan[GSM_PCHAN_TCH_H].used;
 	return bts->paging.free_chans_need > count;
 }
 
@@ -174,12 +251,19 @@ count_tch:
  * This is kicked by the periodic PAGING LOAD Indicator
  * coming from abis_rsl.c
  *
- * We attempt to iterate once over the list of items but
- * only upto available_slots.
+ * We attempt to iterate once over the list of items, sending
+ * as many PAGING CMDs as the BTS has available_slots for and
+ * as the PCH can carry until the next tick. Requests are spread
+ * over the paging groups so that no single group gets more than
+ * its paging blocks can transmit in the meantime.
  */
 static void paging_handle_pending_requests(struct gsm_bts_paging_state *paging_bts)
 {
-	struct gsm_paging_request *request = NULL;
+	struct gsm_bts *bts = paging_bts->bts;
+	struct gsm_paging_request *request, *request2;
+	uint8_t pgroup_sent[MAX_PAGING_GROUPS] = {};
+	struct pchan_load pl;
+	unsigned int budget, pgroup_cap, to_visit;
 
 	/*
 	 * Determine if the pending_requests list is empty and
@@ -203,27 +287,47 @@ static void paging_handle_pending_requests(struct gsm_bts_paging_state *paging_b
 		return;
 	}
 
-	request = llist_entry(paging_bts->pending_requests.next,
-			      struct gsm_paging_request, entry);
+	/* Skip paging if the bts is down. */
+	if (!bts->oml_link)
+		goto skip_paging;
 
 	/* we need to determine the number of free channels */
-	if (paging_bts->free_chans_need != -1) {
-		if (can_send_pag_req(request->bts, request->chan_type) != 0)
-			goto skip_paging;
-	}
+	memset(&pl, 0, sizeof(pl));
+	if (paging_bts->free_chans_need != -1)
+		bts_chan_load(&pl, bts);
+
+	budget = OSMO_MIN(paging_bts->available_slots, paging_ccch_capacity_per_tick(bts));
+	pgroup_cap = paging_group_capacity_per_tick(bts);
+
+	/* Each request is visited at most once per tick. Paged requests move to the back of the queue, so
+	 * that the loop ends after having seen every request that was pending when it started. Requests
+	 * that are skipped keep their place and get served first on the next tick. */
+	to_visit = paging_bts->pending_requests_len;
+	llist_for_each_entry_safe(request, request2, &paging_bts->pending_requests, entry) {
+		if (!budget || !to_visit--)
+			break;
+
+		if (paging_bts->free_chans_need != -1
+		    && can_send_pag_req(bts, &pl, request->chan_type) != 0)
+			continue;
 
-	/* Skip paging if the bts is down. */
-	if (!request->bts->oml_link)
-		goto skip_paging;
+		/* this paging group's blocks are already full until the next tick */
+		if (request->pgroup < MAX_PAGING_GROUPS) {
+			if (pgroup_sent[request->pgroup] >= pgroup_cap)
+				continue;
+			pgroup_sent[request->pgroup]++;
+		}
 
-	/* handle the paging request now */
-	page_ms(request);
-	paging_bts->available_slots--;
-	request->attempts++;
+		/* handle the paging request now */
+		page_ms(request);
+		paging_bts->available_slots--;
+		budget--;
+		request->attempts++;
 
-	/* take the current and add it to the back */
-	llist_del(&request->entry);
-	llist_add_tail(&request->entry, &paging_bts->pending_requests);
+		/* take the current and add it to the back */
+		llist_del(&request->entry);
+		llist_add_tail(&request->entry, &paging_bts->pending_requests);
+	}
 
 skip_paging:
 	osmo_timer_schedule(&paging_bts->work_timer, PAGING_TIMER);
@@ -236,6 +340,8 @@ static void paging_worker(void *data)
 	paging_handle_pending_requests(paging_bts);
 }
 
+static void paging_T3113_expired(void *data);
+
 /*! initialize the bts paging state, if it hasn't been initialized yet */
 static void paging_init_if_needed(struct gsm_bts *bts)
 {
@@ -250,46 +356,101 @@ static void paging_init_if_needed(struct gsm_bts *bts)
 
 	osmo_timer_setup(&bts->paging.work_timer, paging_worker,
 			 &bts->paging);
+	osmo_timer_setup(&bts->paging.T3113_timer, paging_T3113_expired,
+			 &bts->paging);
 
 	/* Large number, until we get a proper message */
 	bts->paging.available_slots = 20;
 }
 
-/*! do we have any pending paging requests for given subscriber? */
-static int paging_pending_request(struct gsm_bts_paging_state *bts,
-				  struct bsc_subscr *bsub)
+/*! find the pending paging request for given subscriber, if any */
+static struct gsm_paging_request *paging_pending_request(struct gsm_bts_paging_state *bts,
+							 struct bsc_subscr *bsub)
 {
 	struct gsm_paging_request *req;
 
-	llist_for_each_entry(req, &bts->pending_requests, entry) {
+	hash_for_each_possible(bts->pending_requests_by_bsub, req, hentry, (uintptr_t)bsub) {
 		if (bsub == req->bsub)
-			return 1;
+			return req;
 	}
 
-	return 0;
+	return NULL;
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/*! Arm the BTS's T3113 timer for the request that expires first */
+static void paging_T3113_schedule(struct gsm_bts_paging_state *paging_bts)
+{
+	struct gsm_paging_request *req;
+	struct timespec now, remaining = {};
+
+	if (llist_empty(&paging_bts->T3113_queue)) {
+		osmo_timer_del(&paging_bts->T3113_timer);
+		return;
+	}
+
+	req = llist_first_entry(&paging_bts->T3113_queue, struct gsm_paging_request, T3113_entry);
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	if (timespec_before(&now, &req->T3113_expiry))
+		timespecsub(&req->T3113_expiry, &now, &remaining);
+	osmo_timer_schedule(&paging_bts->T3113_timer, remaining.tv_sec, (remaining.tv_nsec + 999) / 1000);
 }
 
-/*! Call-back once T3113 (paging timeout) expires for given paging_request */
+/*! Queue \a req by T3113 expiry. All requests on a BTS use the same T3113 unless it is reconfigured, so
+ * the new request normally goes to the tail, and the timer only needs arming if it became the head. */
+static void paging_T3113_start(struct gsm_bts_paging_state *paging_bts, struct gsm_paging_request *req,
+			       unsigned int timeout_s)
+{
+	struct gsm_paging_request *pos;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &req->T3113_expiry);
+	req->T3113_expiry.tv_sec += timeout_s;
+
+	llist_for_each_entry_reverse(pos, &paging_bts->T3113_queue, T3113_entry) {
+		if (!timespec_before(&req->T3113_expiry, &pos->T3113_expiry))
+			break;
+	}
+	/* pos is now the last request expiring no later than req, or the list head itself */
+	llist_add(&req->T3113_entry, &pos->T3113_entry);
+
+	if (paging_bts->T3113_queue.next == &req->T3113_entry)
+		paging_T3113_schedule(paging_bts);
+}
+
+/*! Call-back once T3113 (paging timeout) expires for the first paging_request(s) of a BTS */
 static void paging_T3113_expired(void *data)
 {
-	struct gsm_paging_request *req = (struct gsm_paging_request *)data;
+	struct gsm_bts_paging_state *paging_bts = data;
+	struct gsm_paging_request *req, *req2;
+	struct timespec now;
 
-	log_set_context(LOG_CTX_BSC_SUBSCR, req->bsub);
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
 
-	LOGP(DPAG, LOGL_INFO, "T3113 expired for request %p (%s)\n",
-	     req, bsc_subscr_name(req->bsub));
+	llist_for_each_entry_safe(req, req2, &paging_bts->T3113_queue, T3113_entry) {
+		if (timespec_before(&now, &req->T3113_expiry))
+			break;
 
-	/* must be destroyed before calling cbfn, to prevent double free */
-	rate_ctr_inc(&req->bts->bts_ctrs->ctr[BTS_CTR_PAGING_EXPIRED]);
+		log_set_context(LOG_CTX_BSC_SUBSCR, req->bsub);
 
-	/* destroy it now. Do not access req afterwards */
-	paging_remove_request(&req->bts->paging, req);
+		LOGP(DPAG, LOGL_INFO, "T3113 expired for request %p (%s)\n",
+		     req, bsc_subscr_name(req->bsub));
 
-	log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
+		/* must be destroyed before calling cbfn, to prevent double free */
+		rate_ctr_inc(&req->bts->bts_ctrs->ctr[BTS_CTR_PAGING_EXPIRED]);
+
+		/* destroy it now. Do not access req afterwards */
+		paging_remove_request(paging_bts, req);
+
+		log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
+	}
+
+	paging_T3113_schedule(paging_bts);
 }
 
-#define GSM_FRAME_DURATION_us	4615
-#define GSM51_MFRAME_DURATION_us (51 * GSM_FRAME_DURATION_us) /* 235365 us */
 static unsigned int calculate_timer_3113(struct gsm_bts *bts)
 {
 	unsigned int to_us, to;
@@ -341,16 +502,22 @@ static int _paging_request(struct gsm_bts *bts, struct bsc_subscr *bsub, int typ
 	}
 
 	LOG_BTS(bts, DPAG, LOGL_DEBUG, "Start paging of subscriber %s\n", bsc_subscr_name(bsub));
-	req = talloc_zero(tall_paging_ctx, struct gsm_paging_request);
+	req = paging_req_alloc();
 	OSMO_ASSERT(req);
 	req->bsub = bsc_subscr_get(bsub);
 	req->bts = bts;
 	req->chan_type = type;
 	req->msc = msc;
-	osmo_timer_setup(&req->T3113, paging_T3113_expired, req);
+	req->pgroup = gsm0502_calc_paging_group(&bts->si_common.chan_desc, str_to_imsi(bsub->imsi));
+	osmo_clock_gettime(CLOCK_MONOTONIC, &req->enqueue_time);
 	t3113_timeout_s = calculate_timer_3113(bts);
-	osmo_timer_schedule(&req->T3113, t3113_timeout_s, 0);
+	paging_T3113_start(bts_entry, req, t3113_timeout_s);
 	llist_add_tail(&req->entry, &bts_entry->pending_requests);
+	hash_add(bts_entry->pending_requests_by_bsub, &req->hentry, (uintptr_t)bsub);
+	llist_add_tail(&req->bsub_entry, &bsub->active_paging_requests);
+	bts_entry->pending_requests_len++;
+	osmo_stat_item_set(bts->bts_statg->items[BTS_STAT_PAGING_REQ_QUEUE_LENGTH],
+			   bts_entry->pending_requests_len);
 	paging_schedule_if_needed(bts_entry);
 
 	return 0;
@@ -395,25 +562,22 @@ static int _paging_request_stop(struct gsm_bts *bts, struct bsc_subscr *bsub,
 				struct msgb *msg)
 {
 	struct gsm_bts_paging_state *bts_entry = &bts->paging;
-	struct gsm_paging_request *req, *req2;
+	struct gsm_paging_request *req;
 
 	paging_init_if_needed(bts);
 
-	llist_for_each_entry_safe(req, req2, &bts_entry->pending_requests,
-				  entry) {
-		if (req->bsub == bsub) {
-			/* now give up the data structure */
-			paging_remove_request(&bts->paging, req);
-			LOG_BTS(bts, DPAG, LOGL_DEBUG, "Stop paging %s\n", bsc_subscr_name(bsub));
-			return 0;
-		}
-	}
+	req = paging_pending_request(bts_entry, bsub);
+	if (!req)
+		return -ENOENT;
 
-	return -ENOENT;
+	/* now give up the data structure */
+	paging_remove_request(bts_entry, req);
+	LOG_BTS(bts, DPAG, LOGL_DEBUG, "Stop paging %s\n", bsc_subscr_name(bsub));
+	return 0;
 }
 
 /*! Stop paging on all other bts'
- * \param[in] bts_list list of BTSs to iterate
+ * \param[in] bts_list list of BTSs to iterate (unused, only the BTSs that \a bsub is being paged on are visited)
  * \param[in] _bts BTS which has received a paging response
  * \param[in] bsub subscriber
  * \param[in] msgb L3 message that we have received from \a bsub on \a _bts */
@@ -422,7 +586,7 @@ void paging_request_stop(struct llist_head *bts_list,
 			 struct gsm_subscriber_connection *conn,
 			 struct msgb *msg)
 {
-	struct gsm_bts *bts;
+	struct gsm_paging_request *req, *req2;
 
 	log_set_context(LOG_CTX_BSC_SUBSCR, bsub);
 	conn->bsub = bsc_subscr_get(bsub);
@@ -436,12 +600,11 @@ void paging_request_stop(struct llist_head *bts_list,
 		}
 	}
 
-	/* Make sure to cancel this everywhere else */
-	llist_for_each_entry(bts, bts_list, list) {
-		/* Sort of an optimization. */
-		if (bts == _bts)
-			continue;
-		_paging_request_stop(bts, bsub, NULL, NULL);
+	/* Make sure to cancel this everywhere else. conn holds a reference on bsub, so removing the last
+	 * request does not free bsub while iterating. */
+	llist_for_each_entry_safe(req, req2, &bsub->active_paging_requests, bsub_entry) {
+		LOG_BTS(req->bts, DPAG, LOGL_DEBUG, "Stop paging %s\n", bsc_subscr_name(bsub));
+		paging_remove_request(&req->bts->paging, req);
 	}
 	log_set_context(LOG_CTX_BSC_SUBSCR, NULL);
 }
@@ -460,15 +623,9 @@ void paging_update_buffer_space(struct gsm_bts *bts, uint16_t free_slots)
 /*! Count the number of pending paging requests on given BTS */
 unsigned int paging_pending_requests_nr(struct gsm_bts *bts)
 {
-	unsigned int requests = 0;
-	struct gsm_paging_request *req;
-
 	paging_init_if_needed(bts);
 
-	llist_for_each_entry(req, &bts->paging.pending_requests, entry)
-		++requests;
-
-	return requests;
+	return bts->paging.pending_requests_len;
 }
 
 /*! Find any paging data for the given subscriber at the given BTS. */
@@ -476,11 +633,8 @@ struct bsc_msc_data *paging_get_msc(struct gsm_bts *bts, struct bsc_subscr *bsub
 {
 	struct gsm_paging_request *req;
 
-	llist_for_each_entry(req, &bts->paging.pending_requests, entry)
-		if (req->bsub == bsub)
-			return req->msc;
-
-	return NULL;
+	req = paging_pending_request(&bts->paging, bsub);
+	return req ? req->msc : NULL;
 }
 
 /*! Flush all paging requests at a given BTS for a given MSC (or NULL if all MSC should be flushed). */
@@ -44,6 +44,7 @@
 #include <osmocom/bsc/debug.h>
 #include <osmocom/bsc/abis_rsl.h>
 #include <osmocom/bsc/gsm_04_08_rr.h>
+#include <osmocom/bsc/latency_prof.h>
 
 static int pcu_sock_send(struct gsm_bts *bts, struct msgb *msg);
 uint32_t trx_get_hlayer1(struct gsm_bts_trx *trx);
@@ -511,7 +512,9 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 {
 	struct pcu_sock_state *state = (struct pcu_sock_state *)bfd->data;
 	struct gsm_pcu_if *pcu_prim;
+	struct timespec start;
 	struct msgb *msg;
+	uint8_t msg_type;
 	int rc;
 
 	msg = msgb_alloc(sizeof(*pcu_prim), "pcu_sock_rx");
@@ -530,7 +533,10 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 		goto close;
 	}
 
-	rc = pcu_rx(state->net, pcu_prim->msg_type, pcu_prim);
+	msg_type = pcu_prim->msg_type;
+	latency_prof_start(&start);
+	rc = pcu_rx(state->net, msg_type, pcu_prim);
+	latency_prof_stop(LATENCY_PROF_PCU, msg_type, &start);
 
 	/* as we always synchronously process the message in pcu_rx() and
 	 * its callbacks, we can free the message here. */
@@ -24,12 +24,20 @@
 #include <stdint.h>
 
 #include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
 
 #include <osmocom/bsc/penalty_timers.h>
+#include <osmocom/bsc/hashtable.h>
 #include <osmocom/bsc/gsm_data.h>
 
+/* Sweep out expired timers when the number of timers has doubled since the last sweep */
+#define PENALTY_TIMERS_SWEEP_MIN 8
+
 struct penalty_timers {
-	struct llist_head timers;
+	/* struct penalty_timer by for_object, at most one per object */
+	DECLARE_HASHTABLE(by_object, 4);
+	unsigned int count;
+	unsigned int sweep_at;
 };
 
 struct penalty_timer {
@@ -40,10 +48,43 @@ struct penalty_timer {
 
 static unsigned int time_now(void)
 {
-	time_t now;
-	time(&now);
-	/* FIXME: use monotonic clock */
-	return (unsigned int)now;
+	struct timespec now;
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned int)now.tv_sec;
+}
+
+static void penalty_timer_del(struct penalty_timers *pt, struct penalty_timer *timer)
+{
+	hash_del(&timer->entry);
+	talloc_free(timer);
+	pt->count--;
+}
+
+static struct penalty_timer *penalty_timer_find(struct penalty_timers *pt, const void *for_object)
+{
+	struct penalty_timer *timer;
+	hash_for_each_possible(pt->by_object, timer, entry, (uintptr_t)for_object) {
+		if (timer->for_object == for_object)
+			return timer;
+	}
+	return NULL;
+}
+
+/* Expired timers are normally removed when looked up. Those for objects that are never looked up again
+ * would pile up, so once in a while drop all expired timers. */
+static void penalty_timers_sweep(struct penalty_timers *pt, unsigned int now)
+{
+	struct penalty_timer *timer, *timer2;
+	unsigned int bkt;
+
+	for (bkt = 0; bkt < HASH_SIZE(pt->by_object); bkt++) {
+		llist_for_each_entry_safe(timer, timer2, &pt->by_object[bkt], entry) {
+			if (now >= timer->timeout)
+				penalty_timer_del(pt, timer);
+		}
+	}
+
+	pt->sweep_at = OSMO_MAX(2 * pt->count, PENALTY_TIMERS_SWEEP_MIN);
 }
 
 struct penalty_timers *penalty_timers_init(void *ctx)
@@ -51,7 +92,8 @@ struct penalty_timers *penalty_timers_init(void *ctx)
 	struct penalty_timers *pt = talloc_zero(ctx, struct penalty_timers);
 	if (!pt)
 		return NULL;
-	INIT_LLIST_HEAD(&pt->timers);
+	hash_init(pt->by_object);
+	pt->sweep_at = PENALTY_TIMERS_SWEEP_MIN;
 	return pt;
 }
 
@@ -68,9 +110,8 @@ void penalty_timers_add(struct penalty_timers *pt, const void *for_object, int t
 	then = now + timeout;
 
 	/* timer already running for that BTS? */
-	llist_for_each_entry(timer, &pt->timers, entry) {
-		if (timer->for_object != for_object)
-			continue;
+	timer = penalty_timer_find(pt, for_object);
+	if (timer) {
 		/* raise, if running timer will timeout earlier or has timed
 		 * out already, otherwise keep later timeout */
 		if (timer->timeout < then)
@@ -78,6 +119,9 @@ void penalty_timers_add(struct penalty_timers *pt, const void *for_object, int t
 		return;
 	}
 
+	if (pt->count >= pt->sweep_at)
+		penalty_timers_sweep(pt, now);
+
 	/* add new timer */
 	timer = talloc_zero(pt, struct penalty_timer);
 	if (!timer)
@@ -86,35 +130,41 @@ void penalty_timers_add(struct penalty_timers *pt, const void *for_object, int t
 	timer->for_object = for_object;
 	timer->timeout = then;
 
-	llist_add_tail(&timer->entry, &pt->timers);
+	hash_add(pt->by_object, &timer->entry, (uintptr_t)for_object);
+	pt->count++;
 }
 
 unsigned int penalty_timers_remaining(struct penalty_timers *pt, const void *for_object)
 {
-	struct penalty_timer *timer;
-	unsigned int now = time_now();
-	unsigned int max_remaining = 0;
-	llist_for_each_entry(timer, &pt->timers, entry) {
-		unsigned int remaining;
-		if (timer->for_object != for_object)
-			continue;
-		if (now >= timer->timeout)
-			continue;
-		remaining = timer->timeout - now;
-		if (remaining > max_remaining)
-			max_remaining = remaining;
+	struct penalty_timer *timer = penalty_timer_find(pt, for_object);
+	unsigned int now;
+
+	if (!timer)
+		return 0;
+
+	now = time_now();
+	if (now >= timer->timeout) {
+		penalty_timer_del(pt, timer);
+		return 0;
 	}
-	return max_remaining;
+	return timer->timeout - now;
 }
 
 void penalty_timers_clear(struct penalty_timers *pt, const void *for_object)
 {
 	struct penalty_timer *timer, *timer2;
-	llist_for_each_entry_safe(timer, timer2, &pt->timers, entry) {
-		if (for_object && timer->for_object != for_object)
-			continue;
-		llist_del(&timer->entry);
-		talloc_free(timer);
+	unsigned int bkt;
+
+	if (for_object) {
+		timer = penalty_timer_find(pt, for_object);
+		if (timer)
+			penalty_timer_del(pt, timer);
+		return;
+	}
+
+	for (bkt = 0; bkt < HASH_SIZE(pt->by_object); bkt++) {
+		llist_for_each_entry_safe(timer, timer2, &pt->by_object[bkt], entry)
+			penalty_timer_del(pt, timer);
 	}
 }
 
@@ -0,0 +1,75 @@
+/* Index of subscriber connections by their SCCP connection id, and allocation of free ids. */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmocom/core/linuxlist.h>
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/hashtable.h>
+#include <osmocom/bsc/sccp_conn_id.h>
+
+void sccp_conn_id_init(struct gsm_network *net)
+{
+	hash_init(net->sccp_conn_ids.by_id);
+	net->sccp_conn_ids.last_picked = 0;
+}
+
+struct gsm_subscriber_connection *sccp_conn_id_find(struct gsm_network *net, int conn_id)
+{
+	struct gsm_subscriber_connection *conn;
+	uint32_t key = conn_id & SCCP_CONN_ID_MASK;
+
+	hash_for_each_possible(net->sccp_conn_ids.by_id, conn, sccp.conn_id_entry, key) {
+		if ((conn->sccp.conn_id & SCCP_CONN_ID_MASK) == key)
+			return conn;
+	}
+	return NULL;
+}
+
+int sccp_conn_id_pick_free(struct gsm_network *net)
+{
+	uint32_t conn_id = net->sccp_conn_ids.last_picked;
+	uint32_t i;
+
+	/* With the index, each probe is O(1); since ids are handed out cyclically and only a tiny fraction
+	 * of the 24 bit space is in use at any time, the first probe practically always succeeds. */
+	for (i = 0; i < SCCP_CONN_ID_MASK; i++) {
+		conn_id = (conn_id + 1) & SCCP_CONN_ID_MASK;
+		if (!sccp_conn_id_find(net, conn_id)) {
+			net->sccp_conn_ids.last_picked = conn_id;
+			return conn_id;
+		}
+	}
+
+	return -1;
+}
+
+void sccp_conn_id_set(struct gsm_network *net, struct gsm_subscriber_connection *conn, int conn_id)
+{
+	sccp_conn_id_clear(conn);
+	conn->sccp.conn_id = conn_id;
+	if (conn_id < 0)
+		return;
+	hash_add(net->sccp_conn_ids.by_id, &conn->sccp.conn_id_entry, (uint32_t)(conn_id & SCCP_CONN_ID_MASK));
+}
+
+void sccp_conn_id_clear(struct gsm_subscriber_connection *conn)
+{
+	hash_del(&conn->sccp.conn_id_entry);
+	conn->sccp.conn_id = -1;
+}
@@ -722,8 +722,7 @@ static int generate_si1(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 	list_arfcn(si1->cell_channel_description, 0xce, "Serving cell:");
 
 	si1->rach_control = bts->si_common.rach_control;
-	if (acc_ramp_is_enabled(&bts->acc_ramp))
-		acc_ramp_apply(&si1->rach_control, &bts->acc_ramp);
+	acc_ramp_apply(&si1->rach_control, &bts->acc_ramp);
 
 	/*
 	 * SI1 Rest Octets (10.5.2.32), contains NCH position and band
@@ -754,8 +753,7 @@ static int generate_si2(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 
 	si2->ncc_permitted = bts->si_common.ncc_permitted;
 	si2->rach_control = bts->si_common.rach_control;
-	if (acc_ramp_is_enabled(&bts->acc_ramp))
-		acc_ramp_apply(&si2->rach_control, &bts->acc_ramp);
+	acc_ramp_apply(&si2->rach_control, &bts->acc_ramp);
 
 	return sizeof(*si2);
 }
@@ -789,8 +787,7 @@ static int generate_si2bis(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 		bts->si_valid &= ~(1 << SYSINFO_TYPE_2bis);
 
 	si2b->rach_control = bts->si_common.rach_control;
-	if (acc_ramp_is_enabled(&bts->acc_ramp))
-		acc_ramp_apply(&si2b->rach_control, &bts->acc_ramp);
+	acc_ramp_apply(&si2b->rach_control, &bts->acc_ramp);
 
 	/* SI2bis Rest Octets as per 3GPP TS 44.018 §10.5.2.33 */
 	rc = rest_octets_si2bis(si2b->rest_octets);
@@ -911,8 +908,7 @@ static int generate_si3(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 	si3->cell_options = bts->si_common.cell_options;
 	si3->cell_sel_par = bts->si_common.cell_sel_par;
 	si3->rach_control = bts->si_common.rach_control;
-	if (acc_ramp_is_enabled(&bts->acc_ramp))
-		acc_ramp_apply(&si3->rach_control, &bts->acc_ramp);
+	acc_ramp_apply(&si3->rach_control, &bts->acc_ramp);
 
 	/* allow/disallow DTXu */
 	gsm48_set_dtx(&si3->cell_options, bts->dtxu, bts->dtxu, true);
@@ -961,8 +957,7 @@ static int generate_si4(enum osmo_sysinfo_type t, struct gsm_bts *bts)
 	gsm48_generate_lai2(&si4->lai, bts_lai(bts));
 	si4->cell_sel_par = bts->si_common.cell_sel_par;
 	si4->rach_control = bts->si_common.rach_control;
-	if (acc_ramp_is_enabled(&bts->acc_ramp))
-		acc_ramp_apply(&si4->rach_control, &bts->acc_ramp);
+	acc_ramp_apply(&si4->rach_control, &bts->acc_ramp);
 
 	/* Optional: CBCH Channel Description + CBCH Mobile Allocation */
 	cbch_lchan = gsm_bts_get_cbch(bts);
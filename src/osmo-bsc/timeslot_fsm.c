@@ -22,6 +22,8 @@
 
 #include <osmocom/core/logging.h>
 
+#include <osmocom/core/timer.h>
+
 #include <osmocom/bsc/debug.h>
 
 #include <osmocom/bsc/timeslot_fsm.h>
@@ -214,6 +216,8 @@ static void ts_setup_lchans(struct gsm_bts_trx_ts *ts)
 		break;
 	}
 
+	ts_avail_update(ts);
+
 	LOG_TS(ts, LOGL_DEBUG, "lchans initialized: %d\n", max_lchans);
 }
 
@@ -263,11 +267,38 @@ static void ts_fsm_not_initialized(struct osmo_fsm_inst *fi, uint32_t event, voi
 	osmo_fsm_inst_state_chg(fi, TS_ST_UNUSED, 0, 0);
 }
 
-static void ts_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+/* An unused dynamic timeslot goes to PDCH, unless GPRS is off, PDCH is disabled or the dyn TS reserve keeps
+ * it ready for TCH. */
+static void ts_fsm_unused_pdch_act(struct osmo_fsm_inst *fi)
 {
 	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
 	struct gsm_bts *bts = ts->trx->bts;
 
+	if (bts->gprs.mode == BTS_GPRS_NONE) {
+		LOG_TS(ts, LOGL_DEBUG, "GPRS mode is 'none': not activating PDCH.\n");
+		return;
+	}
+	if (!ts->pdch_act_allowed) {
+		LOG_TS(ts, LOGL_DEBUG, "PDCH is disabled for this timeslot,"
+		       " either due to a PDCH ACT NACK, or from manual VTY command:"
+		       " not activating PDCH. (last error: %s)\n",
+		       ts->last_errmsg ? : "-");
+		return;
+	}
+	if (dyn_ts_reserve_keep(ts)) {
+		LOG_TS(ts, LOGL_DEBUG, "Reserved for expected TCH demand: not activating PDCH.\n");
+		return;
+	}
+	osmo_fsm_inst_state_chg(fi, TS_ST_WAIT_PDCH_ACT, CHAN_ACT_DEACT_TIMEOUT,
+				T_CHAN_ACT_DEACT);
+}
+
+static void ts_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
+{
+	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
+
+	ts_avail_update(ts);
+
 	/* We are entering the unused state. There must by definition not be any lchans waiting to be
 	 * activated. */
 	if (ts_lchans_waiting(ts)) {
@@ -280,19 +311,7 @@ static void ts_fsm_unused_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 	switch (ts->pchan_on_init) {
 	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
 	case GSM_PCHAN_TCH_F_PDCH:
-		if (bts->gprs.mode == BTS_GPRS_NONE) {
-			LOG_TS(ts, LOGL_DEBUG, "GPRS mode is 'none': not activating PDCH.\n");
-			return;
-		}
-		if (!ts->pdch_act_allowed) {
-			LOG_TS(ts, LOGL_DEBUG, "PDCH is disabled for this timeslot,"
-			       " either due to a PDCH ACT NACK, or from manual VTY command:"
-			       " not activating PDCH. (last error: %s)\n",
-			       ts->last_errmsg ? : "-");
-			return;
-		}
-		osmo_fsm_inst_state_chg(fi, TS_ST_WAIT_PDCH_ACT, CHAN_ACT_DEACT_TIMEOUT,
-					T_CHAN_ACT_DEACT);
+		ts_fsm_unused_pdch_act(fi);
 		break;
 
 	case GSM_PCHAN_CCCH_SDCCH4_CBCH:
@@ -325,6 +344,8 @@ static void ts_fsm_unused(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 				 * we merely need to RSL Chan Activ the new lchan. For ip.access style
 				 * dyn TS this is already TCH/F, and we should never hit this. */
 			case LCHAN_IS_READY_TO_GO:
+				if (ts->tch_reserved)
+					dyn_ts_reserve_hit(ts);
 				osmo_fsm_inst_state_chg(fi, TS_ST_IN_USE, 0, 0);
 				return;
 			default:
@@ -337,6 +358,10 @@ static void ts_fsm_unused(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 		/* ignored. */
 		return;
 
+	case TS_EV_TCH_RESERVE_END:
+		ts_fsm_unused_pdch_act(fi);
+		return;
+
 	default:
 		OSMO_ASSERT(false);
 	}
@@ -424,6 +449,7 @@ static void ts_fsm_pdch_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 			     gsm_pchan_name(ts->pchan_on_init));
 		return;
 	}
+	ts_avail_update(ts);
 
 	/* PDCH use has changed, tell the PCU about it. */
 	pcu_info_update(ts->trx->bts);
@@ -463,6 +489,10 @@ static void ts_fsm_pdch(struct osmo_fsm_inst *fi, uint32_t event, void *data)
 		/* ignored */
 		return;
 
+	case TS_EV_TCH_RESERVE:
+		ts_fsm_pdch_deact(fi);
+		return;
+
 	default:
 		OSMO_ASSERT(false);
 	}
@@ -473,6 +503,7 @@ static void ts_fsm_wait_pdch_deact_onenter(struct osmo_fsm_inst *fi, uint32_t pr
 	int rc;
 	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
 
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts->pdch_deact_start);
 	rc = rsl_tx_dyn_ts_pdch_act_deact(ts, false);
 
 	/* On error, we couldn't send the deactivation message. If we can't send messages, we're broken.
@@ -500,7 +531,13 @@ static void ts_fsm_wait_pdch_deact(struct osmo_fsm_inst *fi, uint32_t event, voi
 				     gsm_pchan_name(ts->pchan_on_init));
 			return;
 		}
-		osmo_fsm_inst_state_chg(fi, TS_ST_IN_USE, 0, 0);
+		dyn_ts_reserve_pdch_deact_done(ts);
+		/* Switched out of PDCH for the dyn TS reserve and not requested in the meantime: wait for
+		 * a TCH request in UNUSED state. */
+		if (ts->tch_reserved && !ts_lchans_waiting(ts))
+			osmo_fsm_inst_state_chg(fi, TS_ST_UNUSED, 0, 0);
+		else
+			osmo_fsm_inst_state_chg(fi, TS_ST_IN_USE, 0, 0);
 		/* IN_USE onenter will signal all waiting lchans. */
 
 		/* PDCH use has changed, tell the PCU about it. */
@@ -550,8 +587,12 @@ static void ts_fsm_in_use_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
 	enum gsm_chan_t activating_type = GSM_LCHAN_NONE;
 
+	ts_avail_update(ts);
+
 	/* After being in use, allow PDCH act again, if appropriate. */
 	ts->pdch_act_allowed = true;
+	/* A TCH request took this timeslot, the dyn TS reserve has to find another one. */
+	ts->tch_reserved = false;
 
 	/* For static TS, check validity. For dyn TS, figure out which PCHAN this should become. */
 	ts_for_each_potential_lchan(lchan, ts) {
@@ -658,6 +699,10 @@ static void ts_fsm_borken_onenter(struct osmo_fsm_inst *fi, uint32_t prev_state)
 {
 	struct gsm_bts_trx_ts *ts = ts_fi_ts(fi);
 	enum bts_counter_id ctr;
+
+	/* all lchans of a BORKEN timeslot count as used */
+	ts_avail_update(ts);
+
 	switch (prev_state) {
 	case TS_ST_NOT_INITIALIZED:
 		ctr = BTS_CTR_TS_BORKEN_FROM_NOT_INITIALIZED;
@@ -762,6 +807,7 @@ static void ts_fsm_allstate(struct osmo_fsm_inst *fi, uint32_t event, void *data
 		ts_terminate_lchan_fsms(ts);
 		ts->pchan_is = ts->pchan_on_init = GSM_PCHAN_NONE;
 		ts_fsm_update_id(ts);
+		ts_avail_update(ts);
 		break;
 
 	case TS_EV_RSL_DOWN:
@@ -770,6 +816,7 @@ static void ts_fsm_allstate(struct osmo_fsm_inst *fi, uint32_t event, void *data
 			osmo_fsm_inst_state_chg(fi, TS_ST_NOT_INITIALIZED, 0, 0);
 		OSMO_ASSERT(fi->state == TS_ST_NOT_INITIALIZED);
 		ts->pchan_is = GSM_PCHAN_NONE;
+		ts_avail_update(ts);
 		ts_lchans_dispatch(ts, -1, LCHAN_EV_TS_ERROR);
 		break;
 
@@ -811,6 +858,7 @@ static const struct osmo_fsm_state ts_fsm_states[] = {
 		.in_event_mask = 0
 			| S(TS_EV_LCHAN_REQUESTED)
 			| S(TS_EV_LCHAN_UNUSED)
+			| S(TS_EV_TCH_RESERVE_END)
 			,
 		.out_state_mask = 0
 			| S(TS_ST_WAIT_PDCH_ACT)
@@ -843,6 +891,7 @@ static const struct osmo_fsm_state ts_fsm_states[] = {
 		.in_event_mask = 0
 			| S(TS_EV_LCHAN_REQUESTED)
 			| S(TS_EV_LCHAN_UNUSED)
+			| S(TS_EV_TCH_RESERVE)
 			,
 		.out_state_mask = 0
 			| S(TS_ST_WAIT_PDCH_DEACT)
@@ -915,6 +964,8 @@ static const struct value_string ts_fsm_event_names[] = {
 	OSMO_VALUE_STRING(TS_EV_PDCH_ACT_NACK),
 	OSMO_VALUE_STRING(TS_EV_PDCH_DEACT_ACK),
 	OSMO_VALUE_STRING(TS_EV_PDCH_DEACT_NACK),
+	OSMO_VALUE_STRING(TS_EV_TCH_RESERVE),
+	OSMO_VALUE_STRING(TS_EV_TCH_RESERVE_END),
 	{}
 };
 
@@ -180,6 +180,19 @@ err_io:
 	return -EIO;
 }
 
+/* Switch to write-ahead logging: a commit then only appends to the WAL file instead of rewriting pages of
+ * the database file, and with synchronous=NORMAL it is only fsync()ed at checkpoints. */
+int meas_db_wal(struct meas_db_state *st)
+{
+	SCK_OK(st->db, sqlite3_exec(st->db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL));
+	SCK_OK(st->db, sqlite3_exec(st->db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL));
+
+	return 0;
+
+err_io:
+	return -EIO;
+}
+
 static const char *create_stmts[] = {
 	"CREATE TABLE IF NOT EXISTS meas_rep ("
 		"id INTEGER PRIMARY KEY AUTOINCREMENT,"
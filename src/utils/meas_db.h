@@ -8,6 +8,7 @@ void meas_db_close(struct meas_db_state *st);
 
 int meas_db_begin(struct meas_db_state *st);
 int meas_db_commit(struct meas_db_state *st);
+int meas_db_wal(struct meas_db_state *st);
 
 int meas_db_insert(struct meas_db_state *st, const char *imsi,
 		   const char *name, unsigned long timestamp,
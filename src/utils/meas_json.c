@@ -35,6 +35,7 @@
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/application.h>
+#include <osmocom/core/utils.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 
@@ -112,6 +113,7 @@ static void print_meas_feed_json(struct meas_feed_meas *mfm)
 		now, mfm->imsi, mfm->name, mfm->scenario);
 
 	switch (mfm->hdr.version) {
+	case MEAS_FEED_VERSION_2:
 	case 1:
 		printf("\"chan_info\":{");
 		print_chan_info_json(mfm);
@@ -137,21 +139,66 @@ static int handle_meas(struct msgb *msg)
 	return 0;
 }
 
+/* Print each record of a MEAS_FEED_VERSION_2 batch like a version 1 report */
+static int handle_meas_batch(struct msgb *msg)
+{
+	struct meas_feed_v2_batch *b = (struct meas_feed_v2_batch *) msgb_data(msg);
+	struct meas_feed_meas mfm = {};
+	const uint8_t *data = b->data;
+	size_t len;
+	int i, rc;
+
+	if (msgb_length(msg) < sizeof(*b))
+		return -EINVAL;
+	len = msgb_length(msg) - sizeof(*b);
+
+	/* decoded records are in host byte order, tell print_meas_feed_json() by the version */
+	mfm.hdr.msg_type = MEAS_FEED_MEAS;
+	mfm.hdr.version = MEAS_FEED_VERSION_2;
+	osmo_strlcpy(mfm.scenario, b->scenario, sizeof(mfm.scenario));
+
+	for (i = 0; i < b->num_meas; i++) {
+		rc = meas_feed_v2_meas_decode(&mfm, data, len);
+		if (rc < 0)
+			return -EINVAL;
+		print_meas_feed_json(&mfm);
+		data += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
 static int handle_msg(struct msgb *msg)
 {
 	struct meas_feed_hdr *mfh = (struct meas_feed_hdr *) msgb_data(msg);
 
-	if (mfh->version != MEAS_FEED_VERSION)
+	if (msgb_length(msg) < sizeof(*mfh))
 		return -EINVAL;
 
-	switch (mfh->msg_type) {
-	case MEAS_FEED_MEAS:
-		handle_meas(msg);
-		break;
-	default:
-		break;
+	if (mfh->version == MEAS_FEED_VERSION) {
+		switch (mfh->msg_type) {
+		case MEAS_FEED_MEAS:
+			handle_meas(msg);
+			break;
+		default:
+			break;
+		}
+		return 0;
 	}
-	return 0;
+
+	if (ntohs(mfh->version) == MEAS_FEED_VERSION_2) {
+		switch (mfh->msg_type) {
+		case MEAS_FEED_MEAS_BATCH:
+			handle_meas_batch(msg);
+			break;
+		default:
+			break;
+		}
+		return 0;
+	}
+
+	return -EINVAL;
 }
 
 static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
@@ -159,7 +206,7 @@ static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
 	int rc;
 
 	if (what & BSC_FD_READ) {
-		struct msgb *msg = msgb_alloc(1024, "UDP Rx");
+		struct msgb *msg = msgb_alloc(2048, "UDP Rx");
 
 		rc = read(ofd->fd, msgb_data(msg), msgb_tailroom(msg));
 		if (rc < 0)
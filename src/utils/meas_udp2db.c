@@ -19,41 +19,192 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <getopt.h>
 #include <time.h>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include <osmocom/core/socket.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 
 #include <osmocom/bsc/meas_feed.h>
 
 #include "meas_db.h"
+#include "../../bscconfig.h"
+
+/* Datagrams to receive per recvmmsg() */
+#define RX_RING_SIZE	64
+/* Large enough for both a version 1 report and a MEAS_FEED_V2_MAX_LEN batch */
+#define RX_BUF_SIZE	2048
 
 static struct osmo_fd udp_ofd;
 static struct meas_db_state *db;
 
-static int handle_msg(struct msgb *msg)
+/* Preallocated receive buffers, refilled by each recvmmsg() */
+static struct {
+	uint8_t buf[RX_RING_SIZE][RX_BUF_SIZE];
+	struct iovec iov[RX_RING_SIZE];
+	char cmsg[RX_RING_SIZE][CMSG_SPACE(sizeof(uint32_t))];
+#ifdef HAVE_RECVMMSG
+	struct mmsghdr mmsg[RX_RING_SIZE];
+#else
+	struct msghdr hdr[RX_RING_SIZE];
+	unsigned int len[RX_RING_SIZE];
+#endif
+} rx_ring;
+
+/* Batching ingest mode: wrap inserts in transactions, committed after commit_count reports or
+ * commit_interval_ms, whichever comes first */
+static struct {
+	bool enabled;
+	unsigned int commit_count;
+	unsigned int commit_interval_ms;
+	bool in_transaction;
+	unsigned int reports;
+	struct osmo_timer_list timer;
+} batch = {
+	.commit_count = 1000,
+	.commit_interval_ms = 1000,
+};
+
+static struct {
+	struct timespec start;
+	unsigned long datagrams;
+	unsigned long reports;
+	unsigned long rejected;
+	unsigned long db_errors;
+	unsigned long commits;
+	/* datagrams the kernel dropped because the socket buffer was full, from SO_RXQ_OVFL */
+	uint32_t kernel_drops;
+} stats;
+
+static volatile sig_atomic_t quit;
+static volatile sig_atomic_t print_stats_requested;
+
+static void print_stats(void)
+{
+	struct timespec now;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = (now.tv_sec - stats.start.tv_sec) + (now.tv_nsec - stats.start.tv_nsec) / 1e9;
+	if (elapsed <= 0)
+		elapsed = 1e-9;
+
+	fprintf(stderr, "%.1f s: %lu datagrams (%.1f/s), %lu reports inserted (%.1f/s), %lu commits, "
+		"dropped: %lu invalid datagrams, %u by the kernel, %lu database errors\n",
+		elapsed, stats.datagrams, stats.datagrams / elapsed, stats.reports, stats.reports / elapsed,
+		stats.commits, stats.rejected, stats.kernel_drops, stats.db_errors);
+}
+
+static void batch_commit(void)
 {
-	struct meas_feed_hdr *mfh = (struct meas_feed_hdr *) msgb_data(msg);
-	struct meas_feed_meas *mfm = (struct meas_feed_meas *) msgb_data(msg);
+	if (!batch.in_transaction)
+		return;
+	if (meas_db_commit(db) < 0)
+		stats.db_errors++;
+	else
+		stats.commits++;
+	batch.in_transaction = false;
+	batch.reports = 0;
+}
+
+static void batch_timer_cb(void *data)
+{
+	batch_commit();
+	osmo_timer_schedule(&batch.timer, batch.commit_interval_ms / 1000,
+			    (batch.commit_interval_ms % 1000) * 1000);
+}
+
+static void insert(const char *imsi, const char *name, time_t now, const char *scenario,
+		   const struct gsm_meas_rep *mr)
+{
+	if (batch.enabled && !batch.in_transaction) {
+		if (meas_db_begin(db) < 0) {
+			stats.db_errors++;
+			return;
+		}
+		batch.in_transaction = true;
+	}
+
+	if (meas_db_insert(db, imsi, name, now, scenario, mr) < 0) {
+		stats.db_errors++;
+		return;
+	}
+	stats.reports++;
+
+	if (batch.enabled && ++batch.reports >= batch.commit_count)
+		batch_commit();
+}
+
+/* Insert each record of a MEAS_FEED_VERSION_2 batch */
+static int handle_meas_batch(const uint8_t *buf, size_t len, time_t now)
+{
+	const struct meas_feed_v2_batch *b = (const struct meas_feed_v2_batch *) buf;
+	struct meas_feed_meas mfm = {};
+	const char *scenario;
+	const uint8_t *data = b->data;
+	int i, rc;
+
+	if (len < sizeof(*b))
+		return -EINVAL;
+	len -= sizeof(*b);
+
+	if (b->hdr.msg_type != MEAS_FEED_MEAS_BATCH)
+		return -EINVAL;
+
+	osmo_strlcpy(mfm.scenario, b->scenario, sizeof(mfm.scenario));
+	if (strlen(mfm.scenario))
+		scenario = mfm.scenario;
+	else
+		scenario = NULL;
+
+	for (i = 0; i < b->num_meas; i++) {
+		rc = meas_feed_v2_meas_decode(&mfm, data, len);
+		if (rc < 0)
+			return -EINVAL;
+		insert(mfm.imsi, mfm.name, now, scenario, &mfm.mr);
+		data += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+static int handle_msg(const uint8_t *buf, size_t len)
+{
+	const struct meas_feed_hdr *mfh = (const struct meas_feed_hdr *) buf;
+	const struct meas_feed_meas *mfm = (const struct meas_feed_meas *) buf;
 	const char *scenario;
 	time_t now = time(NULL);
 
+	if (len < sizeof(*mfh))
+		return -EINVAL;
+
+	if (ntohs(mfh->version) == MEAS_FEED_VERSION_2)
+		return handle_meas_batch(buf, len, now);
+
 	if (mfh->version != MEAS_FEED_VERSION)
 		return -EINVAL;
 
-	if (mfh->msg_type != MEAS_FEED_MEAS)
+	if (mfh->msg_type != MEAS_FEED_MEAS || len < sizeof(*mfm))
 		return -EINVAL;
 
 	if (strlen(mfm->scenario))
@@ -61,30 +212,162 @@ static int handle_msg(struct msgb *msg)
 	else
 		scenario = NULL;
 
-	meas_db_insert(db, mfm->imsi, mfm->name, now,
-			scenario, &mfm->mr);
+	insert(mfm->imsi, mfm->name, now, scenario, &mfm->mr);
 
 	return 0;
 }
 
-static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
+static struct msghdr *rx_ring_hdr(unsigned int i)
+{
+#ifdef HAVE_RECVMMSG
+	return &rx_ring.mmsg[i].msg_hdr;
+#else
+	return &rx_ring.hdr[i];
+#endif
+}
+
+static unsigned int rx_ring_len(unsigned int i)
+{
+#ifdef HAVE_RECVMMSG
+	return rx_ring.mmsg[i].msg_len;
+#else
+	return rx_ring.len[i];
+#endif
+}
+
+static void rx_ring_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < RX_RING_SIZE; i++) {
+		struct msghdr *hdr = rx_ring_hdr(i);
+		rx_ring.iov[i].iov_base = rx_ring.buf[i];
+		rx_ring.iov[i].iov_len = sizeof(rx_ring.buf[i]);
+		hdr->msg_iov = &rx_ring.iov[i];
+		hdr->msg_iovlen = 1;
+		hdr->msg_control = rx_ring.cmsg[i];
+	}
+}
+
+/* Fill the ring with as many datagrams as are waiting, return how many */
+static int rx_ring_recv(int fd)
 {
+	unsigned int i;
 	int rc;
 
-	if (what & BSC_FD_READ) {
-		struct msgb *msg = msgb_alloc(1024, "UDP Rx");
+	for (i = 0; i < RX_RING_SIZE; i++)
+		rx_ring_hdr(i)->msg_controllen = sizeof(rx_ring.cmsg[i]);
 
-		rc = read(ofd->fd, msgb_data(msg), msgb_tailroom(msg));
+#ifdef HAVE_RECVMMSG
+	rc = recvmmsg(fd, rx_ring.mmsg, RX_RING_SIZE, MSG_DONTWAIT, NULL);
+#else
+	for (i = 0; i < RX_RING_SIZE; i++) {
+		rc = recvmsg(fd, &rx_ring.hdr[i], MSG_DONTWAIT);
 		if (rc < 0)
-			return rc;
-		msgb_put(msg, rc);
-		handle_msg(msg);
-		msgb_free(msg);
+			break;
+		rx_ring.len[i] = rc;
+	}
+	rc = i ? i : rc;
+#endif
+	return rc;
+}
+
+/* Pick up the kernel's running count of dropped datagrams */
+static void rx_check_drops(struct msghdr *hdr)
+{
+#ifdef SO_RXQ_OVFL
+	struct cmsghdr *cmsg;
+
+	for (cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+			memcpy(&stats.kernel_drops, CMSG_DATA(cmsg), sizeof(stats.kernel_drops));
+	}
+#endif
+}
+
+static int udp_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	int i, n;
+
+	if (what & BSC_FD_READ) {
+		n = rx_ring_recv(ofd->fd);
+		if (n < 0)
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : n;
+
+		for (i = 0; i < n; i++) {
+			stats.datagrams++;
+			rx_check_drops(rx_ring_hdr(i));
+			if (handle_msg(rx_ring.buf[i], rx_ring_len(i)) < 0)
+				stats.rejected++;
+		}
 	}
 
 	return 0;
 }
 
+static void signal_handler(int signum)
+{
+	switch (signum) {
+	case SIGINT:
+	case SIGTERM:
+		quit = 1;
+		break;
+	case SIGUSR1:
+		print_stats_requested = 1;
+		break;
+	}
+}
+
+static void print_help(void)
+{
+	printf("Usage: osmo-meas-udp2db [options] DATABASE\n");
+	printf("  -h --help\t\t\tThis text.\n");
+	printf("  -b --batch\t\t\tBatching ingest mode: insert within transactions, use WAL journaling.\n");
+	printf("  -n --commit-count NUM\t\tIn batching mode, commit after NUM reports (default 1000).\n");
+	printf("  -t --commit-interval MS\tIn batching mode, commit at least every MS milliseconds (default 1000).\n");
+	printf("Ingest statistics are printed to stderr on exit and on SIGUSR1.\n");
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "batch", 0, 0, 'b' },
+			{ "commit-count", 1, 0, 'n' },
+			{ "commit-interval", 1, 0, 't' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hbn:t:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'b':
+			batch.enabled = true;
+			break;
+		case 'n':
+			batch.commit_count = atoi(optarg);
+			if (!batch.commit_count)
+				batch.commit_count = 1;
+			break;
+		case 't':
+			batch.commit_interval_ms = atoi(optarg);
+			if (!batch.commit_interval_ms)
+				batch.commit_interval_ms = 1;
+			break;
+		default:
+			print_help();
+			exit(2);
+		}
+	}
+}
+
 int main(int argc, char **argv)
 {
 	char *db_fname;
@@ -92,12 +375,14 @@ int main(int argc, char **argv)
 
 	msgb_talloc_ctx_init(NULL, 0);
 
-	if (argc < 2) {
+	handle_options(argc, argv);
+
+	if (optind >= argc) {
 		fprintf(stderr, "You have to specify the database file name\n");
 		exit(2);
 	}
 
-	db_fname = argv[1];
+	db_fname = argv[optind];
 
 	udp_ofd.cb = udp_fd_cb;
 	rc =  osmo_sock_init_ofd(&udp_ofd, AF_INET, SOCK_DGRAM,
@@ -106,6 +391,14 @@ int main(int argc, char **argv)
 		fprintf(stderr, "Unable to create UDP listen socket\n");
 		exit(1);
 	}
+#ifdef SO_RXQ_OVFL
+	{
+		int on = 1;
+		if (setsockopt(udp_ofd.fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) < 0)
+			fprintf(stderr, "Unable to enable SO_RXQ_OVFL, kernel drops will not be counted\n");
+	}
+#endif
+	rx_ring_init();
 
 	db = meas_db_open(NULL, db_fname);
 	if (!db) {
@@ -113,14 +406,31 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
-	/* FIXME: timer-based BEGIN/COMMIT */
+	if (batch.enabled) {
+		if (meas_db_wal(db) < 0)
+			fprintf(stderr, "Unable to switch database to WAL journaling\n");
+		osmo_timer_setup(&batch.timer, batch_timer_cb, NULL);
+		osmo_timer_schedule(&batch.timer, batch.commit_interval_ms / 1000,
+				    (batch.commit_interval_ms % 1000) * 1000);
+	}
 
-	while (1) {
+	signal(SIGINT, &signal_handler);
+	signal(SIGTERM, &signal_handler);
+	signal(SIGUSR1, &signal_handler);
+
+	clock_gettime(CLOCK_MONOTONIC, &stats.start);
+
+	while (!quit) {
 		osmo_select_main(0);
+		if (print_stats_requested) {
+			print_stats_requested = 0;
+			print_stats();
+		}
 	};
 
+	batch_commit();
+	print_stats();
 	meas_db_close(db);
 
 	exit(0);
 }
-
@@ -248,6 +248,61 @@ class TestCtrlBSC(TestCtrlBase):
         self.assertEqual(r['mtype'], 'GET_REPLY')
         self.assertEqual(r['value'], 'disconnected')
 
+    def testBtsAdmissionState(self):
+        """No OML link, so the BTS is not part of the bring-up order"""
+        r = self.do_set('bts.0.admission-state', '1')
+        self.assertEqual(r['mtype'], 'ERROR')
+        self.assertEqual(r['error'], 'Read Only attribute')
+
+        r = self.do_get('bts.0.admission-state')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertEqual(r['value'], 'idle,0,0')
+
+    def testMscLoad(self):
+        r = self.do_set('msc.0.load', '1')
+        self.assertEqual(r['mtype'], 'ERROR')
+        self.assertEqual(r['error'], 'Read Only attribute')
+
+        r = self.do_get('msc.0.load')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertEqual(r['var'], 'msc.0.load')
+        self.assertEqual(r['value'], '0,0,0,not-ready')
+
+    def testCongestionCheckStats(self):
+        r = self.do_set('congestion-check-stats', '1')
+        self.assertEqual(r['mtype'], 'ERROR')
+        self.assertEqual(r['error'], 'Read Only attribute')
+
+        r = self.do_get('congestion-check-stats')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertEqual(r['var'], 'congestion-check-stats')
+        self.assertEqual(len(r['value'].split(',')), 6)
+
+    def testLatencyProfiler(self):
+        r = self.do_get('latency-profiler')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertEqual(r['var'], 'latency-profiler')
+        self.assertEqual(r['value'], '0')
+
+        r = self.do_set('latency-profiler', '1')
+        self.assertEqual(r['mtype'], 'SET_REPLY')
+        self.assertEqual(r['var'], 'latency-profiler')
+        self.assertEqual(r['value'], '1')
+
+        r = self.do_set('latency-stats', '1')
+        self.assertEqual(r['mtype'], 'ERROR')
+        self.assertEqual(r['error'], 'Read Only attribute')
+
+        r = self.do_get('latency-stats')
+        self.assertEqual(r['mtype'], 'GET_REPLY')
+        self.assertEqual(r['var'], 'latency-stats')
+        self.assertEqual(len(r['value'].split(' ')), 8)
+        self.assertEqual(len(r['value'].split(' ')[0].split(',')), 6)
+
+        r = self.do_set('latency-profiler', '0')
+        self.assertEqual(r['mtype'], 'SET_REPLY')
+        self.assertEqual(r['value'], '0')
+
     def testTrxPowerRed(self):
         r = self.do_get('bts.0.trx.0.max-power-reduction')
         self.assertEqual(r['mtype'], 'GET_REPLY')
@@ -29,6 +29,7 @@
 #include <osmocom/bsc/arfcn_range_encode.h>
 #include <osmocom/bsc/system_information.h>
 #include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/acc_ramp.h>
 
 #include <osmocom/core/application.h>
 #include <osmocom/core/byteswap.h>
@@ -648,7 +649,7 @@ static void test_si_ba_ind(struct gsm_network *net)
 
 	int rc;
 
-	bts->c0->arfcn = 23;
+	gsm_bts_trx_set_arfcn(bts->c0, 23);
 
 	printf("Testing if BA-IND is set as expected in SI2xxx and SI5xxx\n");
 
@@ -691,6 +692,53 @@ static void test_si_ba_ind(struct gsm_network *net)
 	bts_del(bts);
 }
 
+static void test_si_acc_overload_barred(struct gsm_network *net)
+{
+	static const enum osmo_sysinfo_type si_types[] = {
+		SYSINFO_TYPE_1, SYSINFO_TYPE_2, SYSINFO_TYPE_3, SYSINFO_TYPE_4,
+	};
+	struct gsm_bts *bts = bts_init(net);
+	int i, rc;
+
+	gsm_bts_trx_set_arfcn(bts->c0, 23);
+
+	printf("Testing ACC barring by CCCH overload control with ACC ramping disabled\n");
+
+	/* ramping is disabled, so its barred ACCs must not show */
+	OSMO_ASSERT(!acc_ramp_is_enabled(&bts->acc_ramp));
+	bts->acc_ramp.barred_accs = 0x3ff;
+	/* bar ACC 0 and ACC 9 */
+	bts->acc_ramp.overload_barred_accs = 0x201;
+
+	for (i = 0; i < ARRAY_SIZE(si_types); i++) {
+		const struct gsm48_rach_control *rc_ie;
+
+		rc = gsm_generate_si(bts, si_types[i]);
+		OSMO_ASSERT(rc > 0);
+
+		switch (si_types[i]) {
+		case SYSINFO_TYPE_1:
+			rc_ie = &((struct gsm48_system_information_type_1 *) GSM_BTS_SI(bts, si_types[i]))->rach_control;
+			break;
+		case SYSINFO_TYPE_2:
+			rc_ie = &((struct gsm48_system_information_type_2 *) GSM_BTS_SI(bts, si_types[i]))->rach_control;
+			break;
+		case SYSINFO_TYPE_3:
+			rc_ie = &((struct gsm48_system_information_type_3 *) GSM_BTS_SI(bts, si_types[i]))->rach_control;
+			break;
+		default:
+			rc_ie = &((struct gsm48_system_information_type_4 *) GSM_BTS_SI(bts, si_types[i]))->rach_control;
+			break;
+		}
+		printf("SI%s: barred ACC mask t2=0x%x t3=0x%02x\n", get_value_string(osmo_sitype_strs, si_types[i]),
+		       rc_ie->t2 & 0x03, rc_ie->t3);
+		OSMO_ASSERT((rc_ie->t2 & 0x03) == 0x02);
+		OSMO_ASSERT(rc_ie->t3 == 0x01);
+	}
+
+	bts_del(bts);
+}
+
 struct test_gsm48_ra_id_by_bts {
 	struct osmo_plmn_id plmn;
 	uint16_t lac;
@@ -801,6 +849,94 @@ static void test_gsm48_ra_id_by_bts()
 	OSMO_ASSERT(pass);
 }
 
+static void print_bts_by_lac(struct gsm_network *net, uint16_t lac)
+{
+	struct gsm_bts *bts;
+	printf("  LAC %u:", lac);
+	gsm_bts_for_each_by_lac(net, bts, lac)
+		printf(" bts %u", bts->nr);
+	printf("\n");
+}
+
+static void print_bts_by_lac_ci(struct gsm_network *net, uint16_t lac, uint16_t ci)
+{
+	struct gsm_bts *bts;
+	printf("  LAC %u CI %u:", lac, ci);
+	gsm_bts_for_each_by_lac_ci(net, bts, lac, ci)
+		printf(" bts %u", bts->nr);
+	printf("\n");
+}
+
+static void print_bts_by_ci(struct gsm_network *net, uint16_t ci)
+{
+	struct gsm_bts *bts;
+	printf("  CI %u:", ci);
+	gsm_bts_for_each_by_ci(net, bts, ci)
+		printf(" bts %u", bts->nr);
+	printf("\n");
+}
+
+static void test_bts_cell_index()
+{
+	static const struct {
+		uint16_t lac;
+		uint16_t ci;
+	} cells[] = {
+		{ 1, 10 },
+		{ 1, 11 },
+		{ 2, 10 },
+		{ 1, 10 },
+	};
+	struct gsm_network *net = gsm_network_init(tall_bsc_ctx);
+	struct gsm_bts *bts[ARRAY_SIZE(cells)];
+	struct gsm0808_cell_id cell_id;
+	int i;
+
+	printf("%s()\n", __func__);
+
+	for (i = 0; i < ARRAY_SIZE(cells); i++) {
+		bts[i] = gsm_bts_alloc_register(net, GSM_BTS_TYPE_UNKNOWN, 63);
+		OSMO_ASSERT(bts[i]);
+		gsm_bts_set_lac(bts[i], cells[i].lac);
+		gsm_bts_set_ci(bts[i], cells[i].ci);
+	}
+
+	print_bts_by_lac(net, 1);
+	print_bts_by_lac(net, 2);
+	print_bts_by_lac(net, 3);
+	print_bts_by_lac_ci(net, 1, 10);
+	print_bts_by_lac_ci(net, 2, 11);
+	print_bts_by_ci(net, 10);
+
+	cell_id = (struct gsm0808_cell_id){
+		.id_discr = CELL_IDENT_LAC_AND_CI,
+		.id.lac_and_ci = { .lac = 1, .ci = 10 },
+	};
+	OSMO_ASSERT(gsm_bts_by_cell_id(net, &cell_id, 0) == bts[0]);
+	OSMO_ASSERT(gsm_bts_by_cell_id(net, &cell_id, 1) == bts[3]);
+	OSMO_ASSERT(gsm_bts_by_cell_id(net, &cell_id, 2) == NULL);
+
+	printf("moving bts 0 to LAC 2 and bts 3 to CI 11\n");
+	gsm_bts_set_lac(bts[0], 2);
+	gsm_bts_set_ci(bts[3], 11);
+
+	print_bts_by_lac(net, 1);
+	print_bts_by_lac(net, 2);
+	print_bts_by_lac_ci(net, 1, 10);
+	print_bts_by_lac_ci(net, 1, 11);
+	print_bts_by_ci(net, 10);
+
+	cell_id = (struct gsm0808_cell_id){
+		.id_discr = CELL_IDENT_LAC,
+		.id.lac = 2,
+	};
+	OSMO_ASSERT(gsm_bts_by_cell_id(net, &cell_id, 0) == bts[0]);
+	OSMO_ASSERT(gsm_bts_by_cell_id(net, &cell_id, 1) == bts[2]);
+	OSMO_ASSERT(gsm_bts_by_lac(net, GSM_LAC_RESERVED_ALL_BTS, bts[1]) == bts[2]);
+
+	talloc_free(net);
+}
+
 static void test_gsm48_multirate_config()
 {
 	uint8_t lv[7];
@@ -938,11 +1074,14 @@ int main(int argc, char **argv)
 	test_si2q_long(net);
 
 	test_si_ba_ind(net);
+	test_si_acc_overload_barred(net);
 
 	test_gsm48_ra_id_by_bts();
 
 	test_gsm48_multirate_config();
 
+	test_bts_cell_index();
+
 	printf("Done.\n");
 
 	return EXIT_SUCCESS;
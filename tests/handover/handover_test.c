@@ -47,6 +47,7 @@
 #include <osmocom/bsc/lchan_fsm.h>
 #include <osmocom/bsc/handover_fsm.h>
 #include <osmocom/bsc/bsc_msc_data.h>
+#include <osmocom/bsc/chan_alloc.h>
 
 void *ctx;
 
@@ -184,8 +185,8 @@ static struct gsm_bts *create_bts(int arfcn)
 		return NULL;
 	}
 
-	bts->location_area_code = 23;
-	bts->c0->arfcn = arfcn;
+	gsm_bts_set_lac(bts, 23);
+	gsm_bts_trx_set_arfcn(bts->c0, arfcn);
 
 	bts->codec.efr = 1;
 	bts->codec.hr = 1;
@@ -260,6 +261,8 @@ struct gsm_lchan *create_lchan(struct gsm_bts *bts, int full_rate, char *codec)
 	/* serious hack into osmo_fsm */
 	lchan->fi->state = LCHAN_ST_ESTABLISHED;
 	lchan->ts->fi->state = TS_ST_IN_USE;
+	/* bypassing the FSMs also bypasses the channel load and free lchan accounting */
+	ts_avail_update(lchan->ts);
 	LOG_LCHAN(lchan, LOGL_DEBUG, "activated by handover_test.c\n");
 
 	create_conn(lchan);
@@ -1744,6 +1747,20 @@ int main(int argc, char **argv)
 		osmo_fsm_inst_term(conn->fi, OSMO_FSM_TERM_REGULAR, NULL);
 	}
 
+	/* After all that lchan and timeslot activity, the incrementally counted channel load and free TCH
+	 * must still match a full scan */
+	for (i = 0; i < bts_num; i++) {
+		OSMO_ASSERT(bts_chan_load_check(bts[i]));
+		OSMO_ASSERT(bts_free_tch_check(bts[i]));
+	}
+
+	/* Resetting the NM state, as on OML link loss, makes all TRX unusable; the counts must follow */
+	for (i = 0; i < bts_num; i++) {
+		gsm_bts_mo_reset(bts[i]);
+		OSMO_ASSERT(bts_chan_load_check(bts[i]));
+		OSMO_ASSERT(bts_free_tch_check(bts[i]));
+	}
+
 	fprintf(stderr, "--------------------\n");
 
 	printf("Test OK\n");
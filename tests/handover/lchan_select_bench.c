@@ -0,0 +1,327 @@
+/* Microbenchmark for lchan_select_by_type() replaying RACH bursts on a 12-TRX cell */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Not part of the regression test suite, since its output depends on the machine it runs on. Run
+ * ./lchan_select_bench manually to see the cost of selecting an lchan for each Channel Request of a RACH
+ * burst, like rsl_rx_chan_rqd() does: SDCCH first, then falling back to TCH/H and TCH/F. Bursts larger
+ * than the cell's 183 lchans show the cost of failing to select when the cell is saturated. The "linear"
+ * column shows what walking all TRX and timeslots costs, which is what lchan_select_by_type() used to
+ * do. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+
+#include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
+
+#include <osmocom/bsc/abis_rsl.h>
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/lchan_select.h>
+#include <osmocom/bsc/lchan_fsm.h>
+#include <osmocom/bsc/timeslot_fsm.h>
+#include <osmocom/bsc/bss.h>
+#include <osmocom/bsc/gsm_08_08.h>
+#include <osmocom/bsc/osmo_bsc.h>
+#include <osmocom/bsc/handover.h>
+
+#define NUM_TRX 12
+#define ROUNDS 2000
+
+static const unsigned int bursts[] = { 16, 64, 183, 256 };
+
+void *ctx;
+
+struct gsm_network *bsc_gsmnet;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* c0 has a CCCH+SDCCH/4 and an SDCCH/8, all other TRX have one SDCCH/8, all remaining timeslots are TCH/F:
+ * 100 SDCCH and 83 TCH/F */
+static struct gsm_bts *create_bts(void)
+{
+	struct gsm_bts *bts;
+	struct gsm_bts_trx *trx;
+	int i;
+
+	bts = bsc_bts_alloc_register(bsc_gsmnet, GSM_BTS_TYPE_UNKNOWN, 0x3f);
+	for (i = 1; i < NUM_TRX; i++)
+		OSMO_ASSERT(gsm_bts_trx_alloc(bts));
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		struct e1inp_sign_link *rsl_link = talloc_zero(ctx, struct e1inp_sign_link);
+		rsl_link->trx = trx;
+		trx->rsl_link = rsl_link;
+
+		trx->mo.nm_state.operational = NM_OPSTATE_ENABLED;
+		trx->mo.nm_state.availability = NM_AVSTATE_OK;
+		trx->bb_transc.mo.nm_state.operational = NM_OPSTATE_ENABLED;
+		trx->bb_transc.mo.nm_state.availability = NM_AVSTATE_OK;
+
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+			if (trx == bts->c0 && i == 0)
+				ts->pchan_from_config = GSM_PCHAN_CCCH_SDCCH4;
+			else if ((trx == bts->c0 && i == 1) || (trx != bts->c0 && i == 0))
+				ts->pchan_from_config = GSM_PCHAN_SDCCH8_SACCH8C;
+			else
+				ts->pchan_from_config = GSM_PCHAN_TCH_F;
+			ts->mo.nm_state.operational = NM_OPSTATE_ENABLED;
+			ts->mo.nm_state.availability = NM_AVSTATE_OK;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			/* make sure ts->lchans[] get initialized */
+			osmo_fsm_inst_dispatch(trx->ts[i].fi, TS_EV_RSL_READY, 0);
+			osmo_fsm_inst_dispatch(trx->ts[i].fi, TS_EV_OML_READY, 0);
+		}
+	}
+	return bts;
+}
+
+/* The TRX and TS walk that lchan_select_by_type() used to do for each pchan */
+static struct gsm_lchan *find_linear_pchan(struct gsm_bts *bts, enum gsm_phys_chan_config pchan)
+{
+	struct gsm_bts_trx *trx;
+	struct gsm_lchan *lchan;
+	int i;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (!trx_is_usable(trx))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[i];
+			if (!ts_is_usable(ts) || ts->pchan_on_init != pchan || !ts_usable_as_pchan(ts, pchan))
+				continue;
+			ts_as_pchan_for_each_lchan(lchan, ts, pchan) {
+				if (lchan->fi->state == LCHAN_ST_UNUSED)
+					return lchan;
+			}
+		}
+	}
+	return NULL;
+}
+
+static struct gsm_lchan *find_linear(struct gsm_bts *bts, enum gsm_chan_t type)
+{
+	struct gsm_lchan *lchan = NULL;
+
+	switch (type) {
+	case GSM_LCHAN_SDCCH:
+		lchan = find_linear_pchan(bts, GSM_PCHAN_CCCH_SDCCH4);
+		if (!lchan)
+			lchan = find_linear_pchan(bts, GSM_PCHAN_CCCH_SDCCH4_CBCH);
+		if (!lchan)
+			lchan = find_linear_pchan(bts, GSM_PCHAN_SDCCH8_SACCH8C);
+		if (!lchan)
+			lchan = find_linear_pchan(bts, GSM_PCHAN_SDCCH8_SACCH8C_CBCH);
+		break;
+	case GSM_LCHAN_TCH_H:
+		lchan = find_linear_pchan(bts, GSM_PCHAN_TCH_H);
+		if (!lchan)
+			lchan = find_linear_pchan(bts, GSM_PCHAN_TCH_F_TCH_H_PDCH);
+		break;
+	case GSM_LCHAN_TCH_F:
+		lchan = find_linear_pchan(bts, GSM_PCHAN_TCH_F);
+		if (!lchan)
+			lchan = find_linear_pchan(bts, GSM_PCHAN_TCH_F_PDCH);
+		break;
+	default:
+		break;
+	}
+	return lchan;
+}
+
+/* Like rsl_rx_chan_rqd(): SDCCH first, then fall back to TCH/H and TCH/F */
+static struct gsm_lchan *select_for_rach(struct gsm_bts *bts, bool linear)
+{
+	struct gsm_lchan *lchan;
+	struct gsm_lchan *(*select)(struct gsm_bts *, enum gsm_chan_t) = linear ? find_linear : lchan_select_by_type;
+
+	lchan = select(bts, GSM_LCHAN_SDCCH);
+	if (!lchan)
+		lchan = select(bts, GSM_LCHAN_TCH_H);
+	if (!lchan)
+		lchan = select(bts, GSM_LCHAN_TCH_F);
+	return lchan;
+}
+
+/* Instead of running the lchan FSM through activation, just mark the lchan as in use */
+static void lchan_set_state(struct gsm_lchan *lchan, uint32_t state)
+{
+	lchan->fi->state = state;
+	ts_avail_update(lchan->ts);
+}
+
+/* Return the time spent selecting, in ns per Channel Request */
+static double burst(struct gsm_bts *bts, unsigned int size, bool linear, unsigned int *selected)
+{
+	struct gsm_lchan *lchans[size];
+	unsigned int n = 0;
+	unsigned int i;
+	double t0, t = 0;
+
+	for (i = 0; i < size; i++) {
+		struct gsm_lchan *lchan;
+		t0 = now_ns();
+		lchan = select_for_rach(bts, linear);
+		t += now_ns() - t0;
+		if (!lchan)
+			continue;
+		lchan_set_state(lchan, LCHAN_ST_ESTABLISHED);
+		lchans[n++] = lchan;
+	}
+
+	for (i = 0; i < n; i++)
+		lchan_set_state(lchans[i], LCHAN_ST_UNUSED);
+
+	*selected = n;
+	return t / size;
+}
+
+static void bench(struct gsm_bts *bts, unsigned int size)
+{
+	unsigned int selected, linear_selected;
+	double ns = 0, ns_linear = 0;
+	unsigned int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		ns += burst(bts, size, false, &selected);
+		ns_linear += burst(bts, size, true, &linear_selected);
+		OSMO_ASSERT(selected == linear_selected);
+	}
+
+	printf("%10u  %8u  %16.1f  %11.1f\n", size, selected, ns / ROUNDS, ns_linear / ROUNDS);
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRLL] = {
+		.name = "DRLL",
+		.description = "RLL",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+	[DCHAN] = {
+		.name = "DCHAN",
+		.description = "lchan FSM",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+	[DTS] = {
+		.name = "DTS",
+		.description = "timeslot FSM",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+	[DREF] = {
+		.name = "DREF",
+		.description = "Reference Counting",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts *bts;
+	unsigned int i;
+
+	ctx = talloc_named_const(NULL, 0, "lchan_select_bench");
+	msgb_talloc_ctx_init(ctx, 0);
+
+	osmo_init_logging2(ctx, &log_info);
+	osmo_fsm_log_addr(false);
+
+	bsc_network_alloc();
+	if (!bsc_gsmnet)
+		exit(1);
+
+	ts_fsm_init();
+	lchan_fsm_init();
+
+	/* We don't really need any specific model here */
+	bts_model_unknown_init();
+
+	bts = create_bts();
+
+	printf("burst size  selected  per request [ns]  linear [ns]\n");
+	for (i = 0; i < ARRAY_SIZE(bursts); i++)
+		bench(bts, bursts[i]);
+
+	talloc_free(ctx);
+	return EXIT_SUCCESS;
+}
+
+/* Nothing of the below is reached, the lchan and timeslot FSMs are not driven past selection */
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	msgb_free(msg);
+	return 0;
+}
+
+void __wrap_osmo_mgcpc_ep_ci_request(struct osmo_mgcpc_ep_ci *ci,
+				    enum mgcp_verb verb, const struct mgcp_conn_peer *verb_info,
+				    struct osmo_fsm_inst *notify,
+				    uint32_t event_success, uint32_t event_failure,
+				    void *notify_data)
+{
+}
+
+void rtp_socket_free() {}
+void rtp_send_frame() {}
+void rtp_socket_upstream() {}
+void rtp_socket_create() {}
+void rtp_socket_connect() {}
+void rtp_socket_proxy() {}
+void trau_mux_unmap() {}
+void trau_mux_map_lchan() {}
+void trau_recv_lchan() {}
+void trau_send_frame() {}
+int osmo_bsc_sigtran_send(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
+int osmo_bsc_sigtran_open_conn(struct gsm_subscriber_connection *conn, struct msgb *msg) { return 0; }
+void bsc_sapi_n_reject(struct gsm_subscriber_connection *conn, int dlci) {}
+void bsc_cipher_mode_compl(struct gsm_subscriber_connection *conn, struct msgb *msg, uint8_t chosen_encr) {}
+int bsc_compl_l3(struct gsm_subscriber_connection *conn, struct msgb *msg, uint16_t chosen_channel)
+{ return 0; }
+void bsc_dtap(struct gsm_subscriber_connection *conn, uint8_t link_id, struct msgb *msg) {}
+void bsc_assign_compl(struct gsm_subscriber_connection *conn, uint8_t rr_cause) {}
+void bsc_cm_update(struct gsm_subscriber_connection *conn,
+		   const uint8_t *cm2, uint8_t cm2_len,
+		   const uint8_t *cm3, uint8_t cm3_len) {}
+int bsc_tx_bssmap_ho_required(struct gsm_lchan *lchan, const struct gsm0808_cell_id_list2 *target_cells)
+{ return 0; }
+int bsc_tx_bssmap_ho_request_ack(struct gsm_subscriber_connection *conn, struct msgb *rr_ho_command)
+{ return 0; }
+int bsc_tx_bssmap_ho_detect(struct gsm_subscriber_connection *conn) { return 0; }
+enum handover_result bsc_tx_bssmap_ho_complete(struct gsm_subscriber_connection *conn,
+					       struct gsm_lchan *lchan) { return HO_RESULT_OK; }
+void bsc_tx_bssmap_ho_failure(struct gsm_subscriber_connection *conn) {}
@@ -0,0 +1,272 @@
+/* Microbenchmark for neigh_meas_process() feeding synthetic Measurement Reports */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Not part of the regression test suite, since its output depends on the machine it runs on. Run
+ * ./neigh_meas_bench manually to see the cost of processing the neighbor cells of one Measurement Report
+ * into an lchan's neigh_meas table, as both handover decision algorithms do for every report. Each report
+ * lists six cells, drawn from a pool of neighbors of the given size; pools larger than MAX_NEIGH_MEAS make
+ * cells come and go, which means evicting the weakest tracked cell. The "old" column shows the previous
+ * implementation, which matched each tracked cell against the report and re-averaged every slot's window
+ * to find a cell to evict. The last column is how many TCH lchans, each reporting every 480 ms, one CPU
+ * core could keep up with. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/talloc.h>
+
+#include <osmocom/mgcp_client/mgcp_client_endpoint_fsm.h>
+
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/meas_rep.h>
+
+#define NUM_REPORTS 4096
+#define REPORTS 1000000
+
+static const unsigned int pools[] = { 6, 10, 16, 32 };
+
+static struct gsm_meas_rep reports[NUM_REPORTS];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* The previous implementation, for comparison */
+static struct gsm_meas_rep_cell *old_cell_in_rep(struct gsm_meas_rep *mr, uint16_t arfcn, uint8_t bsic)
+{
+	int i;
+
+	for (i = 0; i < mr->num_cell; i++) {
+		struct gsm_meas_rep_cell *mrc = &mr->cell[i];
+
+		if (mrc->arfcn != arfcn)
+			continue;
+		if (mrc->bsic != bsic)
+			continue;
+
+		return mrc;
+	}
+	return NULL;
+}
+
+static int old_neigh_meas_avg(struct neigh_meas_proc *nmp, int window)
+{
+	unsigned int i, idx;
+	int avg = 0;
+
+	if (window > nmp->rxlev_cnt)
+		window = nmp->rxlev_cnt;
+	if (window <= 0)
+		return 0;
+
+	idx = calc_initial_idx(ARRAY_SIZE(nmp->rxlev),
+			       nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev),
+			       window);
+
+	for (i = 0; i < window; i++) {
+		int j = (idx+i) % ARRAY_SIZE(nmp->rxlev);
+
+		avg += nmp->rxlev[j];
+	}
+
+	return avg / window;
+}
+
+static struct neigh_meas_proc *old_find_unused_or_worst_neigh(struct gsm_lchan *lchan)
+{
+	struct neigh_meas_proc *nmp_worst = NULL;
+	int worst = 0;
+	int j;
+
+	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+		if (!nmp->arfcn)
+			return nmp;
+	}
+
+	for (j = 0; j < ARRAY_SIZE(lchan->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &lchan->neigh_meas[j];
+		int avg = old_neigh_meas_avg(nmp, MAX_WIN_NEIGH_AVG);
+		if (nmp_worst && avg >= worst)
+			continue;
+		worst = avg;
+		nmp_worst = nmp;
+	}
+
+	return nmp_worst;
+}
+
+static void old_process_meas_neigh(struct gsm_meas_rep *mr)
+{
+	int i, j, idx;
+
+	for (j = 0; j < ARRAY_SIZE(mr->lchan->neigh_meas); j++) {
+		struct neigh_meas_proc *nmp = &mr->lchan->neigh_meas[j];
+		unsigned int idx;
+		struct gsm_meas_rep_cell *mrc;
+
+		if (!nmp->arfcn)
+			continue;
+
+		mrc = old_cell_in_rep(mr, nmp->arfcn, nmp->bsic);
+		idx = nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev);
+		if (mrc) {
+			nmp->rxlev[idx] = mrc->rxlev;
+			nmp->last_seen_nr = mr->nr;
+			mrc->flags |= MRC_F_PROCESSED;
+		} else {
+			nmp->rxlev[idx] = 0;
+		}
+		nmp->rxlev_cnt++;
+	}
+
+	for (i = 0; i < mr->num_cell; i++) {
+		struct gsm_meas_rep_cell *mrc = &mr->cell[i];
+		struct neigh_meas_proc *nmp;
+
+		if (mrc->flags & MRC_F_PROCESSED)
+			continue;
+
+		nmp = old_find_unused_or_worst_neigh(mr->lchan);
+
+		nmp->arfcn = mrc->arfcn;
+		nmp->bsic = mrc->bsic;
+
+		nmp->rxlev_cnt = 0;
+		idx = nmp->rxlev_cnt % ARRAY_SIZE(nmp->rxlev);
+		nmp->rxlev[idx] = mrc->rxlev;
+		nmp->rxlev_cnt++;
+		nmp->last_seen_nr = mr->nr;
+
+		mrc->flags |= MRC_F_PROCESSED;
+	}
+}
+
+/* Six distinct cells per report out of a pool of neighbors with fixed ARFCN and BSIC */
+static void gen_reports(struct gsm_lchan *lchan, unsigned int pool)
+{
+	unsigned int i, c;
+
+	for (i = 0; i < NUM_REPORTS; i++) {
+		struct gsm_meas_rep *mr = &reports[i];
+		unsigned int first = pool > 6 ? rand() % pool : 0;
+
+		*mr = (struct gsm_meas_rep){
+			.lchan = lchan,
+			.nr = i,
+			.num_cell = 6,
+		};
+		for (c = 0; c < 6; c++) {
+			unsigned int n = (first + c) % pool;
+			mr->cell[c] = (struct gsm_meas_rep_cell){
+				.arfcn = 1 + n * 3,
+				.bsic = n % 64,
+				.neigh_idx = c,
+				.rxlev = 10 + (rand() % 40),
+			};
+		}
+	}
+}
+
+static double run(struct gsm_lchan *lchan, bool old)
+{
+	double t0;
+	unsigned int i, c;
+
+	memset(lchan->neigh_meas, 0, sizeof(lchan->neigh_meas));
+
+	t0 = now_ns();
+	for (i = 0; i < REPORTS; i++) {
+		struct gsm_meas_rep *mr = &reports[i % NUM_REPORTS];
+		for (c = 0; c < mr->num_cell; c++)
+			mr->cell[c].flags = 0;
+		if (old)
+			old_process_meas_neigh(mr);
+		else
+			neigh_meas_process(mr);
+	}
+	return (now_ns() - t0) / REPORTS;
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DRSL] = {
+		.name = "DRSL",
+		.description = "A-bis Radio Signalling Link (RSL)",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+	[DHODEC] = {
+		.name = "DHODEC",
+		.description = "Handover decision",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+};
+
+const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main(int argc, char **argv)
+{
+	void *ctx = talloc_named_const(NULL, 0, "neigh_meas_bench");
+	struct gsm_lchan *lchan = talloc_zero(ctx, struct gsm_lchan);
+	unsigned int i;
+
+	osmo_init_logging2(ctx, &log_info);
+	srand(23);
+
+	printf("neighbors  per report [ns]  old [ns]  lchans per core\n");
+	for (i = 0; i < ARRAY_SIZE(pools); i++) {
+		double ns, ns_old;
+
+		gen_reports(lchan, pools[i]);
+		ns = run(lchan, false);
+		ns_old = run(lchan, true);
+		printf("%9u  %15.1f  %8.1f  %15.0f\n", pools[i], ns, ns_old, 480e6 / ns);
+	}
+
+	talloc_free(ctx);
+	return EXIT_SUCCESS;
+}
+
+/* Nothing of the below is reached, no lchan or timeslot FSMs are involved */
+int __wrap_abis_rsl_sendmsg(struct msgb *msg)
+{
+	msgb_free(msg);
+	return 0;
+}
+
+void __wrap_osmo_mgcpc_ep_ci_request(struct osmo_mgcpc_ep_ci *ci,
+				    enum mgcp_verb verb, const struct mgcp_conn_peer *verb_info,
+				    struct osmo_fsm_inst *notify,
+				    uint32_t event_success, uint32_t event_failure,
+				    void *notify_data)
+{
+}
+
+void rtp_socket_free() {}
+void rtp_send_frame() {}
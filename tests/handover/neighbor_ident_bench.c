@@ -0,0 +1,164 @@
+/* Microbenchmark for neighbor_ident_get() against the number of remote-BSS neighbor cells */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Not part of the regression test suite, since its output depends on the machine it runs on. Run
+ * ./neighbor_ident_bench manually to see the cost of looking up a neighbor ARFCN+BSIC from a Measurement
+ * Report with growing numbers of configured remote-BSS cells. The "linear" column shows what a walk over
+ * the entire neighbor list costs, which is what neighbor_ident_get() used to do. */
+
+#include <talloc.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm0808.h>
+
+#include <osmocom/bsc/neighbor_ident.h>
+
+#define LOOKUPS 200000
+#define LINEAR_LOOKUPS 2000
+
+/* numbers of remote-BSS cells, spread over 200 local BTS; every 16th ARFCN also gets a wildcard entry */
+static const unsigned int populations[] = { 100, 1000, 5000, 20000 };
+
+static const struct gsm0808_cell_id_list2 cil = {
+	.id_discr = CELL_IDENT_LAC,
+	.id_list_len = 1,
+	.id_list = {
+		{
+			.lac = 23
+		},
+	},
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static struct neighbor_ident_key key_for(unsigned int i)
+{
+	return (struct neighbor_ident_key){
+		.from_bts = i % 200,
+		.arfcn = (i / 200) % 1024,
+		.bsic = (i / (200 * 1024)) % 64,
+	};
+}
+
+struct linear_search {
+	const struct neighbor_ident_key *search_for;
+	const struct gsm0808_cell_id_list2 *exact;
+	const struct gsm0808_cell_id_list2 *wildcard;
+};
+
+static bool linear_cb(const struct neighbor_ident_key *key, const struct gsm0808_cell_id_list2 *val,
+		      void *cb_data)
+{
+	struct linear_search *s = cb_data;
+	if (neighbor_ident_key_match(key, s->search_for, true)) {
+		s->exact = val;
+		return false;
+	}
+	if (neighbor_ident_key_match(key, s->search_for, false))
+		s->wildcard = val;
+	return true;
+}
+
+static const struct gsm0808_cell_id_list2 *get_linear(struct neighbor_ident_list *nil,
+						      const struct neighbor_ident_key *key)
+{
+	struct linear_search s = { .search_for = key };
+	neighbor_ident_iter(nil, linear_cb, &s);
+	return s.exact ? : s.wildcard;
+}
+
+static void bench(void *ctx, unsigned int population)
+{
+	struct neighbor_ident_list *nil = neighbor_ident_init(ctx);
+	struct neighbor_ident_key key;
+	double t0, ns_hit, ns_wildcard, ns_miss, ns_linear;
+	unsigned int i;
+
+	for (i = 0; i < population; i++) {
+		key = key_for(i);
+		OSMO_ASSERT(neighbor_ident_add(nil, &key, &cil) > 0);
+	}
+	for (i = 0; i < 1024; i += 16) {
+		key = (struct neighbor_ident_key){
+			.from_bts = NEIGHBOR_IDENT_KEY_ANY_BTS,
+			.arfcn = i,
+			.bsic = BSIC_ANY,
+		};
+		neighbor_ident_add(nil, &key, &cil);
+	}
+
+	/* configured cells */
+	t0 = now_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		key = key_for((i * 7919) % population);
+		OSMO_ASSERT(neighbor_ident_get(nil, &key));
+	}
+	ns_hit = (now_ns() - t0) / LOOKUPS;
+
+	/* cells only known by a wildcard entry */
+	t0 = now_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		key = key_for((i * 7919) % population);
+		key.arfcn = (i % 64) * 16;
+		key.bsic = 63;
+		neighbor_ident_get(nil, &key);
+	}
+	ns_wildcard = (now_ns() - t0) / LOOKUPS;
+
+	/* ARFCN+BSIC not configured at all */
+	t0 = now_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		key = key_for((i * 7919) % population);
+		key.arfcn = 1 + (i % 15);
+		key.bsic = 63;
+		OSMO_ASSERT(!neighbor_ident_get(nil, &key));
+	}
+	ns_miss = (now_ns() - t0) / LOOKUPS;
+
+	t0 = now_ns();
+	for (i = 0; i < LINEAR_LOOKUPS; i++) {
+		key = key_for((i * 7919) % population);
+		OSMO_ASSERT(get_linear(nil, &key));
+	}
+	ns_linear = (now_ns() - t0) / LINEAR_LOOKUPS;
+
+	printf("%10u  %8.1f  %13.1f  %9.1f  %11.1f\n", population, ns_hit, ns_wildcard, ns_miss, ns_linear);
+
+	neighbor_ident_free(nil);
+}
+
+int main(void)
+{
+	void *ctx = talloc_named_const(NULL, 0, "neighbor_ident_bench");
+	unsigned int i;
+
+	printf("population  hit [ns]  wildcard [ns]  miss [ns]  linear [ns]\n");
+	for (i = 0; i < ARRAY_SIZE(populations); i++)
+		bench(ctx, populations[i]);
+
+	talloc_free(ctx);
+	return 0;
+}
@@ -224,6 +224,17 @@ int main(void)
 	check_get(k(0, 1, 2), true);
 	neighbor_ident_free(nil);
 
+	printf("\n--- Several wildcard matches: the entry added last wins\n");
+	nil = neighbor_ident_init(ctx);
+	check_add(k(NEIGHBOR_IDENT_KEY_ANY_BTS, 1, BSIC_ANY), &lac1, 1);
+	check_add(k(0, 1, BSIC_ANY), &cgi1, 1);
+	check_add(k(NEIGHBOR_IDENT_KEY_ANY_BTS, 1, 2), &lac2, 2);
+	check_get(k(0, 1, 2), true);
+	check_del(k(NEIGHBOR_IDENT_KEY_ANY_BTS, 1, 2), true);
+	check_get(k(0, 1, 2), true);
+	check_get(k(1, 1, 2), true);
+	neighbor_ident_free(nil);
+
 	printf("\n--- Value ranges\n");
 	nil = neighbor_ident_init(ctx);
 	check_add(k(0, 6, 1 << 6), &lac1, -ERANGE);
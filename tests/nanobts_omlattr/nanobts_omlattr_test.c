@@ -214,6 +214,7 @@ int main(int argc, char **argv)
 	/* Allocate environmental structs (bts, net, trx) */
 	net = talloc_zero(ctx, struct gsm_network);
 	INIT_LLIST_HEAD(&net->bts_list);
+	gsm_bts_cell_index_init(net);
 	net->T_defs = gsm_network_T_defs;
 	gsm_bts_model_register(&bts_model_nanobts);
 	bts = gsm_bts_alloc_register(net, GSM_BTS_TYPE_NANOBTS, 63);
@@ -224,10 +225,10 @@ int main(int argc, char **argv)
 	/* Parameters needed by nanobts_attr_bts_get() */
 	bts->rach_b_thresh = -1;
 	bts->rach_ldavg_slots = -1;
-	bts->c0->arfcn = 866;
-	bts->cell_identity = 1337;
+	gsm_bts_trx_set_arfcn(bts->c0, 866);
+	gsm_bts_set_ci(bts, 1337);
 	bts->network->plmn = (struct osmo_plmn_id){ .mcc=1, .mnc=1 };
-	bts->location_area_code = 1;
+	gsm_bts_set_lac(bts, 1);
 	bts->gprs.rac = 0;
 	uint8_t attr_bts_expected[] =
 	    { 0x19, 0x55, 0x5b, 0x61, 0x67, 0x6d, 0x73, 0x18, 0x06, 0x0e, 0x00,
@@ -0,0 +1,167 @@
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmocom/bsc/gsm_data.h>
+#include <osmocom/bsc/sccp_conn_id.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <stdio.h>
+
+void *ctx = NULL;
+
+#define CONCURRENT_CONNS 1000
+#define CONN_CHURN 100000
+
+static struct gsm_network *net;
+
+static struct gsm_subscriber_connection *conn_alloc(void)
+{
+	struct gsm_subscriber_connection *conn = talloc_zero(ctx, struct gsm_subscriber_connection);
+	OSMO_ASSERT(conn);
+	conn->sccp.conn_id = -1;
+	INIT_LLIST_HEAD(&conn->sccp.conn_id_entry);
+	return conn;
+}
+
+static void conn_open(struct gsm_subscriber_connection *conn)
+{
+	int conn_id = sccp_conn_id_pick_free(net);
+	OSMO_ASSERT(conn_id >= 0);
+	OSMO_ASSERT(sccp_conn_id_find(net, conn_id) == NULL);
+	sccp_conn_id_set(net, conn, conn_id);
+	OSMO_ASSERT(sccp_conn_id_find(net, conn_id) == conn);
+}
+
+static void conn_close(struct gsm_subscriber_connection *conn)
+{
+	int conn_id = conn->sccp.conn_id;
+	OSMO_ASSERT(sccp_conn_id_find(net, conn_id) == conn);
+	sccp_conn_id_clear(conn);
+	OSMO_ASSERT(conn->sccp.conn_id == -1);
+	OSMO_ASSERT(sccp_conn_id_find(net, conn_id) == NULL);
+}
+
+static void test_pick_and_find(void)
+{
+	struct gsm_subscriber_connection *a = conn_alloc();
+	struct gsm_subscriber_connection *b = conn_alloc();
+	struct gsm_subscriber_connection *c = conn_alloc();
+
+	printf("\n%s()\n", __func__);
+	sccp_conn_id_init(net);
+
+	conn_open(a);
+	conn_open(b);
+	printf("picked conn_id %d and %d\n", a->sccp.conn_id, b->sccp.conn_id);
+
+	/* An id set from outside, e.g. by an N-CONNECT.ind from the MSC, is skipped when picking */
+	sccp_conn_id_set(net, c, 3);
+	OSMO_ASSERT(sccp_conn_id_find(net, 3) == c);
+	printf("next free conn_id after 3 was taken: %d\n", sccp_conn_id_pick_free(net));
+
+	/* Clearing twice is harmless */
+	conn_close(a);
+	sccp_conn_id_clear(a);
+	OSMO_ASSERT(sccp_conn_id_find(net, b->sccp.conn_id) == b);
+
+	conn_close(b);
+	conn_close(c);
+	talloc_free(a);
+	talloc_free(b);
+	talloc_free(c);
+}
+
+static void test_wrap_around(void)
+{
+	struct gsm_subscriber_connection *a = conn_alloc();
+	struct gsm_subscriber_connection *b = conn_alloc();
+	struct gsm_subscriber_connection *c = conn_alloc();
+
+	printf("\n%s()\n", __func__);
+	sccp_conn_id_init(net);
+
+	sccp_conn_id_set(net, a, 0);
+	net->sccp_conn_ids.last_picked = SCCP_CONN_ID_MASK - 1;
+
+	conn_open(b);
+	conn_open(c);
+	printf("picked conn_id 0x%x and %d\n", b->sccp.conn_id, c->sccp.conn_id);
+
+	conn_close(a);
+	conn_close(b);
+	conn_close(c);
+	talloc_free(a);
+	talloc_free(b);
+	talloc_free(c);
+}
+
+static void test_stress(void)
+{
+	struct gsm_subscriber_connection *conns[CONCURRENT_CONNS] = {};
+	unsigned int i;
+	unsigned int bkt;
+	unsigned int remaining = 0;
+	struct gsm_subscriber_connection *conn;
+
+	printf("\n%s()\n", __func__);
+	sccp_conn_id_init(net);
+
+	for (i = 0; i < CONN_CHURN; i++) {
+		struct gsm_subscriber_connection **slot = &conns[i % CONCURRENT_CONNS];
+		if (*slot) {
+			conn_close(*slot);
+			talloc_free(*slot);
+		}
+		*slot = conn_alloc();
+		conn_open(*slot);
+	}
+	printf("created and tore down %u connections, %u concurrently, last conn_id %u\n",
+	       CONN_CHURN, CONCURRENT_CONNS, net->sccp_conn_ids.last_picked);
+
+	hash_for_each(net->sccp_conn_ids.by_id, bkt, conn, sccp.conn_id_entry)
+		remaining++;
+	printf("%u connections in the index\n", remaining);
+	OSMO_ASSERT(remaining == CONCURRENT_CONNS);
+
+	for (i = 0; i < CONCURRENT_CONNS; i++) {
+		conn_close(conns[i]);
+		talloc_free(conns[i]);
+	}
+
+	remaining = 0;
+	hash_for_each(net->sccp_conn_ids.by_id, bkt, conn, sccp.conn_id_entry)
+		remaining++;
+	printf("%u connections in the index\n", remaining);
+	OSMO_ASSERT(remaining == 0);
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "sccp_conn_id_test");
+	net = talloc_zero(ctx, struct gsm_network);
+
+	test_pick_and_find();
+	test_wrap_around();
+	test_stress();
+
+	printf("\nDone\n");
+	talloc_free(ctx);
+	return 0;
+}
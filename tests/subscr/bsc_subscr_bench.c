@@ -0,0 +1,133 @@
+/* Microbenchmark for bsc_subscr lookup by IMSI and TMSI against population size */
+/*
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Not part of the regression test suite, since its output depends on the machine it runs on. Run
+ * ./bsc_subscr_bench manually to see the cost of a lookup with growing numbers of subscribers. The
+ * "linear" column shows what an strcmp() walk over the entire subscriber list costs, which is what
+ * bsc_subscr_find_by_imsi() used to do. */
+
+#include <osmocom/bsc/debug.h>
+#include <osmocom/bsc/bsc_subscriber.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/utils.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define LOOKUPS 200000
+#define LINEAR_LOOKUPS 2000
+
+static const unsigned int populations[] = { 100, 1000, 10000, 50000, 100000 };
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void imsi_for(char *buf, size_t len, unsigned int i)
+{
+	snprintf(buf, len, "0010100%08u", i);
+}
+
+static struct bsc_subscr *find_linear(struct bsc_subscr_store *bsubst, const char *imsi)
+{
+	struct bsc_subscr *bsub;
+	llist_for_each_entry(bsub, &bsubst->bsub_list, entry) {
+		if (!strcmp(bsub->imsi, imsi))
+			return bsub;
+	}
+	return NULL;
+}
+
+static void bench(void *ctx, unsigned int population)
+{
+	struct bsc_subscr_store *bsubst = bsc_subscr_store_alloc(ctx);
+	struct bsc_subscr *bsub;
+	char imsi[GSM23003_IMSI_MAX_DIGITS+1];
+	double t0, ns_imsi, ns_tmsi, ns_linear;
+	unsigned int i;
+
+	for (i = 0; i < population; i++) {
+		imsi_for(imsi, sizeof(imsi), i);
+		bsub = bsc_subscr_find_or_create_by_imsi(bsubst, imsi);
+		OSMO_ASSERT(bsub);
+		bsc_subscr_set_tmsi(bsub, 0x10000000 + i);
+	}
+
+	t0 = now_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		imsi_for(imsi, sizeof(imsi), (i * 7919) % population);
+		bsub = bsc_subscr_find_by_imsi(bsubst, imsi);
+		OSMO_ASSERT(bsub);
+		bsc_subscr_put(bsub);
+	}
+	ns_imsi = (now_ns() - t0) / LOOKUPS;
+
+	t0 = now_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		bsub = bsc_subscr_find_by_tmsi(bsubst, 0x10000000 + (i * 7919) % population);
+		OSMO_ASSERT(bsub);
+		bsc_subscr_put(bsub);
+	}
+	ns_tmsi = (now_ns() - t0) / LOOKUPS;
+
+	t0 = now_ns();
+	for (i = 0; i < LINEAR_LOOKUPS; i++) {
+		imsi_for(imsi, sizeof(imsi), (i * 7919) % population);
+		OSMO_ASSERT(find_linear(bsubst, imsi));
+	}
+	ns_linear = (now_ns() - t0) / LINEAR_LOOKUPS;
+
+	printf("%10u  %12.1f  %12.1f  %14.1f\n", population, ns_imsi, ns_tmsi, ns_linear);
+
+	/* the store is the talloc parent of all its subscribers */
+	talloc_free(bsubst);
+}
+
+static const struct log_info_cat log_categories[] = {
+	[DREF] = {
+		.name = "DREF",
+		.description = "Reference Counting",
+		.enabled = 0, .loglevel = LOGL_NOTICE,
+	},
+};
+
+static const struct log_info log_info = {
+	.cat = log_categories,
+	.num_cat = ARRAY_SIZE(log_categories),
+};
+
+int main()
+{
+	void *ctx = talloc_named_const(NULL, 0, "bsc_subscr_bench");
+	unsigned int i;
+
+	osmo_init_logging2(ctx, &log_info);
+
+	printf("population  by IMSI [ns]  by TMSI [ns]  linear IMSI [ns]\n");
+	for (i = 0; i < ARRAY_SIZE(populations); i++)
+		bench(ctx, populations[i]);
+
+	return 0;
+}
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <inttypes.h>
 
+struct bsc_subscr_store *bsubst;
 struct llist_head *bsc_subscribers;
 
 #define VERBOSE_ASSERT(val, expect_op, fmt) \
@@ -43,7 +44,7 @@ static void assert_bsc_subscr(const struct bsc_subscr *bsub, const char *imsi)
 	OSMO_ASSERT(bsub);
 	OSMO_ASSERT(strcmp(bsub->imsi, imsi) == 0);
 
-	sfound = bsc_subscr_find_by_imsi(bsc_subscribers, imsi);
+	sfound = bsc_subscr_find_by_imsi(bsubst, imsi);
 	OSMO_ASSERT(sfound == bsub);
 
 	bsc_subscr_put(sfound);
@@ -60,23 +61,23 @@ static void test_bsc_subscr(void)
 
 	/* Check for emptiness */
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 0, "%d");
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi1) == NULL);
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi2) == NULL);
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi3) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi1) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi2) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi3) == NULL);
 
 	/* Allocate entry 1 */
-	s1 = bsc_subscr_find_or_create_by_imsi(bsc_subscribers, imsi1);
+	s1 = bsc_subscr_find_or_create_by_imsi(bsubst, imsi1);
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 1, "%d");
 	assert_bsc_subscr(s1, imsi1);
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 1, "%d");
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi2) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi2) == NULL);
 
 	/* Allocate entry 2 */
-	s2 = bsc_subscr_find_or_create_by_imsi(bsc_subscribers, imsi2);
+	s2 = bsc_subscr_find_or_create_by_imsi(bsubst, imsi2);
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 2, "%d");
 
 	/* Allocate entry 3 */
-	s3 = bsc_subscr_find_or_create_by_imsi(bsc_subscribers, imsi3);
+	s3 = bsc_subscr_find_or_create_by_imsi(bsubst, imsi3);
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 3, "%d");
 
 	/* Check entries */
@@ -88,7 +89,7 @@ static void test_bsc_subscr(void)
 	bsc_subscr_put(s1);
 	s1 = NULL;
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 2, "%d");
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi1) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi1) == NULL);
 
 	assert_bsc_subscr(s2, imsi2);
 	assert_bsc_subscr(s3, imsi3);
@@ -97,19 +98,53 @@ static void test_bsc_subscr(void)
 	bsc_subscr_put(s2);
 	s2 = NULL;
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 1, "%d");
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi1) == NULL);
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi2) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi1) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi2) == NULL);
 	assert_bsc_subscr(s3, imsi3);
 
 	/* Free entry 3 */
 	bsc_subscr_put(s3);
 	s3 = NULL;
 	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 0, "%d");
-	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsc_subscribers, imsi3) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi3) == NULL);
 
 	OSMO_ASSERT(llist_empty(bsc_subscribers));
 }
 
+static void test_bsc_subscr_index(void)
+{
+	struct bsc_subscr *s1, *sfound;
+	const char *imsi1 = "1234567890";
+	uint32_t tmsi1 = 0x12345678;
+	uint32_t tmsi2 = 0x87654321;
+
+	printf("Test BSC subscriber IMSI and TMSI index\n");
+
+	/* Allocate by TMSI, then learn the IMSI */
+	s1 = bsc_subscr_find_or_create_by_tmsi(bsubst, tmsi1);
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi1) == NULL);
+	bsc_subscr_set_imsi(s1, imsi1);
+	assert_bsc_subscr(s1, imsi1);
+
+	sfound = bsc_subscr_find_by_tmsi(bsubst, tmsi1);
+	OSMO_ASSERT(sfound == s1);
+	bsc_subscr_put(sfound);
+
+	/* TMSI reallocation */
+	bsc_subscr_set_tmsi(s1, tmsi2);
+	OSMO_ASSERT(bsc_subscr_find_by_tmsi(bsubst, tmsi1) == NULL);
+	sfound = bsc_subscr_find_by_tmsi(bsubst, tmsi2);
+	OSMO_ASSERT(sfound == s1);
+	bsc_subscr_put(sfound);
+
+	/* Free it, no index may still point at it */
+	bsc_subscr_put(s1);
+	s1 = NULL;
+	VERBOSE_ASSERT(llist_count(bsc_subscribers), == 0, "%d");
+	OSMO_ASSERT(bsc_subscr_find_by_imsi(bsubst, imsi1) == NULL);
+	OSMO_ASSERT(bsc_subscr_find_by_tmsi(bsubst, tmsi2) == NULL);
+}
+
 static const struct log_info_cat log_categories[] = {
 	[DREF] = {
 		.name = "DREF",
@@ -133,10 +168,11 @@ int main()
 	log_set_use_color(osmo_stderr_target, 0);
 	log_set_print_category(osmo_stderr_target, 1);
 
-	bsc_subscribers = talloc_zero(ctx, struct llist_head);
-	INIT_LLIST_HEAD(bsc_subscribers);
+	bsubst = bsc_subscr_store_alloc(ctx);
+	bsc_subscribers = &bsubst->bsub_list;
 
 	test_bsc_subscr();
+	test_bsc_subscr_index();
 
 	printf("Done\n");
 	return 0;